@@ -0,0 +1,177 @@
+// leaderboard_server.cpp
+// Night Highway Patrol - local stand-in for the shared kiosk leaderboard
+// Speaks the same line protocol as LeaderboardClient in main.cpp:
+//   SUBMIT <kiosk> <score>   (any number of times)
+//   END                      -> "OK <accepted> <best>"
+//   TOP                      -> up to 10 lines "<kiosk> <score>", then "END"
+// Usage:
+//   leaderboard_server [--port N]
+//   leaderboard_server --loadgen [--port N] [--clients N] [--seconds N] [--batch N]
+
+#include "net_socket.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+const int DEFAULT_PORT = 7777;
+
+// ==================== SERVER ====================
+
+std::mutex boardMutex;
+std::map<std::string, int> bestByKiosk;
+int bestOverall = 0;
+std::atomic<long long> totalSubmissions(0);
+
+void handleClient(socket_t client) {
+    NetLineReader reader(client);
+    std::string line;
+    int accepted = 0;
+    std::vector<std::pair<std::string,int>> pending;
+
+    while (reader.readLine(line)) {
+        std::istringstream in(line);
+        std::string cmd;
+        in >> cmd;
+
+        if (cmd == "SUBMIT") {
+            std::string kiosk;
+            int score = 0;
+            if (in >> kiosk >> score && score >= 0) {
+                pending.emplace_back(kiosk, score);
+            }
+        } else if (cmd == "END") {
+            // Apply the whole batch under one lock
+            int best;
+            {
+                std::lock_guard<std::mutex> lock(boardMutex);
+                for (const auto &p : pending) {
+                    int &slot = bestByKiosk[p.first];
+                    if (p.second > slot) slot = p.second;
+                    if (p.second > bestOverall) bestOverall = p.second;
+                }
+                best = bestOverall;
+            }
+            accepted = (int)pending.size();
+            totalSubmissions += accepted;
+            pending.clear();
+            std::string reply = "OK " + std::to_string(accepted) + " " + std::to_string(best) + "\n";
+            if (!netSendAll(client, reply.data(), reply.size())) break;
+        } else if (cmd == "TOP") {
+            std::vector<std::pair<std::string,int>> rows;
+            {
+                std::lock_guard<std::mutex> lock(boardMutex);
+                rows.assign(bestByKiosk.begin(), bestByKiosk.end());
+            }
+            std::sort(rows.begin(), rows.end(), [](const std::pair<std::string,int>& a,
+                                                   const std::pair<std::string,int>& b) {
+                return a.second > b.second;
+            });
+            if (rows.size() > 10) rows.resize(10);
+            std::string reply;
+            for (const auto &r : rows) reply += r.first + " " + std::to_string(r.second) + "\n";
+            reply += "END\n";
+            if (!netSendAll(client, reply.data(), reply.size())) break;
+        } else {
+            const char* err = "ERR unknown command\n";
+            if (!netSendAll(client, err, strlen(err))) break;
+        }
+    }
+    netClose(client);
+}
+
+int runServer(int port) {
+    socket_t listener = netListenTcp("127.0.0.1", port);
+    if (listener == INVALID_SOCK) {
+        std::cerr << "Cannot listen on 127.0.0.1:" << port << "\n";
+        return 1;
+    }
+    std::cout << "Leaderboard stand-in listening on 127.0.0.1:" << port << std::endl;
+
+    while (true) {
+        socket_t client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_SOCK) continue;
+        int one = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+        std::thread(handleClient, client).detach();
+    }
+}
+
+// ==================== LOAD GENERATOR ====================
+
+// Each client thread submits batches back-to-back for a fixed duration and
+// counts acknowledged submissions; the total rate is submissions per second.
+int runLoadGen(int port, int clients, int seconds, int batch) {
+    std::atomic<long long> acked(0);
+    std::atomic<long long> batches(0);
+    std::atomic<int> failures(0);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            socket_t s = netConnectTcp("127.0.0.1", port, 2000);
+            if (s == INVALID_SOCK) { failures++; return; }
+            NetLineReader reader(s);
+            std::string kiosk = "loadgen" + std::to_string(c);
+            std::string line;
+            unsigned seed = 1234u + (unsigned)c;
+
+            while (std::chrono::steady_clock::now() < deadline) {
+                std::string msg;
+                for (int i = 0; i < batch; ++i) {
+                    seed = seed * 1103515245u + 12345u;
+                    msg += "SUBMIT " + kiosk + " " + std::to_string((seed >> 16) % 5000) + "\n";
+                }
+                msg += "END\n";
+                if (!netSendAll(s, msg.data(), msg.size()) || !reader.readLine(line)) {
+                    failures++;
+                    break;
+                }
+                int n = 0;
+                if (sscanf(line.c_str(), "OK %d", &n) == 1) acked += n;
+                batches++;
+            }
+            netClose(s);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto &t : threads) t.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "clients=" << clients << " batch=" << batch << " seconds=" << elapsed << "\n";
+    std::cout << "submissions=" << acked.load() << " batches=" << batches.load()
+              << " failures=" << failures.load() << "\n";
+    std::cout << "submissions/sec=" << (long long)(acked.load() / (elapsed > 0 ? elapsed : 1)) << std::endl;
+    return failures.load() == clients ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    int port = DEFAULT_PORT;
+    bool loadgen = false;
+    int clients = 4, seconds = 5, batch = 32;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) port = atoi(argv[++i]);
+        else if (arg == "--loadgen") loadgen = true;
+        else if (arg == "--clients" && i + 1 < argc) clients = std::max(1, atoi(argv[++i]));
+        else if (arg == "--seconds" && i + 1 < argc) seconds = std::max(1, atoi(argv[++i]));
+        else if (arg == "--batch" && i + 1 < argc) batch = std::max(1, atoi(argv[++i]));
+    }
+
+    if (!netStartup()) {
+        std::cerr << "Socket startup failed\n";
+        return 1;
+    }
+    return loadgen ? runLoadGen(port, clients, seconds, batch) : runServer(port);
+}
@@ -1,18 +1,98 @@
 // main.cpp
 // Night Highway Patrol - Enhanced Version
 // Uses: DDA, Bresenham line, Midpoint circle, basic 2D transforms
-// Controls: Left/Right arrows: move | S: siren | P: pause | R: restart | ESC: exit
-
+// Controls: Left/Right arrows: move | S: siren | P: pause | R: restart | B: rewind 1 s | N: lights | V: 3D view | L: input lag | ESC: exit
+// Options:  --leaderboard HOST:PORT  submit scores to a shared leaderboard server
+//           --kiosk NAME             name reported with each submitted score (one word)
+//           --police M --criminals N pursuit units on the road (default 1 each)
+//           --low-latency-input      pump input right before each step (L: lag overlay)
+//           --perspective            start in the pseudo-3D view (V toggles)
+//           --software-render [--render-threads N]
+//                                    rasterize the scene on the CPU in parallel tiles
+//           --render-scale PCT|auto  internal resolution 50-100% of the window, upscaled;
+//                                    auto lowers it while frames run over budget
+//           --netplay HOST:PORT [--net-port N] [--net-side 0|1] [--rival police|criminal]
+//                     [--seed N] [--input-delay N] [--latency MS] [--loss PCT]
+//                                    head-to-head with another process over UDP (rollback);
+//                                    both sides pass the same seed, rival and delay
+//           --telemetry FILE         record every tick's trajectory (telemetry_reader reads it)
+//           --metrics-port N         Prometheus metrics at http://127.0.0.1:N/metrics
+//           --audio                  sound through ALSA (build with -DNHP_ALSA -lasound)
+//           --audio-wav FILE         sound into a WAV file, one tick of audio per game tick
+//           --env-bench [--envs N] [--threads N] [--steps N]
+//                                    headless bot-environment throughput run
+//           --ai-bench [--criminals N] [--traffic N] [--steps N]
+//                                    headless criminal planner cost per tick
+//           --convoy-bench [--police M] [--criminals N] [--steps N]
+//                                    headless full-simulation cost per tick
+//           --traffic-bench [--vehicles N] [--steps N]
+//                                    car-following pass cost per tick, queue stability at 1-4.5x
+//           --sweep-check [--steps N]
+//                                    swept collision vs dense sampling (N * 50 cases)
+//           --netplay-test [--latency MS] [--loss PCT] [--input-delay N] [--rival police|criminal] [--steps N]
+//                                    two peers over loopback UDP: rollback rate, re-sim cost, desync check
+//           --alloc-check [--police M] [--criminals N] [--steps N] [--threads N]
+//                                    fail if steady-state frames hit the heap (-DNHP_ALLOC_COUNT build)
+//           --snapshot-bench [--police M] [--criminals N] [--steps N] [--save F] [--load F]
+//                                    rewind-history cost, density and replay check
+//           --telemetry-bench [--police M] [--criminals N] [--steps N] [--save F]
+//                                    recorder overhead, bytes per tick, read-back and scan rate
+//           --metrics-check [--steps N]
+//                                    serve metrics on a localhost port, scrape and verify them
+//           --audio-bench [--voices N] [--steps N] [--save F.wav]
+//                                    mixer CPU per 100 voices, then a game-driven session
+//           --raster-bench [--police M] [--criminals N] [--threads N] [--steps N] [--perspective]
+//                                    tiled vs single-threaded software raster (N <= 600 frames)
+//           --particle-bench [--steps N]
+//                                    50k-particle flood: integrate/emit cost per tick
+//           --scenario NAME|all|list [--police M] [--criminals N] [--steps N] [--render] [--threads N]
+//                                    scripted workload (rush-hour, bus-wall, bike-swarm, max-speed):
+//                                    cost per tick (and raster per frame), repeatability check (C++20)
+//           --upscale-bench [--area WxH] [--threads N] [--steps N]
+//                                    software raster + upscale cost per internal scale, governor check
+
+#include "net_socket.h" // Must precede glut.h (winsock2 vs windows.h)
+#include "telemetry_format.h"
 #include <GL/glut.h>
+#include <GL/freeglut_ext.h> // glutMainLoopEvent for the low-latency loop
+#ifndef _WIN32
+#include <GL/glx.h> // X connection the low-latency loop waits on while idle
+#endif
+#ifdef NHP_ALSA
+#include <alsa/asoundlib.h> // --audio backend (link with -lasound)
+#endif
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
 #include <string>
 #include <vector>
+#include <deque>
 #include <algorithm>
 #include <utility>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <initializer_list>
+#include <cstdarg>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NHP_SSE2 1 // Vectorized light compositor
+#endif
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#define NHP_SCENARIOS 1 // Coroutine scenario scripts (C++20)
+#endif
 
 // Window dimensions
 const int WIDTH = 800;
@@ -24,47 +104,32 @@ const float ROAD_RIGHT = 600.0f;
 const int LANE_COUNT = 3;
 float LANE_X[LANE_COUNT];
 const float LANE_CENTER = (ROAD_LEFT + ROAD_RIGHT) / 2.0f;
+const float ROAD_SCROLL = 3.5f;     // Road speed in px per tick at gameSpeed 1
 
-// Game state
-bool gameOver = false;
-bool paused = false;
-int score = 0;
-float gameSpeed = 1.0f;
+// Lane centers are fixed road geometry; fill them before main() runs so any
+// number of worlds (and threads) can read them without initialization order issues
+static const bool laneCentersReady = [] {
+    float segment = (ROAD_RIGHT - ROAD_LEFT) / (float)LANE_COUNT;
+    for (int i = 0; i < LANE_COUNT; ++i) {
+        LANE_X[i] = ROAD_LEFT + segment * 0.5f + i * segment;
+    }
+    return true;
+}();
 
 // Score timing
-float scoreTimer = 0.0f;
 const float SCORE_INTERVAL = 0.8f; // Slightly faster scoring
-
-// Track criminals caught
-int criminalsCaught = 0;
+const uint32_t SCORE_TICKS = (uint32_t)(SCORE_INTERVAL * 1000.0f / 16.0f + 0.5f); // At 16 ms per tick
 
 // High score system
 int highScore = 0;
 const std::string HIGH_SCORE_FILE = "highscore.txt";
 
-// Civilian spawning control
-float gameTime = 0.0f;
-float lastSpawnTime = 0.0f;
-float baseSpawnInterval = 3.0f; // Base spawn interval
-int activeCivilianCount = 0;
-
 // Base vehicle size
 const float BASE_VEH_W = 44.0f;
 const float BASE_VEH_H = 66.0f;
 
-// Police car
-struct PoliceCar {
-    float x, y;
-    float width, height;
-    bool sirenOn;
-    int sirenBlink;
-    float vx;
-    bool leftPressed;
-    bool rightPressed;
-    float maxVx;
-} police = {WIDTH/2.0f, 80.0f, BASE_VEH_W, BASE_VEH_H, true, 0, 0.0f, false, false, 250.0f};
-
 // Civilian vehicle types: 0=car, 1=bus, 2=bike
+// (spawn template; live vehicles are entities in the store below)
 struct Car {
     float x, y;
     float width, height;
@@ -72,1037 +137,7639 @@ struct Car {
     int color;
     int type;
     int lane;
-    bool active;
 };
 
-// Criminal car
-struct CriminalCar {
-    float baseX;
-    float x, y;
-    float width, height;
-    float speed;
-    float zigzag;
-    bool active;
-} criminal = {WIDTH/2.0f, WIDTH/2.0f, HEIGHT + 100.0f, BASE_VEH_W, BASE_VEH_H, 2.5f, 0.0f, true};
+// ==================== ENTITY STORE ====================
+// Every vehicle on the road - police, criminal or civilian - is an entity: a
+// slot in a fixed-capacity store whose components live in parallel arrays.
+// Systems in updateGame() walk the arrays they need and filter by role, so a
+// road can hold any mix of police units, criminals and traffic.
 
-// Containers
-std::vector<Car> civilianCars;
-struct LaneMarker { float x, y; };
-std::vector<LaneMarker> laneMarkers;
-std::vector<std::pair<int,int>> stars;
+enum EntityRole : uint8_t { ROLE_NONE = 0, ROLE_POLICE, ROLE_CRIMINAL, ROLE_CIVILIAN };
 
-// Random helpers
-static float randFloat(float a, float b) {
-    return a + (b - a) * (rand() / (float)RAND_MAX);
-}
-static int randInt(int a, int b) {
-    if (a > b) return a;
-    return a + rand() % (b - a + 1);
-}
+// Render templates (civilian values match Car::type)
+enum RenderTemplate : uint8_t { RENDER_CAR = 0, RENDER_BUS = 1, RENDER_BIKE = 2, RENDER_POLICE, RENDER_CRIMINAL };
 
-// ==================== HIGH SCORE SYSTEM ====================
+const int MAX_ENTITIES = 1024;
 
-void loadHighScore() {
-    std::ifstream file(HIGH_SCORE_FILE);
-    if (file.is_open()) {
-        file >> highScore;
-        file.close();
-        if (highScore < 0) highScore = 0; // Safety check
-    } else {
-        highScore = 0; // Default if file doesn't exist
-    }
+// Police-only component
+struct PoliceControl {
+    bool sirenOn;
+    int sirenBlink;     // Light phase (0/1), flipped by the scheduler
+    bool leftPressed;
+    bool rightPressed;
+    float maxVx;
+};
+
+// Criminal-only component
+struct CriminalBrain {
+    float baseX;        // Center of the weave; eases toward the target lane
+    float zigzag;
+    int targetLane;     // Lane chosen by the evasion planner
+    int replanIn;       // Ticks until the planner may run again
+};
+
+struct EntityStore {
+    int count = 0;                  // Slots [0, count) may be live; ROLE_NONE = free
+
+    uint8_t role[MAX_ENTITIES];
+    // Transform (x = center, y = bottom edge)
+    float x[MAX_ENTITIES];
+    float y[MAX_ENTITIES];
+    // AABB
+    float width[MAX_ENTITIES];
+    float height[MAX_ENTITIES];
+    // Kinematics: lateral velocity (px/s) and scroll speed (px/tick at gameSpeed 1);
+    // a civilian's speed is the pace it would like, pace the one car following allows
+    float vx[MAX_ENTITIES];
+    float speed[MAX_ENTITIES];
+    float pace[MAX_ENTITIES];
+    // Render template
+    uint8_t render[MAX_ENTITIES];
+    uint8_t color[MAX_ENTITIES];
+    // Lane occupied (-1 = none)
+    int8_t lane[MAX_ENTITIES];
+    // Role-specific components
+    PoliceControl pilot[MAX_ENTITIES];
+    CriminalBrain brain[MAX_ENTITIES];
+    // Position at the start of the current tick, for swept collision tests
+    // (not in snapshots: updateGame refreshes it before anything moves)
+    float x0[MAX_ENTITIES];
+    float y0[MAX_ENTITIES];
+};
+
+// Claim the lowest free slot; returns -1 when the store is full
+int createEntity(EntityStore &e, EntityRole role) {
+    int id = 0;
+    while (id < e.count && e.role[id] != ROLE_NONE) ++id;
+    if (id >= MAX_ENTITIES) return -1;
+    if (id == e.count) e.count++;
+    e.role[id] = role;
+    e.x[id] = e.y[id] = 0.0f;
+    e.width[id] = e.height[id] = 0.0f;
+    e.vx[id] = e.speed[id] = e.pace[id] = 0.0f;
+    e.render[id] = RENDER_CAR;
+    e.color[id] = 0;
+    e.lane[id] = -1;
+    return id;
 }
 
-void saveHighScore() {
-    std::ofstream file(HIGH_SCORE_FILE);
-    if (file.is_open()) {
-        file << highScore;
-        file.close();
-    }
+void destroyEntity(EntityStore &e, int id) {
+    e.role[id] = ROLE_NONE;
+    while (e.count > 0 && e.role[e.count - 1] == ROLE_NONE) e.count--;
 }
 
-void checkAndUpdateHighScore() {
-    if (score > highScore) {
-        highScore = score;
-        saveHighScore();
-    }
+// Placed rather than driven this tick: there is no path to sweep
+void settleEntity(EntityStore &e, int id) {
+    e.x0[id] = e.x[id];
+    e.y0[id] = e.y[id];
 }
 
-// ==================== ALGORITHM IMPLEMENTATIONS ====================
+// Evasion planner cost accounting (wall-clock, reporting only; never steers)
+struct CriminalAiStats {
+    long long ticks = 0;
+    long long plans = 0;
+    long long deferred = 0;     // Plans pushed to a later tick by the budget
+    long long laneChanges = 0;
+    double totalUs = 0.0;
+    double maxTickUs = 0.0;
+};
 
-// Lab 4: DDA Line Algorithm
-void drawLineDDA(float x1, float y1, float x2, float y2) {
-    float dx = x2 - x1;
-    float dy = y2 - y1;
-    float steps = fabsf(dx) > fabsf(dy) ? fabsf(dx) : fabsf(dy);
+// Swept collision accounting (reporting only; never feeds back)
+struct CollisionStats {
+    long long sweptTests = 0;       // Pairs that passed the broad phase
+    long long substeppedUnits = 0;  // Police unit-ticks integrated in substeps
+    long long substeps = 0;
+    long long tunnels = 0;          // Hits the end-of-tick overlap test would have missed
+};
 
-    if (steps <= 0.0f) {
-        glBegin(GL_POINTS);
-        glVertex2i((int)roundf(x1), (int)roundf(y1));
-        glEnd();
-        return;
-    }
+// ==================== SCHEDULER ====================
+// Periodic simulation work (score ticks, civilian spawns, siren blink,
+// criminal respawns) runs off a hierarchical timing wheel instead of being
+// polled every tick. Three levels of 64 slots cover 1, 64 and 4096 ticks per
+// slot, so arming or cancelling a timer is O(1), and a tick only visits the
+// timers due in it (plus, every 64 ticks, one coarser slot cascading down).
+// Timers are embedded: each timer id owns one node (the world's own timers,
+// then one per entity slot), so the wheel is a flat part of GameWorld and
+// packs into snapshots by id, independent of list order.
+
+const int WHEEL_BITS = 6;
+const int WHEEL_SLOTS = 1 << WHEEL_BITS;
+const int WHEEL_LEVELS = 3;
+const uint32_t WHEEL_HORIZON = 1u << (WHEEL_BITS * WHEEL_LEVELS); // Ticks (~70 min); capped beyond
+
+enum TimerId {
+    TIMER_SCORE = 0,            // +1 score every SCORE_TICKS
+    TIMER_CIVILIAN_SPAWN,       // Next civilian spawn
+    TIMER_ENTITY_BASE           // + entity id: siren blink (police), respawn check (criminal)
+};
+const int MAX_TIMERS = TIMER_ENTITY_BASE + MAX_ENTITIES;
 
-    float xInc = dx / steps;
-    float yInc = dy / steps;
-    float x = x1, y = y1;
+struct TimerNode {
+    uint32_t due;           // Tick the timer fires on
+    int16_t slot;           // level * WHEEL_SLOTS + index; -1 = not armed
+    int16_t prev, next;     // Slot list links (timer ids)
+};
 
-    glBegin(GL_POINTS);
-    for (int i = 0; i <= (int)steps; ++i) {
-        glVertex2i((int)roundf(x), (int)roundf(y));
-        x += xInc;
-        y += yInc;
-    }
-    glEnd();
+struct TimingWheel {
+    uint32_t now = 0;       // Last tick processed
+    int16_t head[WHEEL_LEVELS * WHEEL_SLOTS];
+    TimerNode node[MAX_TIMERS];
+};
+
+void clearWheel(TimingWheel &tw, uint32_t now) {
+    tw.now = now;
+    for (int s = 0; s < WHEEL_LEVELS * WHEEL_SLOTS; ++s) tw.head[s] = -1;
+    for (int i = 0; i < MAX_TIMERS; ++i) tw.node[i].slot = -1;
 }
 
-// Lab 5: Bresenham Line Algorithm
-void drawLineBresenham(int x1, int y1, int x2, int y2) {
-    int dx = abs(x2 - x1);
-    int dy = abs(y2 - y1);
-    int sx = x1 < x2 ? 1 : -1;
-    int sy = y1 < y2 ? 1 : -1;
-    int err = dx - dy;
+// Coarsest level the timer needs from here: level L slots span 64^L ticks
+static void linkTimer(TimingWheel &tw, int id) {
+    TimerNode &n = tw.node[id];
+    uint32_t delta = n.due - tw.now;
+    int level = 0;
+    while (level + 1 < WHEEL_LEVELS && delta >= (1u << (WHEEL_BITS * (level + 1)))) level++;
+    int slot = level * WHEEL_SLOTS + (int)((n.due >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+    n.slot = (int16_t)slot;
+    n.prev = -1;
+    n.next = tw.head[slot];
+    if (n.next >= 0) tw.node[n.next].prev = (int16_t)id;
+    tw.head[slot] = (int16_t)id;
+}
 
-    glBegin(GL_POINTS);
-    while(true) {
-        glVertex2i(x1, y1);
-        if(x1 == x2 && y1 == y2) break;
+void cancelTimer(TimingWheel &tw, int id) {
+    TimerNode &n = tw.node[id];
+    if (n.slot < 0) return;
+    if (n.prev >= 0) tw.node[n.prev].next = n.next;
+    else tw.head[n.slot] = n.next;
+    if (n.next >= 0) tw.node[n.next].prev = n.prev;
+    n.slot = -1;
+}
 
-        int e2 = 2 * err;
-        if(e2 > -dy) {
-            err -= dy;
-            x1 += sx;
-        }
-        if(e2 < dx) {
-            err += dx;
-            y1 += sy;
+// Fire `ticks` ticks from now (at least one); re-arming moves the timer
+void armTimer(TimingWheel &tw, int id, uint32_t ticks) {
+    cancelTimer(tw, id);
+    tw.node[id].due = tw.now + std::min(std::max(ticks, 1u), WHEEL_HORIZON - 1);
+    linkTimer(tw, id);
+}
+
+bool timerArmed(const TimingWheel &tw, int id) { return tw.node[id].slot >= 0; }
+
+// Steps to the next tick and writes the ids due on it to fired (capacity
+// MAX_TIMERS) in ascending order, which is the order a tick handles them in
+// whatever order they were armed. Returns how many fired; they are disarmed.
+int advanceWheel(TimingWheel &tw, int16_t* fired) {
+    tw.now++;
+    // Entering a new coarse slot: its timers move down to finer levels
+    for (int level = WHEEL_LEVELS - 1; level >= 1; --level) {
+        if (tw.now & ((1u << (WHEEL_BITS * level)) - 1)) continue;
+        int slot = level * WHEEL_SLOTS + (int)((tw.now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+        int id = tw.head[slot];
+        tw.head[slot] = -1;
+        while (id >= 0) {
+            int next = tw.node[id].next;
+            linkTimer(tw, id);
+            id = next;
         }
     }
-    glEnd();
+    int slot = (int)(tw.now & (WHEEL_SLOTS - 1));
+    int count = 0;
+    for (int id = tw.head[slot]; id >= 0; id = tw.node[id].next) {
+        tw.node[id].slot = -1;
+        fired[count++] = (int16_t)id;
+    }
+    tw.head[slot] = -1;
+    std::sort(fired, fired + count);
+    return count;
 }
 
-// Lab 6: Midpoint Circle Algorithm
-void drawCircleMidpoint(int xc, int yc, int r) {
-    int x = 0, y = r;
-    int p = 1 - r;
+// Road is streamed in fixed-length segments along the direction of travel.
+// Each segment carries its own layout; a small pool is recycled behind the
+// camera, so memory stays flat however far a session drives.
+const float SEGMENT_LENGTH = 400.0f;
+const int SEGMENT_POOL = 6;         // Covers the screen plus lookahead for spawns
+const float DASH_SPACING = 65.0f;
+
+struct RoadSegment {
+    long long index;        // Segment number along the road
+    uint8_t laneCount;      // Open lanes; fewer than LANE_COUNT closes the right side
+    int8_t exitSide;        // -1 none, 0 left, 1 right
+    uint8_t lightMask;      // Street lights: bits 0-3 left shoulder, 4-7 right
+    uint8_t lampTint;       // Scenery variation for lamp color
+};
 
-    auto plotCirclePoints = [xc, yc](int x, int y) {
-        glVertex2i(xc + x, yc + y);
-        glVertex2i(xc - x, yc + y);
-        glVertex2i(xc + x, yc - y);
-        glVertex2i(xc - x, yc - y);
-        glVertex2i(xc + y, yc + x);
-        glVertex2i(xc - y, yc + x);
-        glVertex2i(xc + y, yc - x);
-        glVertex2i(xc - y, yc - x);
-    };
+// Hands out segments for a road seed; lets the windowed game prefetch
+// generation on another thread. Must return exactly generateSegment()'s output.
+class SegmentSource {
+public:
+    virtual ~SegmentSource() {}
+    virtual RoadSegment take(uint32_t seed, long long index) = 0;
+};
 
-    glBegin(GL_POINTS);
-    while(x <= y) {
-        plotCirclePoints(x, y);
-        x++;
-        if(p < 0) {
-            p += 2 * x + 1;
-        } else {
-            y--;
-            p += 2 * (x - y) + 1;
-        }
-    }
-    glEnd();
-}
+struct RoadStream {
+    RoadSegment pool[SEGMENT_POOL]; // Fixed ring, consecutive indices
+    int oldest = 0;                 // Slot holding the lowest segment index
+    double distance = 0.0;          // Camera position along the road (px)
+    uint32_t seed = 1u;             // Layout seed (drawn from the gameplay RNG)
+    SegmentSource* source = nullptr; // Optional prefetcher; nullptr = inline
+};
 
-// Filled circle helper
-void drawFilledCircle(int xc, int yc, int r) {
-    if (r < 1) r = 1;
-    for(int dy = -r; dy <= r; ++dy) {
-        int span = (int)floorf(sqrtf((float)(r*r - dy*dy)));
-        glBegin(GL_POINTS);
-        for(int dx = -span; dx <= span; ++dx) {
-            glVertex2i(xc + dx, yc + dy);
-        }
-        glEnd();
-    }
-}
+// Things that happened during the last tick, for effects (particles). Cleared
+// at the start of every update; the simulation itself never reads them.
+enum WorldEventKind : uint8_t {
+    EVENT_CATCH,            // A police unit caught a criminal (at the criminal)
+    EVENT_CRASH             // The player crashed (at the impact); usually the run ends
+};
 
-// ==================== UTILITIES ====================
+struct WorldEvent {
+    uint8_t kind;
+    float x, y;
+};
 
-static float getScaleForY(float /*y*/) {
-    return 1.0f;
-}
+const int MAX_WORLD_EVENTS = 32;
 
-// Rectangle overlap detection
-bool rectOverlap(float x1, float y1, float w1, float h1,
-                 float x2, float y2, float w2, float h2, float margin = 8.0f) {
-    float leftA = x1 - w1/2 - margin;
-    float rightA = x1 + w1/2 + margin;
-    float bottomA = y1;
-    float topA = y1 + h1;
-    float leftB = x2 - w2/2 - margin;
-    float rightB = x2 + w2/2 + margin;
-    float bottomB = y2;
-    float topB = y2 + h2;
-    return !(leftA > rightB || rightA < leftB || topA < bottomB || bottomA > topB);
-}
+// Traffic readings from the last tick, for telemetry (not part of snapshots;
+// the simulation never reads them). A near miss is a civilian the player
+// drew level with this tick with less than NEAR_MISS_GAP of side clearance.
+const float NEAR_MISS_GAP = 12.0f;
 
-// Collision detection
-bool checkCollisionScaled(float x1, float y1, float w1, float h1,
-                          float x2, float y2, float w2, float h2) {
-    float s1 = getScaleForY(y1);
-    float s2 = getScaleForY(y2);
-    float ew1 = w1 * s1;
-    float eh1 = h1 * s1;
-    float ew2 = w2 * s2;
-    float eh2 = h2 * s2;
-    return (x1 - ew1/2.0f < x2 + ew2/2.0f && x1 + ew1/2.0f > x2 - ew2/2.0f &&
-            y1 < y2 + eh2 && y1 + eh1 > y2);
+const int MAX_TICK_PLACEMENTS = 8;  // Civilian placements a tick keeps attempt counts for
+
+struct TrafficSample {
+    int laneCivilians[LANE_COUNT];
+    int nearMisses;
+    uint8_t spawnAttempts[MAX_TICK_PLACEMENTS]; // Positions tried, per placement this tick
+    int placements;         // Placements this tick (attempts kept for the first MAX_TICK_PLACEMENTS)
+    int spawnsPlaced;
+    int spawnsFailed;       // No free position, or the entity store was full
+};
+
+// What ended the run (set with gameOver)
+enum RunEndCause : uint8_t { END_NONE = 0, END_CIVILIAN, END_ROAD_EDGE };
+
+// Vehicle the second player drives in a two-player (netplay) session
+enum RivalKind : uint8_t {
+    RIVAL_NONE = 0,
+    RIVAL_POLICE,           // Police unit 1: a second pursuer
+    RIVAL_CRIMINAL          // The first criminal, steered instead of planned
+};
+
+// How many pursuit units a run starts with
+struct WorldConfig {
+    int policeUnits = 1;        // Unit 0 is the player's; others drive themselves
+    int criminalUnits = 1;
+    uint8_t rival = RIVAL_NONE;
+    bool crashEndsRun = true;   // Off in scripted scenarios: the hit car is towed and the run goes on
+};
+
+// Everything the simulation touches lives in one world instance, so the
+// windowed game, bots and tools can each run their own copy (even in parallel).
+// Gameplay randomness comes from the world's own RNG: same seed, same run.
+struct GameWorld {
+    // Game state
+    bool gameOver = false;
+    uint8_t endCause = END_NONE;
+    bool paused = false;
+    int score = 0;
+    float gameSpeed = 1.0f;
+
+    // Track criminals caught
+    int criminalsCaught = 0;
+
+    // Civilian spawning control
+    float baseSpawnInterval = 3.0f; // Base spawn interval
+    int activeCivilianCount = 0;
+
+    // Score ticks, spawns, siren blink and respawns (its clock is the tick count)
+    TimingWheel sched;
+
+    WorldConfig config;
+    EntityStore ents;
+    int player = -1;                // Police entity driven by keys or a bot
+    int rival = -1;                 // Entity driven by the second player, if any
+    int rivalCaught = 0;            // Catches by a rival unit, or times the rival criminal was caught
+    CriminalAiStats aiStats;
+    CollisionStats collisionStats;
+
+    RoadStream road;
+
+    uint32_t rngState = 1u;
+
+    // Car-following order from the last tick. A cache, not part of snapshots:
+    // the order it sorts into is the same whatever it starts from.
+    int16_t laneOrder[MAX_ENTITIES];
+    int laneOrderCount = 0;
+
+    // Effects feed for the last tick (not part of snapshots)
+    WorldEvent events[MAX_WORLD_EVENTS];
+    int eventCount = 0;
+    TrafficSample traffic = {};
+};
+
+// Steered by a person: a crash ends the run instead of knocking the unit out
+static inline bool isHumanDriven(const GameWorld &w, int id) {
+    return id == w.player || id == w.rival;
 }
 
-// Compute lane center X
-float laneX(int lane) {
-    if (lane < 0) lane = 0;
-    if (lane >= LANE_COUNT) lane = LANE_COUNT - 1;
-    return LANE_X[lane];
+// Player's police controls, or nullptr before the first reset
+PoliceControl* playerControl(GameWorld &w) {
+    if (w.player < 0 || w.ents.role[w.player] != ROLE_POLICE) return nullptr;
+    return &w.ents.pilot[w.player];
 }
 
-// Draw centered text
-void drawCenteredText(int y, void* font, const std::string &text) {
-    int pixelWidth = glutBitmapLength(font, (const unsigned char*)text.c_str());
-    int x = WIDTH/2 - pixelWidth/2;
-    glRasterPos2i(x, y);
-    for (char c : text) glutBitmapCharacter(font, c);
+// The world shown in the GLUT window
+GameWorld world;
+
+// Decorative only; never affects the simulation
+std::vector<std::pair<int,int>> stars;
+
+// Random helpers (xorshift32 over the world's state)
+static uint32_t nextRandom(GameWorld &w) {
+    uint32_t x = w.rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    w.rngState = x;
+    return x;
+}
+static float randFloat(GameWorld &w, float a, float b) {
+    return a + (b - a) * ((nextRandom(w) >> 8) / 16777215.0f);
+}
+static int randInt(GameWorld &w, int a, int b) {
+    if (a > b) return a;
+    return a + (int)(nextRandom(w) % (uint32_t)(b - a + 1));
 }
 
-// ==================== DRAWING FUNCTIONS ====================
+// ==================== FRAME MEMORY ====================
+// Steady-state frames must not touch the heap. Per-frame scratch (sort lists,
+// lane buckets) comes from a bump arena that is reset at frame end. Builds
+// with -DNHP_ALLOC_COUNT count every global operator new so --alloc-check can
+// prove it; the shipped build keeps the default allocator.
 
-void drawRoad() {
-    // Gradient road
-    glBegin(GL_QUADS);
-    glColor3f(0.18f, 0.18f, 0.22f);
-    glVertex2f(ROAD_LEFT, 0);
-    glVertex2f(ROAD_RIGHT, 0);
-    glColor3f(0.12f, 0.12f, 0.16f);
-    glVertex2f(ROAD_RIGHT, HEIGHT);
-    glVertex2f(ROAD_LEFT, HEIGHT);
-    glEnd();
+#ifdef NHP_ALLOC_COUNT
+std::atomic<long long> heapAllocations(0);
 
-    // Road boundaries (DDA)
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glLineWidth(3);
-    drawLineDDA(ROAD_LEFT, 0, ROAD_LEFT, HEIGHT);
-    drawLineDDA(ROAD_RIGHT, 0, ROAD_RIGHT, HEIGHT);
+void* operator new(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
 
-    // Yellow edge lines
-    glColor3f(1.0f, 0.9f, 0.1f);
-    glLineWidth(2);
-    drawLineDDA(ROAD_LEFT + 3, 0, ROAD_LEFT + 3, HEIGHT);
-    drawLineDDA(ROAD_RIGHT - 3, 0, ROAD_RIGHT - 3, HEIGHT);
-    glLineWidth(1);
+// GCC 11+ pairs the inlined free() with operator new and warns; the pairing is
+// correct here because both sides of this replacement use malloc/free
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, std::size_t) noexcept { free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+// Heap allocations so far, or -1 without NHP_ALLOC_COUNT (counter compiled out)
+long long heapAllocationCount() {
+#ifdef NHP_ALLOC_COUNT
+    return heapAllocations.load(std::memory_order_relaxed);
+#else
+    return -1;
+#endif
 }
 
-void drawLaneMarkers() {
-    glColor3f(1.0f, 0.95f, 0.3f);
-    for(const auto& marker : laneMarkers) {
-        glBegin(GL_QUADS);
-        glVertex2f(marker.x - 3, marker.y);
-        glVertex2f(marker.x + 3, marker.y);
-        glVertex2f(marker.x + 3, marker.y + 32);
-        glVertex2f(marker.x - 3, marker.y + 32);
-        glEnd();
+// Bump allocator for trivially destructible scratch arrays. One per thread,
+// so worlds stepped on worker threads never share it. The buffer is claimed
+// on first use (warm-up) and never grows: overflowing it is a bug.
+class FrameArena {
+public:
+    static const size_t CAPACITY = 256 * 1024;
+
+    template <typename T>
+    T* alloc(size_t n) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena never runs destructors");
+        if (!buffer) buffer.reset(new unsigned char[CAPACITY]);
+        size_t start = (top + alignof(T) - 1) & ~(alignof(T) - 1);
+        size_t bytes = (n ? n : 1) * sizeof(T);
+        if (start + bytes > CAPACITY) {
+            std::cerr << "FrameArena overflow (" << start + bytes << " bytes)\n";
+            abort();
+        }
+        top = start + bytes;
+        if (top > highWater) highWater = top;
+        return reinterpret_cast<T*>(buffer.get() + start);
     }
-}
 
-void drawPoliceCar() {
-    float scale = getScaleForY(police.y);
-    float w = police.width * scale;
-    float h = police.height * scale;
+    size_t mark() const { return top; }
+    void release(size_t m) { top = m; }
+    void reset() { top = 0; }
+    size_t peak() const { return highWater; }
 
-    // Body
-    glColor3f(0.05f, 0.08f, 0.65f);
-    glBegin(GL_QUADS);
-    glVertex2f(police.x - w/2, police.y);
-    glVertex2f(police.x + w/2, police.y);
-    glVertex2f(police.x + w/2, police.y + h * 0.65f);
-    glVertex2f(police.x - w/2, police.y + h * 0.65f);
-    glEnd();
+private:
+    std::unique_ptr<unsigned char[]> buffer;
+    size_t top = 0;
+    size_t highWater = 0;
+};
 
-    // Top cabin
-    glColor3f(0.08f, 0.12f, 0.7f);
-    glBegin(GL_QUADS);
-    glVertex2f(police.x - w * 0.35f, police.y + h * 0.65f);
-    glVertex2f(police.x + w * 0.35f, police.y + h * 0.65f);
-    glVertex2f(police.x + w * 0.3f, police.y + h);
-    glVertex2f(police.x - w * 0.3f, police.y + h);
-    glEnd();
+thread_local FrameArena frameArena;
 
-    // Outline (Bresenham)
-    glColor3f(1.0f, 1.0f, 1.0f);
-    int x1 = (int)roundf(police.x - w/2);
-    int x2 = (int)roundf(police.x + w/2);
-    int y1 = (int)roundf(police.y);
-    int y2 = (int)roundf(police.y + h);
-    drawLineBresenham(x1, y1, x2, y1);
-    drawLineBresenham(x2, y1, x2, y2);
-    drawLineBresenham(x2, y2, x1, y2);
-    drawLineBresenham(x1, y2, x1, y1);
+// Returns everything allocated inside a scope (for code that runs outside frames)
+class ArenaScope {
+public:
+    ArenaScope() : saved(frameArena.mark()) {}
+    ~ArenaScope() { frameArena.release(saved); }
+private:
+    size_t saved;
+};
 
-    // Windshield
-    glColor3f(0.5f, 0.7f, 0.95f);
-    glBegin(GL_QUADS);
-    glVertex2f(police.x - w * 0.28f, police.y + h * 0.68f);
-    glVertex2f(police.x + w * 0.28f, police.y + h * 0.68f);
-    glVertex2f(police.x + w * 0.25f, police.y + h * 0.9f);
-    glVertex2f(police.x - w * 0.25f, police.y + h * 0.9f);
-    glEnd();
+// ==================== ROAD STREAMING ====================
 
-    // Police stripe
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glBegin(GL_QUADS);
-    glVertex2f(police.x - w * 0.4f, police.y + h * 0.42f);
-    glVertex2f(police.x + w * 0.4f, police.y + h * 0.42f);
-    glVertex2f(police.x + w * 0.4f, police.y + h * 0.48f);
-    glVertex2f(police.x - w * 0.4f, police.y + h * 0.48f);
-    glEnd();
+static uint32_t hashSegment(uint32_t seed, long long index) {
+    uint64_t z = (uint64_t)index * 0x9E3779B97F4A7C15ull + seed;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return (uint32_t)(z ^ (z >> 31));
+}
 
-    // Wheels (Midpoint Circle)
-    glColor3f(0.08f, 0.08f, 0.08f);
-    int wheelRadius = (int)std::max(4.0f, 6.0f * scale);
-    drawFilledCircle((int)roundf(police.x - w * 0.35f), (int)roundf(police.y + h * 0.15f), wheelRadius);
-    drawFilledCircle((int)roundf(police.x + w * 0.35f), (int)roundf(police.y + h * 0.15f), wheelRadius);
-
-    // Siren lights (alternating)
-    if (police.sirenOn) {
-        if (police.sirenBlink < 15) {
-            glColor3f(1.0f, 0.1f, 0.1f);
-            drawFilledCircle((int)roundf(police.x - w * 0.2f), (int)roundf(police.y + h - 4.0f * scale), (int)std::max(3.0f, 5.0f * scale));
-        } else {
-            glColor3f(0.1f, 0.2f, 1.0f);
-            drawFilledCircle((int)roundf(police.x + w * 0.2f), (int)roundf(police.y + h - 4.0f * scale), (int)std::max(3.0f, 5.0f * scale));
-        }
+// Pure function of (seed, index): any thread may generate any segment
+RoadSegment generateSegment(uint32_t seed, long long index) {
+    uint32_t h = hashSegment(seed, index);
+    RoadSegment seg;
+    seg.index = index;
+    seg.laneCount = LANE_COUNT;
+    seg.exitSide = -1;
+    if (index >= 3) { // Keep the start of every run plain
+        if (h % 7 == 0) seg.laneCount = LANE_COUNT - 1;     // Right lane closed
+        else if ((h >> 3) % 5 == 0) seg.exitSide = (int8_t)((h >> 7) & 1);
     }
+    seg.lightMask = (uint8_t)(h >> 12);
+    seg.lampTint = (uint8_t)(h >> 20);
+    return seg;
 }
 
-void drawCivilianCar(const Car& car) {
-    if(!car.active) return;
+static RoadSegment fetchSegment(RoadStream &r, long long index) {
+    return r.source ? r.source->take(r.seed, index) : generateSegment(r.seed, index);
+}
 
-    float scale = getScaleForY(car.y);
-    float w = car.width * scale;
-    float h = car.height * scale;
+void resetRoad(RoadStream &r, uint32_t seed) {
+    r.seed = seed;
+    r.distance = 0.0;
+    r.oldest = 0;
+    for (int i = 0; i < SEGMENT_POOL; ++i) {
+        r.pool[i] = fetchSegment(r, i - 1); // One segment behind the camera
+    }
+}
 
-    // Color by type
-    switch(car.color) {
-        case 0: glColor3f(0.05f, 0.45f, 0.8f); break;   // Blue
-        case 1: glColor3f(0.05f, 0.65f, 0.2f); break;   // Green
-        case 2: glColor3f(0.9f, 0.75f, 0.05f); break;   // Yellow
-        case 3: glColor3f(0.65f, 0.25f, 0.75f); break;  // Purple
-        default: glColor3f(0.85f, 0.35f, 0.15f); break; // Orange
+// Scroll the camera and recycle segments that fell behind it
+void advanceRoad(RoadStream &r, float delta) {
+    r.distance += delta;
+    while ((r.pool[r.oldest].index + 1) * (double)SEGMENT_LENGTH < r.distance - 100.0) {
+        long long next = r.pool[r.oldest].index + SEGMENT_POOL;
+        r.pool[r.oldest] = fetchSegment(r, next);
+        r.oldest = (r.oldest + 1) % SEGMENT_POOL;
     }
+}
 
-    // Body
-    glBegin(GL_QUADS);
-    glVertex2f(car.x - w/2, car.y);
-    glVertex2f(car.x + w/2, car.y);
-    glVertex2f(car.x + w/2, car.y + h * 0.65f);
-    glVertex2f(car.x - w/2, car.y + h * 0.65f);
-    glEnd();
+// Segment under a screen y (beyond the pool it is generated on the spot)
+RoadSegment segmentAt(const RoadStream &r, float screenY) {
+    long long index = (long long)floor((r.distance + screenY) / SEGMENT_LENGTH);
+    long long first = r.pool[r.oldest].index;
+    if (index >= first && index < first + SEGMENT_POOL) {
+        return r.pool[(r.oldest + (int)(index - first)) % SEGMENT_POOL];
+    }
+    return generateSegment(r.seed, index);
+}
 
-    // Top
-    glBegin(GL_QUADS);
-    glVertex2f(car.x - w * 0.35f, car.y + h * 0.65f);
-    glVertex2f(car.x + w * 0.35f, car.y + h * 0.65f);
-    glVertex2f(car.x + w * 0.3f, car.y + h);
-    glVertex2f(car.x - w * 0.3f, car.y + h);
-    glEnd();
+bool laneOpenAt(const RoadStream &r, int lane, float screenY) {
+    return lane < segmentAt(r, screenY).laneCount;
+}
 
-    // Wheels
-    glColor3f(0.08f, 0.08f, 0.08f);
-    int wheelR = (int)std::max(2.0f, 5.0f * scale);
-    drawFilledCircle((int)roundf(car.x - w * 0.35f), (int)roundf(car.y + h * 0.15f), wheelR);
-    drawFilledCircle((int)roundf(car.x + w * 0.35f), (int)roundf(car.y + h * 0.15f), wheelR);
+// Generates segments ahead of the stream on a background thread. take() never
+// waits: a miss (new seed, or the worker fell behind) is generated inline.
+// Ready segments sit in a fixed ring so steady streaming never allocates.
+class SegmentPrefetcher : public SegmentSource {
+public:
+    static const size_t DEPTH = 8;
 
-    // Window
-    glColor3f(0.25f, 0.3f, 0.4f);
-    glBegin(GL_QUADS);
-    glVertex2f(car.x - w * 0.25f, car.y + h * 0.68f);
-    glVertex2f(car.x + w * 0.25f, car.y + h * 0.68f);
-    glVertex2f(car.x + w * 0.22f, car.y + h * 0.9f);
-    glVertex2f(car.x - w * 0.22f, car.y + h * 0.9f);
-    glEnd();
+    SegmentPrefetcher() : head(0), count(0), seed(0), nextIndex(0), stopping(false) {
+        worker = std::thread(&SegmentPrefetcher::run, this);
+    }
 
-    // Bus special features
-    if (car.type == 1) {
-        glColor3f(0.95f, 0.95f, 0.95f);
-        for (int i = 0; i < 3; ++i) {
-            float wx = car.x - w * 0.3f + i * (w * 0.3f);
-            glBegin(GL_QUADS);
-            glVertex2f(wx, car.y + h * 0.5f);
-            glVertex2f(wx + w * 0.15f, car.y + h * 0.5f);
-            glVertex2f(wx + w * 0.15f, car.y + h * 0.62f);
-            glVertex2f(wx, car.y + h * 0.62f);
-            glEnd();
+    ~SegmentPrefetcher() override {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
         }
+        cv.notify_all();
+        worker.join();
     }
 
-    // Tail lights
-    glColor3f(0.7f, 0.05f, 0.05f);
-    glBegin(GL_QUADS);
-    glVertex2f(car.x - w * 0.38f, car.y + h * 0.12f);
-    glVertex2f(car.x - w * 0.32f, car.y + h * 0.12f);
-    glVertex2f(car.x - w * 0.32f, car.y + h * 0.22f);
-    glVertex2f(car.x - w * 0.38f, car.y + h * 0.22f);
-    glEnd();
-    glBegin(GL_QUADS);
-    glVertex2f(car.x + w * 0.32f, car.y + h * 0.12f);
-    glVertex2f(car.x + w * 0.38f, car.y + h * 0.12f);
-    glVertex2f(car.x + w * 0.38f, car.y + h * 0.22f);
-    glVertex2f(car.x + w * 0.32f, car.y + h * 0.22f);
-    glEnd();
-}
+    RoadSegment take(uint32_t roadSeed, long long index) override {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (roadSeed != seed) {
+                seed = roadSeed;
+                count = 0;
+            }
+            while (count > 0 && front().index < index) popFront();
+            if (count > 0 && front().index == index) {
+                RoadSegment seg = front();
+                popFront();
+                cv.notify_one();
+                return seg;
+            }
+            count = 0;
+            nextIndex = index + 1;
+        }
+        cv.notify_one();
+        return generateSegment(roadSeed, index);
+    }
 
-void drawCriminalCar() {
-    if(!criminal.active) return;
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this] { return stopping || count < DEPTH; });
+            if (stopping) return;
+            uint32_t s = seed;
+            long long index = count == 0 ? nextIndex : back().index + 1;
+            lock.unlock();
+            RoadSegment seg = generateSegment(s, index);
+            lock.lock();
+            // Drop work that a seed change or a miss made stale
+            bool expected = count == 0 ? (index == nextIndex) : (index == back().index + 1);
+            if (s == seed && expected && count < DEPTH) ready[(head + count++) % DEPTH] = seg;
+        }
+    }
 
-    float scale = getScaleForY(criminal.y);
-    float w = criminal.width * scale;
-    float h = criminal.height * scale;
+    const RoadSegment &front() const { return ready[head]; }
+    const RoadSegment &back() const { return ready[(head + count - 1) % DEPTH]; }
+    void popFront() { head = (head + 1) % DEPTH; count--; }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    RoadSegment ready[DEPTH];
+    size_t head, count;
+    uint32_t seed;
+    long long nextIndex;
+    bool stopping;
+    std::thread worker;
+};
 
-    // Body (aggressive red)
-    glColor3f(0.95f, 0.05f, 0.05f);
-    glBegin(GL_QUADS);
-    glVertex2f(criminal.x - w/2, criminal.y);
-    glVertex2f(criminal.x + w/2, criminal.y);
-    glVertex2f(criminal.x + w/2, criminal.y + h * 0.65f);
-    glVertex2f(criminal.x - w/2, criminal.y + h * 0.65f);
-    glEnd();
+// ==================== SNAPSHOTS ====================
+// A snapshot is the whole simulation state packed into a flat byte image:
+// world scalars, RNG, road ring, then one fixed-stride record per entity slot
+// in [0, count). Fixed stride keeps a slot at the same offset from tick to
+// tick, so XOR against a keyframe leaves long zero runs for the delta coder.
+// The AI cost counters (except the tick count) and the prefetcher pointer are
+// not simulation state and are left untouched by a restore. Timers pack as
+// their due tick by id (0 = not armed) and are re-armed on restore.
 
-    // Top
-    glColor3f(0.8f, 0.05f, 0.05f);
-    glBegin(GL_QUADS);
-    glVertex2f(criminal.x - w * 0.35f, criminal.y + h * 0.65f);
-    glVertex2f(criminal.x + w * 0.35f, criminal.y + h * 0.65f);
-    glVertex2f(criminal.x + w * 0.3f, criminal.y + h);
-    glVertex2f(criminal.x - w * 0.3f, criminal.y + h);
-    glEnd();
+static_assert(std::is_trivially_copyable<GameWorld>::value, "worlds are forked by plain copy");
 
-    // Racing stripes
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glBegin(GL_QUADS);
-    glVertex2f(criminal.x - 4, criminal.y);
-    glVertex2f(criminal.x + 4, criminal.y);
-    glVertex2f(criminal.x + 4, criminal.y + h * 0.8f);
-    glVertex2f(criminal.x - 4, criminal.y + h * 0.8f);
-    glEnd();
+const size_t SNAPSHOT_HEADER_BYTES = 256;       // Upper bound, checked in packWorld
+const size_t SNAPSHOT_ENTITY_BYTES = 4 + 7 * 4 + 11 + 16 + 4;
+const size_t MAX_SNAPSHOT_BYTES = SNAPSHOT_HEADER_BYTES + MAX_ENTITIES * SNAPSHOT_ENTITY_BYTES;
 
-    // Danger stripe
-    glColor3f(1.0f, 1.0f, 0.0f);
-    glBegin(GL_QUADS);
-    glVertex2f(criminal.x - w * 0.4f, criminal.y + h * 0.45f);
-    glVertex2f(criminal.x + w * 0.4f, criminal.y + h * 0.45f);
-    glVertex2f(criminal.x + w * 0.4f, criminal.y + h * 0.5f);
-    glVertex2f(criminal.x - w * 0.4f, criminal.y + h * 0.5f);
-    glEnd();
+template <typename T>
+static void putField(uint8_t*& p, const T &v) { memcpy(p, &v, sizeof(T)); p += sizeof(T); }
+template <typename T>
+static void getField(const uint8_t*& p, T &v) { memcpy(&v, p, sizeof(T)); p += sizeof(T); }
 
-    // Wheels
-    glColor3f(0.05f, 0.05f, 0.05f);
-    int wheelR = (int)std::max(3.0f, 6.0f * scale);
-    drawFilledCircle((int)roundf(criminal.x - w * 0.35f), (int)roundf(criminal.y + h * 0.15f), wheelR);
-    drawFilledCircle((int)roundf(criminal.x + w * 0.35f), (int)roundf(criminal.y + h * 0.15f), wheelR);
+static uint32_t packedDue(const TimingWheel &tw, int id) {
+    return timerArmed(tw, id) ? tw.node[id].due : 0u; // Armed timers are due after now >= 0
+}
+static void unpackDue(TimingWheel &tw, int id, uint32_t due) {
+    if (due) armTimer(tw, id, due - tw.now);
+}
 
-    // Tinted window
-    glColor3f(0.1f, 0.1f, 0.15f);
-    glBegin(GL_QUADS);
-    glVertex2f(criminal.x - w * 0.28f, criminal.y + h * 0.68f);
-    glVertex2f(criminal.x + w * 0.28f, criminal.y + h * 0.68f);
-    glVertex2f(criminal.x + w * 0.25f, criminal.y + h * 0.9f);
-    glVertex2f(criminal.x - w * 0.25f, criminal.y + h * 0.9f);
-    glEnd();
+// Fields are written one by one so struct padding never leaks into the image
+size_t packWorld(const GameWorld &w, uint8_t* out) {
+    uint8_t* p = out;
+    putField(p, w.gameOver); putField(p, w.endCause); putField(p, w.paused);
+    putField(p, w.score); putField(p, w.gameSpeed); putField(p, w.criminalsCaught);
+    putField(p, w.baseSpawnInterval); putField(p, w.activeCivilianCount);
+    putField(p, w.sched.now); putField(p, packedDue(w.sched, TIMER_SCORE));
+    putField(p, packedDue(w.sched, TIMER_CIVILIAN_SPAWN));
+    putField(p, w.config.policeUnits); putField(p, w.config.criminalUnits);
+    putField(p, w.player); putField(p, w.rngState);
+    putField(p, w.config.rival); putField(p, w.config.crashEndsRun);
+    putField(p, w.rival); putField(p, w.rivalCaught);
+    putField(p, w.aiStats.ticks); // Also the planner's round-robin cursor
+    putField(p, w.road.oldest); putField(p, w.road.distance); putField(p, w.road.seed);
+    for (int k = 0; k < SEGMENT_POOL; ++k) {
+        const RoadSegment &s = w.road.pool[k];
+        putField(p, s.index); putField(p, s.laneCount); putField(p, s.exitSide);
+        putField(p, s.lightMask); putField(p, s.lampTint);
+    }
+    const EntityStore &e = w.ents;
+    putField(p, e.count);
+    if ((size_t)(p - out) > SNAPSHOT_HEADER_BYTES) {
+        std::cerr << "SNAPSHOT_HEADER_BYTES too small\n";
+        abort();
+    }
+
+    for (int i = 0; i < e.count; ++i) {
+        putField(p, e.role[i]); putField(p, e.render[i]); putField(p, e.color[i]); putField(p, e.lane[i]);
+        putField(p, e.x[i]); putField(p, e.y[i]); putField(p, e.width[i]); putField(p, e.height[i]);
+        putField(p, e.vx[i]); putField(p, e.speed[i]); putField(p, e.pace[i]);
+        // Components of other roles are never read, so they pack as zeros
+        // (a rival criminal takes its keys through the police controls)
+        PoliceControl pc = {};
+        CriminalBrain cb = {};
+        if (e.role[i] == ROLE_POLICE || i == w.rival) pc = e.pilot[i];
+        if (e.role[i] == ROLE_CRIMINAL) cb = e.brain[i];
+        putField(p, pc.sirenOn); putField(p, pc.sirenBlink); putField(p, pc.leftPressed);
+        putField(p, pc.rightPressed); putField(p, pc.maxVx);
+        putField(p, cb.baseX); putField(p, cb.zigzag); putField(p, cb.targetLane); putField(p, cb.replanIn);
+        putField(p, packedDue(w.sched, TIMER_ENTITY_BASE + i));
+    }
+    return (size_t)(p - out);
 }
 
-void drawBackground() {
-    // Gradient sky
-    glBegin(GL_QUADS);
-    glColor3f(0.04f, 0.04f, 0.14f);
-    glVertex2f(0, 0);
-    glVertex2f(WIDTH, 0);
-    glColor3f(0.02f, 0.02f, 0.08f);
-    glVertex2f(WIDTH, HEIGHT);
-    glVertex2f(0, HEIGHT);
-    glEnd();
+// Run state from an image's leading fields, without unpacking the rest
+static void peekRunState(const uint8_t* image, bool &gameOver, int &score) {
+    const uint8_t* p = image;
+    uint8_t endCause;
+    bool paused;
+    getField(p, gameOver); getField(p, endCause); getField(p, paused); getField(p, score);
+}
 
-    // Stars
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glBegin(GL_POINTS);
-    for (const auto &s : stars) {
-        glVertex2i(s.first, s.second);
-        glVertex2i(s.first + 1, s.second);
-        glVertex2i(s.first, s.second + 1);
+// Restores an image of `size` bytes (in must be readable for at least
+// SNAPSHOT_HEADER_BYTES). Counts and indices are checked before they address
+// anything, so a damaged or foreign image is rejected rather than written past
+// the entity arrays; on false, w is partly overwritten and must be discarded.
+bool unpackWorld(const uint8_t* in, size_t size, GameWorld &w) {
+    const uint8_t* p = in;
+    getField(p, w.gameOver); getField(p, w.endCause); getField(p, w.paused);
+    getField(p, w.score); getField(p, w.gameSpeed); getField(p, w.criminalsCaught);
+    getField(p, w.baseSpawnInterval); getField(p, w.activeCivilianCount);
+    uint32_t now, due;
+    getField(p, now);
+    clearWheel(w.sched, now);
+    getField(p, due); unpackDue(w.sched, TIMER_SCORE, due);
+    getField(p, due); unpackDue(w.sched, TIMER_CIVILIAN_SPAWN, due);
+    getField(p, w.config.policeUnits); getField(p, w.config.criminalUnits);
+    getField(p, w.player); getField(p, w.rngState);
+    getField(p, w.config.rival); getField(p, w.config.crashEndsRun);
+    getField(p, w.rival); getField(p, w.rivalCaught);
+    getField(p, w.aiStats.ticks);
+    getField(p, w.road.oldest); getField(p, w.road.distance); getField(p, w.road.seed);
+    for (int k = 0; k < SEGMENT_POOL; ++k) {
+        RoadSegment &s = w.road.pool[k];
+        getField(p, s.index); getField(p, s.laneCount); getField(p, s.exitSide);
+        getField(p, s.lightMask); getField(p, s.lampTint);
     }
-    glEnd();
+    EntityStore &e = w.ents;
+    int count;
+    getField(p, count);
+    size_t header = (size_t)(p - in);
+    if (header > size || count < 0 || count > MAX_ENTITIES ||
+        size < header + (size_t)count * SNAPSHOT_ENTITY_BYTES) return false;
+    if (w.player < -1 || w.player >= count || w.rival < -1 || w.rival >= count) return false;
+    if (w.road.oldest < 0 || w.road.oldest >= SEGMENT_POOL) return false;
+    e.count = count;
+
+    for (int i = 0; i < e.count; ++i) {
+        getField(p, e.role[i]); getField(p, e.render[i]); getField(p, e.color[i]); getField(p, e.lane[i]);
+        if (e.role[i] > ROLE_CIVILIAN || e.lane[i] < -1 || e.lane[i] >= LANE_COUNT) return false;
+        getField(p, e.x[i]); getField(p, e.y[i]); getField(p, e.width[i]); getField(p, e.height[i]);
+        getField(p, e.vx[i]); getField(p, e.speed[i]); getField(p, e.pace[i]);
+        PoliceControl &pc = e.pilot[i];
+        CriminalBrain &cb = e.brain[i];
+        getField(p, pc.sirenOn); getField(p, pc.sirenBlink); getField(p, pc.leftPressed);
+        getField(p, pc.rightPressed); getField(p, pc.maxVx);
+        getField(p, cb.baseX); getField(p, cb.zigzag); getField(p, cb.targetLane); getField(p, cb.replanIn);
+        if (e.role[i] == ROLE_CRIMINAL && (cb.targetLane < 0 || cb.targetLane >= LANE_COUNT)) return false;
+        getField(p, due); unpackDue(w.sched, TIMER_ENTITY_BASE + i, due);
+    }
+    return true;
+}
 
-    // Buildings (left side)
-    glColor3f(0.08f, 0.08f, 0.14f);
-    for(int i = 0; i < 3; i++) {
-        int x = 30 + i * 60;
-        int h = 100 + (i % 3) * 80;
-        glBegin(GL_QUADS);
-        glVertex2f(x, 0);
-        glVertex2f(x + 45, 0);
-        glVertex2f(x + 45, h);
-        glVertex2f(x, h);
-        glEnd();
+// Independent copy for lookahead: same state, but it never pulls from the
+// original's prefetcher (which would steal segments from the live road)
+void forkWorld(const GameWorld &src, GameWorld &dst) {
+    dst = src;
+    dst.road.source = nullptr;
+}
 
-        // Windows
-        glColor3f(1.0f, 0.9f, 0.4f);
-        for(int j = 0; j < h/25; j++) {
-            if((i + j) % 3 != 0) {
-                glBegin(GL_QUADS);
-                glVertex2f(x + 5, 10 + j * 20);
-                glVertex2f(x + 15, 10 + j * 20);
-                glVertex2f(x + 15, 16 + j * 20);
-                glVertex2f(x + 5, 16 + j * 20);
-                glEnd();
-                glBegin(GL_QUADS);
-                glVertex2f(x + 25, 10 + j * 20);
-                glVertex2f(x + 35, 10 + j * 20);
-                glVertex2f(x + 35, 16 + j * 20);
-                glVertex2f(x + 25, 16 + j * 20);
-                glEnd();
+// Delta coder: the image XOR a base image (zero-extended), as alternating
+// zero runs and literal runs, each length a LEB128 varint. A keyframe is just
+// a delta against an empty base. Output is bounded by 3 + size * 9/8 bytes.
+static void putVarint(uint8_t*& p, uint32_t v) {
+    while (v >= 0x80) { *p++ = (uint8_t)(v | 0x80); v >>= 7; }
+    *p++ = (uint8_t)v;
+}
+static uint32_t getVarint(const uint8_t*& p) {
+    uint32_t v = 0;
+    for (int shift = 0; ; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+}
+
+// diff is caller scratch of curSize bytes: XOR first, a word at a time (byte
+// pointers may alias, so a byte loop stays scalar), then scan it for runs
+size_t encodeDelta(const uint8_t* cur, size_t curSize, const uint8_t* base, size_t baseSize,
+                   uint8_t* diff, uint8_t* out) {
+    size_t common = std::min(curSize, baseSize);
+    size_t i = 0;
+    for (; i + 8 <= common; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, cur + i, 8);
+        memcpy(&y, base + i, 8);
+        x ^= y;
+        memcpy(diff + i, &x, 8);
+    }
+    for (; i < common; ++i) diff[i] = cur[i] ^ base[i];
+    memcpy(diff + common, cur + common, curSize - common);
+
+    uint8_t* p = out;
+    putVarint(p, (uint32_t)curSize);
+    i = 0;
+    while (i < curSize) {
+        size_t z = i;
+        uint64_t word;
+        while (z + 8 <= curSize && (memcpy(&word, diff + z, 8), word == 0)) z += 8;
+        while (z < curSize && diff[z] == 0) z++;
+        // A literal run ends at the next pair of zero bytes (a lone zero costs
+        // more as a run header than as a literal)
+        size_t l = z;
+        while (l < curSize && !(diff[l] == 0 && (l + 1 >= curSize || diff[l + 1] == 0))) l++;
+        putVarint(p, (uint32_t)(z - i));
+        putVarint(p, (uint32_t)(l - z));
+        for (size_t k = z; k < l; ++k) *p++ = diff[k]; // Runs are short; beats a memcpy call
+        i = l;
+    }
+    return (size_t)(p - out);
+}
+
+size_t decodeDelta(const uint8_t* in, const uint8_t* base, size_t baseSize, uint8_t* out) {
+    const uint8_t* p = in;
+    size_t size = getVarint(p);
+    size_t i = 0;
+    while (i < size) {
+        size_t zeros = getVarint(p);
+        size_t lit = getVarint(p);
+        for (size_t k = 0; k < zeros; ++k, ++i) out[i] = i < baseSize ? base[i] : 0;
+        for (size_t k = 0; k < lit; ++k, ++i) out[i] = *p++ ^ (i < baseSize ? base[i] : 0);
+    }
+    return size;
+}
+
+const size_t MAX_ENCODED_BYTES = 16 + MAX_SNAPSHOT_BYTES + MAX_SNAPSHOT_BYTES / 8;
+
+// Rewind history: one snapshot per tick in a fixed byte ring. Every
+// keyframeInterval-th frame is a keyframe; the rest are deltas against their
+// group's keyframe (not the previous frame), so any tick decodes in at most
+// two steps. When space runs out the oldest whole group is dropped. All
+// memory is claimed up front; recording never allocates. Not thread-safe.
+class SnapshotRing {
+public:
+    SnapshotRing(size_t capacityBytes, int maxFrames, int keyframeInterval = 60)
+        : capacity(capacityBytes), frameSlots(maxFrames), keyInterval(keyframeInterval),
+          bytes(new uint8_t[capacityBytes]), frames(new FrameRecord[maxFrames]),
+          packed(new uint8_t[MAX_SNAPSHOT_BYTES]), keyImage(new uint8_t[MAX_SNAPSHOT_BYTES]),
+          scratch(new uint8_t[MAX_SNAPSHOT_BYTES]), encoded(new uint8_t[MAX_ENCODED_BYTES]) {
+        clear();
+    }
+
+    void clear() {
+        firstTick = nextTick = 0;
+        writePos = 0;
+        keyTick = -1;
+        keySize = 0;
+        framesRecorded = 0;
+        rawBytesRecorded = encodedBytesRecorded = 0;
+        totalNs = 0.0;
+    }
+
+    // Appends the world as the next tick
+    void record(const GameWorld &w) {
+        auto start = std::chrono::steady_clock::now();
+        size_t size = packWorld(w, packed.get());
+        bool key = keyTick < 0 || nextTick - keyTick >= keyInterval;
+        size_t n = key ? encodeDelta(packed.get(), size, nullptr, 0, scratch.get(), encoded.get())
+                       : encodeDelta(packed.get(), size, keyImage.get(), keySize, scratch.get(), encoded.get());
+        size_t offset = reserve(n);
+        if (!key && keyTick < firstTick) {
+            // Making room dropped this group's keyframe: start a new group here
+            key = true;
+            n = encodeDelta(packed.get(), size, nullptr, 0, scratch.get(), encoded.get());
+            offset = reserve(n);
+        }
+        if (key) {
+            memcpy(keyImage.get(), packed.get(), size);
+            keySize = size;
+            keyTick = nextTick;
+        }
+        memcpy(bytes.get() + offset, encoded.get(), n);
+        FrameRecord &f = frames[nextTick % frameSlots];
+        f.offset = offset;
+        f.size = n;
+        f.keyTick = keyTick;
+        writePos = offset + n;
+        nextTick++;
+
+        framesRecorded++;
+        rawBytesRecorded += (long long)size;
+        encodedBytesRecorded += (long long)n;
+        totalNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Decodes a recorded tick into w (AI stats and road source are kept)
+    bool restore(long long tick, GameWorld &w) {
+        if (tick < firstTick || tick >= nextTick) return false;
+        const FrameRecord &f = frames[tick % frameSlots];
+        const FrameRecord &k = frames[f.keyTick % frameSlots];
+        size_t size = decodeDelta(bytes.get() + k.offset, nullptr, 0, scratch.get());
+        if (f.keyTick != tick) {
+            memcpy(packed.get(), scratch.get(), size);
+            size = decodeDelta(bytes.get() + f.offset, packed.get(), size, scratch.get());
+        }
+        return unpackWorld(scratch.get(), size, w);
+    }
+
+    // Forgets everything after tick (rewinding then playing on forks history)
+    void truncateAfter(long long tick) {
+        if (tick < firstTick || tick >= nextTick) return;
+        const FrameRecord &f = frames[tick % frameSlots];
+        nextTick = tick + 1;
+        writePos = f.offset + f.size;
+        keyTick = -1; // Next frame starts a fresh group
+    }
+
+    long long oldest() const { return firstTick; }
+    long long newest() const { return nextTick - 1; }
+    long long frameCount() const { return nextTick - firstTick; }
+
+    size_t bytesHeld() const {
+        if (nextTick == firstTick) return 0;
+        size_t start = frames[firstTick % frameSlots].offset;
+        return writePos >= start ? writePos - start : capacity - start + writePos;
+    }
+
+    // Lifetime accounting since clear()
+    double nsPerRecord() const { return framesRecorded ? totalNs / framesRecorded : 0.0; }
+    double rawBytesPerFrame() const { return framesRecorded ? (double)rawBytesRecorded / framesRecorded : 0.0; }
+    double encodedBytesPerFrame() const { return framesRecorded ? (double)encodedBytesRecorded / framesRecorded : 0.0; }
+
+private:
+    struct FrameRecord {
+        size_t offset;
+        size_t size;
+        long long keyTick;
+    };
+
+    // Drops the oldest keyframe and every delta that depends on it
+    void dropOldestGroup() {
+        firstTick++;
+        while (firstTick < nextTick && frames[firstTick % frameSlots].keyTick != firstTick) firstTick++;
+    }
+
+    // Byte offset for an n-byte frame after evicting whatever it would overwrite
+    size_t reserve(size_t n) {
+        if (n > capacity) {
+            std::cerr << "SnapshotRing capacity below one frame\n";
+            abort();
+        }
+        while (nextTick - firstTick >= frameSlots) dropOldestGroup();
+        size_t start = writePos;
+        if (start + n > capacity) {
+            // Wrap; frames still sitting in the skipped tail are the oldest
+            while (firstTick < nextTick && frames[firstTick % frameSlots].offset >= start) dropOldestGroup();
+            start = 0;
+        }
+        while (firstTick < nextTick) {
+            const FrameRecord &f = frames[firstTick % frameSlots];
+            if (f.offset >= start + n || f.offset + f.size <= start) break;
+            dropOldestGroup();
+        }
+        return start;
+    }
+
+    size_t capacity;
+    long long frameSlots;
+    long long keyInterval;
+    std::unique_ptr<uint8_t[]> bytes;
+    std::unique_ptr<FrameRecord[]> frames;
+    std::unique_ptr<uint8_t[]> packed, keyImage, scratch, encoded;
+
+    long long firstTick, nextTick;  // Live ticks are [firstTick, nextTick)
+    size_t writePos;
+    long long keyTick;              // Keyframe of the group being recorded (-1 = none)
+    size_t keySize;
+
+    long long framesRecorded;
+    long long rawBytesRecorded, encodedBytesRecorded;
+    double totalNs;
+};
+
+// Save/restore a single world for long soak runs (same packed image, raw)
+const uint32_t SNAPSHOT_FILE_MAGIC = 0x5350484Eu; // "NHPS"
+const uint32_t SNAPSHOT_FILE_VERSION = 6;
+
+bool saveSnapshotFile(const std::string &path, const GameWorld &w) {
+    std::unique_ptr<uint8_t[]> image(new uint8_t[MAX_SNAPSHOT_BYTES]);
+    uint32_t size = (uint32_t)packWorld(w, image.get());
+    std::ofstream out(path, std::ios::binary);
+    out.write((const char*)&SNAPSHOT_FILE_MAGIC, sizeof(uint32_t));
+    out.write((const char*)&SNAPSHOT_FILE_VERSION, sizeof(uint32_t));
+    out.write((const char*)&size, sizeof(uint32_t));
+    out.write((const char*)image.get(), size);
+    return (bool)out;
+}
+
+bool loadSnapshotFile(const std::string &path, GameWorld &w) {
+    std::ifstream in(path, std::ios::binary);
+    uint32_t magic = 0, version = 0, size = 0;
+    in.read((char*)&magic, sizeof(uint32_t));
+    in.read((char*)&version, sizeof(uint32_t));
+    in.read((char*)&size, sizeof(uint32_t));
+    if (!in || magic != SNAPSHOT_FILE_MAGIC || version != SNAPSHOT_FILE_VERSION || size > MAX_SNAPSHOT_BYTES) {
+        return false;
+    }
+    std::unique_ptr<uint8_t[]> image(new uint8_t[MAX_SNAPSHOT_BYTES]()); // Zeroed past a short image
+    in.read((char*)image.get(), size);
+    if (!in) return false;
+    return unpackWorld(image.get(), size, w);
+}
+
+// Windowed game's rewind history (created in initGame): 5 minutes at 60 Hz
+const int HISTORY_FRAMES = 60 * 60 * 5;
+const size_t HISTORY_BYTES = 32u * 1024 * 1024;
+std::unique_ptr<SnapshotRing> history;
+
+// ==================== HIGH SCORE SYSTEM ====================
+
+// Scores are kept behind a pluggable store so kiosks can share one leaderboard.
+// Implementations must never block the GLUT thread for more than a file read.
+class ScoreStore {
+public:
+    virtual ~ScoreStore() {}
+    virtual int load() = 0;              // Best known score (may be refreshed later)
+    virtual void submit(int score) = 0;  // Record a finished run's score
+};
+
+// Local file holding the best score as one integer (original behavior)
+class FileScoreStore : public ScoreStore {
+public:
+    explicit FileScoreStore(const std::string &path) : path(path), best(0) {}
+
+    int load() override {
+        best = 0; // Default if file doesn't exist
+        std::ifstream file(path);
+        if (file.is_open()) {
+            file >> best;
+            file.close();
+            if (best < 0) best = 0; // Safety check
+        }
+        return best;
+    }
+
+    void submit(int score) override {
+        if (score <= best) return;
+        best = score;
+        std::ofstream file(path);
+        if (file.is_open()) {
+            file << best;
+            file.close();
+        }
+    }
+
+private:
+    std::string path;
+    int best;
+};
+
+// The server reads "<kiosk> <score>" as two words, so a kiosk name is one
+// printable word: no spaces, tabs or line breaks
+bool validKioskName(const std::string &name) {
+    if (name.empty()) return false;
+    for (unsigned char c : name) {
+        if (c <= ' ' || c == 0x7f) return false;
+    }
+    return true;
+}
+
+// Asynchronous batched client for the leaderboard stand-in server.
+// submit() only pushes into a bounded queue; a worker thread drains it in
+// batches over TCP and retries with backoff when the server is unreachable.
+// Protocol (text lines): "SUBMIT <kiosk> <score>" x N, "END" -> "OK <n> <best>"
+class LeaderboardClient : public ScoreStore {
+public:
+    static const size_t QUEUE_CAPACITY = 256;
+    static const size_t BATCH_SIZE = 32;
+
+    LeaderboardClient(const std::string &host, int port, const std::string &kiosk,
+                      std::unique_ptr<ScoreStore> fallback)
+        : host(host), port(port), kiosk(kiosk), fallback(std::move(fallback)),
+          best(0), dropped(0), stopping(false), sock(INVALID_SOCK) {
+        best = this->fallback ? this->fallback->load() : 0;
+        worker = std::thread(&LeaderboardClient::run, this);
+    }
+
+    ~LeaderboardClient() override {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (worker.joinable()) worker.join();
+        netClose(sock);
+    }
+
+    // Never blocks: returns the last best score seen locally or from the server
+    int load() override { return best.load(); }
+
+    void submit(int score) override {
+        int prev = best.load();
+        while (score > prev && !best.compare_exchange_weak(prev, score)) {}
+        if (fallback) fallback->submit(score); // Local best survives outages
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (queue.size() >= QUEUE_CAPACITY) {
+                queue.pop_front(); // Oldest submission loses under pressure
+                dropped++;
             }
+            queue.push_back(score);
         }
-        glColor3f(0.08f, 0.08f, 0.14f);
+        cv.notify_one();
     }
 
-    // Buildings (right side)
-    for(int i = 0; i < 3; i++) {
-        int x = WIDTH - 175 + i * 60;
-        int h = 120 + (i % 3) * 70;
-        glBegin(GL_QUADS);
-        glVertex2f(x, 0);
-        glVertex2f(x + 45, 0);
-        glVertex2f(x + 45, h);
-        glVertex2f(x, h);
-        glEnd();
+    int droppedCount() const { return dropped.load(); }
+
+private:
+    void run() {
+        int backoffMs = 250;
+        std::vector<int> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait_for(lock, std::chrono::milliseconds(500),
+                            [this] { return stopping || !queue.empty(); });
+                if (stopping && queue.empty()) return;
+                while (!queue.empty() && batch.size() < BATCH_SIZE) {
+                    batch.push_back(queue.front());
+                    queue.pop_front();
+                }
+            }
+            // Empty batches still ping the server so 'best' tracks other kiosks
+            if (sendBatch(batch)) {
+                batch.clear();
+                backoffMs = 250;
+                continue;
+            }
+            netClose(sock);
+            sock = INVALID_SOCK;
+            requeue(batch);
+            batch.clear();
+
+            std::unique_lock<std::mutex> lock(mtx);
+            if (stopping) return; // Give up on shutdown; the local file has the score
+            cv.wait_for(lock, std::chrono::milliseconds(backoffMs), [this] { return stopping; });
+            backoffMs = std::min(backoffMs * 2, 8000);
+        }
+    }
+
+    bool sendBatch(const std::vector<int> &batch) {
+        if (sock == INVALID_SOCK) {
+            sock = netConnectTcp(host.c_str(), port, 2000);
+            if (sock == INVALID_SOCK) return false;
+            reader.reset(new NetLineReader(sock));
+        }
+        std::string msg;
+        for (int s : batch) {
+            msg += "SUBMIT " + kiosk + " " + std::to_string(s) + "\n";
+        }
+        msg += "END\n";
+        if (!netSendAll(sock, msg.data(), msg.size())) return false;
+
+        std::string reply;
+        if (!reader->readLine(reply)) return false;
+        std::istringstream in(reply);
+        std::string tag;
+        int accepted = 0, serverBest = 0;
+        if (!(in >> tag >> accepted >> serverBest) || tag != "OK") return false;
+        int prev = best.load();
+        while (serverBest > prev && !best.compare_exchange_weak(prev, serverBest)) {}
+        return true;
+    }
+
+    // Put a failed batch back at the front, keeping the newest within capacity
+    void requeue(const std::vector<int> &batch) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+            if (queue.size() >= QUEUE_CAPACITY) {
+                dropped++;
+                continue;
+            }
+            queue.push_front(*it);
+        }
     }
+
+    std::string host;
+    int port;
+    std::string kiosk;
+    std::unique_ptr<ScoreStore> fallback;
+    std::atomic<int> best;
+    std::atomic<int> dropped;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<int> queue;
+    bool stopping;
+
+    socket_t sock;                          // Worker thread only
+    std::unique_ptr<NetLineReader> reader;  // Worker thread only
+    std::thread worker;
+};
+
+std::unique_ptr<ScoreStore> scoreStore;
+
+void loadHighScore() {
+    highScore = scoreStore ? scoreStore->load() : 0;
 }
 
-void drawUI() {
-    // Control panel (left)
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glRasterPos2i(10, HEIGHT - 20);
-    std::string title = "CONTROLS";
-    for(char c: title) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, c);
+// Report a finished run; each store keeps its own notion of "best"
+void saveHighScore(int score) {
+    if (scoreStore) scoreStore->submit(score);
+}
 
-    glRasterPos2i(10, HEIGHT - 42);
-    std::string line1 = "Arrows: Move";
-    for(char c: line1) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+// Pick up better scores reported by other kiosks. Only called on the
+// IDLE_POLL_MS score poll: the file store re-reads its file on every load.
+void syncHighScore() {
+    if (!scoreStore) return;
+    int shared = scoreStore->load();
+    if (shared > highScore) highScore = shared;
+}
 
-    glRasterPos2i(10, HEIGHT - 60);
-    std::string line2 = "S: Siren | P: Pause";
-    for(char c: line2) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+void checkAndUpdateHighScore(int score) {
+    if (score > highScore) {
+        highScore = score;
+    }
+    saveHighScore(score);
+}
 
-    glRasterPos2i(10, HEIGHT - 78);
-    std::string line3 = "R: Restart | ESC: Exit";
-    for(char c: line3) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+// ==================== ALGORITHM IMPLEMENTATIONS ====================
 
-    // Siren indicator
-    glRasterPos2i(10, HEIGHT - 105);
-    std::string sirenText = "Siren: ";
-    for(char c: sirenText) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
-    if (police.sirenOn) {
-        glColor3f(1.0f, 0.2f, 0.2f);
-        drawFilledCircle(55, HEIGHT - 100, 5);
-    } else {
-        glColor3f(0.4f, 0.4f, 0.4f);
-        drawFilledCircle(55, HEIGHT - 100, 5);
+// Each algorithm walks its pixels through a plot callback, so the GL path
+// (glVertex2i points) and the software rasterizer produce the same pixels.
+
+// Lab 4: DDA Line Algorithm
+template <typename Plot>
+void rasterLineDDA(float x1, float y1, float x2, float y2, Plot plot) {
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    float steps = fabsf(dx) > fabsf(dy) ? fabsf(dx) : fabsf(dy);
+
+    if (steps <= 0.0f) {
+        plot((int)roundf(x1), (int)roundf(y1));
+        return;
     }
 
-    // Score panel (right side with background)
-    glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glBegin(GL_QUADS);
-    glVertex2f(WIDTH - 220, HEIGHT - 90);
-    glVertex2f(WIDTH - 10, HEIGHT - 90);
-    glVertex2f(WIDTH - 10, HEIGHT - 10);
-    glVertex2f(WIDTH - 220, HEIGHT - 10);
+    float xInc = dx / steps;
+    float yInc = dy / steps;
+    float x = x1, y = y1;
+
+    for (int i = 0; i <= (int)steps; ++i) {
+        plot((int)roundf(x), (int)roundf(y));
+        x += xInc;
+        y += yInc;
+    }
+}
+
+void drawLineDDA(float x1, float y1, float x2, float y2) {
+    glBegin(GL_POINTS);
+    rasterLineDDA(x1, y1, x2, y2, [](int x, int y) { glVertex2i(x, y); });
     glEnd();
-    glDisable(GL_BLEND);
+}
 
-    // Score
-    glColor3f(1.0f, 1.0f, 0.2f);
-    glRasterPos2i(WIDTH - 210, HEIGHT - 25);
-    std::string scoreText = "Score: " + std::to_string(score);
-    for(char c: scoreText) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, c);
+// Lab 5: Bresenham Line Algorithm
+template <typename Plot>
+void rasterLineBresenham(int x1, int y1, int x2, int y2, Plot plot) {
+    int dx = abs(x2 - x1);
+    int dy = abs(y2 - y1);
+    int sx = x1 < x2 ? 1 : -1;
+    int sy = y1 < y2 ? 1 : -1;
+    int err = dx - dy;
 
-    // Criminals caught
-    glColor3f(1.0f, 0.4f, 0.4f);
-    glRasterPos2i(WIDTH - 210, HEIGHT - 48);
-    std::string caughtText = "Caught: " + std::to_string(criminalsCaught);
-    for(char c: caughtText) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+    while(true) {
+        plot(x1, y1);
+        if(x1 == x2 && y1 == y2) break;
 
-    // Speed
-    glColor3f(0.4f, 1.0f, 0.4f);
-    glRasterPos2i(WIDTH - 210, HEIGHT - 70);
-    std::string speedText = "Speed: " + std::to_string((int)(gameSpeed * 100)) + "%";
-    for(char c: speedText) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+        int e2 = 2 * err;
+        if(e2 > -dy) {
+            err -= dy;
+            x1 += sx;
+        }
+        if(e2 < dx) {
+            err += dx;
+            y1 += sy;
+        }
+    }
+}
 
-    // High score (top right, below speed)
-    glColor3f(1.0f, 0.8f, 0.2f);
-    glRasterPos2i(WIDTH - 210, HEIGHT - 88);
-    std::string highScoreText = "High: " + std::to_string(highScore);
-    for(char c: highScoreText) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+void drawLineBresenham(int x1, int y1, int x2, int y2) {
+    glBegin(GL_POINTS);
+    rasterLineBresenham(x1, y1, x2, y2, [](int x, int y) { glVertex2i(x, y); });
+    glEnd();
+}
 
-    if(paused) {
-        glColor4f(0.0f, 0.0f, 0.0f, 0.7f);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glBegin(GL_QUADS);
-        glVertex2f(0, 0);
-        glVertex2f(WIDTH, 0);
-        glVertex2f(WIDTH, HEIGHT);
-        glVertex2f(0, HEIGHT);
-        glEnd();
-        glDisable(GL_BLEND);
+// Lab 6: Midpoint Circle Algorithm
+template <typename Plot>
+void rasterCircleMidpoint(int xc, int yc, int r, Plot plot) {
+    int x = 0, y = r;
+    int p = 1 - r;
 
-        glColor3f(1.0f, 1.0f, 0.0f);
-        drawCenteredText(HEIGHT/2, GLUT_BITMAP_TIMES_ROMAN_24, "PAUSED");
-        glColor3f(1.0f, 1.0f, 1.0f);
-        drawCenteredText(HEIGHT/2 - 30, GLUT_BITMAP_HELVETICA_12, "Press P to Resume");
+    auto plotCirclePoints = [xc, yc, &plot](int x, int y) {
+        plot(xc + x, yc + y);
+        plot(xc - x, yc + y);
+        plot(xc + x, yc - y);
+        plot(xc - x, yc - y);
+        plot(xc + y, yc + x);
+        plot(xc - y, yc + x);
+        plot(xc + y, yc - x);
+        plot(xc - y, yc - x);
+    };
+
+    while(x <= y) {
+        plotCirclePoints(x, y);
+        x++;
+        if(p < 0) {
+            p += 2 * x + 1;
+        } else {
+            y--;
+            p += 2 * (x - y) + 1;
+        }
+    }
+}
+
+void drawCircleMidpoint(int xc, int yc, int r) {
+    glBegin(GL_POINTS);
+    rasterCircleMidpoint(xc, yc, r, [](int x, int y) { glVertex2i(x, y); });
+    glEnd();
+}
+
+// Filled circle helper: span(y, xFirst, xLast) per row, inclusive
+template <typename Span>
+void rasterFilledCircle(int xc, int yc, int r, Span span) {
+    if (r < 1) r = 1;
+    for(int dy = -r; dy <= r; ++dy) {
+        int w = (int)floorf(sqrtf((float)(r*r - dy*dy)));
+        span(yc + dy, xc - w, xc + w);
+    }
+}
+
+void drawFilledCircle(int xc, int yc, int r) {
+    glBegin(GL_POINTS);
+    rasterFilledCircle(xc, yc, r, [](int y, int x0, int x1) {
+        for (int x = x0; x <= x1; ++x) glVertex2i(x, y);
+    });
+    glEnd();
+}
+
+// ==================== UTILITIES ====================
+
+// Optional pseudo-3D view (V toggles, --perspective). The simulation stays in
+// flat road space and never reads the view; drawing projects it toward a
+// vanishing point. With the camera PERSPECTIVE_Z0 behind the bottom row, a
+// road-space y lies at depth y + Z0 and draws at scale s = Z0 / (y + Z0), on
+// row horizon * (1 - s), at x = vpX + (x - LANE_CENTER) * s. Scale and row
+// by road depth (depthScale, depthRow) and scale by screen row (rowScale, for
+// the road fill) are tables rebuilt only when the view size changes, so
+// projecting a vertex is two table reads.
+const float PERSPECTIVE_Z0 = 300.0f;        // Camera distance behind the bottom row (px)
+const float PERSPECTIVE_HORIZON = 0.62f;    // Horizon row, fraction of the view height
+const int DEPTH_LUT_MIN = -150;             // Road-space y covered by the depth tables;
+const int DEPTH_LUT_MAX = 4096;             // beyond that positions clamp
+
+struct PerspectiveView {
+    bool enabled = false;
+    float vpX = 0.0f;
+    float horizon = 0.0f;                   // Vanishing row, from the bottom
+    std::vector<float> depthScale, depthRow; // By road-space y - DEPTH_LUT_MIN
+    std::vector<float> rowScale;            // By screen row (bottom = 0), up to the horizon
+};
+
+PerspectiveView view;
+
+void buildPerspectiveTables(int width, int height) {
+    view.vpX = width * 0.5f;
+    view.horizon = height * PERSPECTIVE_HORIZON;
+    int depths = DEPTH_LUT_MAX - DEPTH_LUT_MIN + 1;
+    view.depthScale.resize(depths);
+    view.depthRow.resize(depths);
+    for (int i = 0; i < depths; ++i) {
+        float s = PERSPECTIVE_Z0 / ((float)(DEPTH_LUT_MIN + i) + PERSPECTIVE_Z0);
+        view.depthScale[i] = s;
+        view.depthRow[i] = view.horizon * (1.0f - s);
+    }
+    int rows = (int)view.horizon;
+    view.rowScale.resize(rows + 1);
+    for (int r = 0; r <= rows; ++r) {
+        float s = std::max(1.0f - r / view.horizon, 1e-3f); // Scale is linear in the row
+        view.rowScale[r] = s;
+    }
+}
+
+static inline float sampleDepthTable(const std::vector<float> &table, float y) {
+    float f = std::min(std::max(y, (float)DEPTH_LUT_MIN), (float)(DEPTH_LUT_MAX - 1)) - DEPTH_LUT_MIN;
+    int i = (int)f;
+    return table[i] + (table[i + 1] - table[i]) * (f - i);
+}
+
+// Draw scale of an object standing at road-space y (1 in the flat view)
+static float getScaleForY(float y) {
+    if (!view.enabled) return 1.0f;
+    return sampleDepthTable(view.depthScale, y);
+}
+
+// Road space -> screen (identity in the flat view)
+static inline void projectPoint(float x, float y, float &sx, float &sy) {
+    if (!view.enabled) {
+        sx = x;
+        sy = y;
+        return;
+    }
+    sx = view.vpX + (x - LANE_CENTER) * sampleDepthTable(view.depthScale, y);
+    sy = sampleDepthTable(view.depthRow, y);
+}
+
+// Rectangle overlap detection
+bool rectOverlap(float x1, float y1, float w1, float h1,
+                 float x2, float y2, float w2, float h2, float margin = 8.0f) {
+    float leftA = x1 - w1/2 - margin;
+    float rightA = x1 + w1/2 + margin;
+    float bottomA = y1;
+    float topA = y1 + h1;
+    float leftB = x2 - w2/2 - margin;
+    float rightB = x2 + w2/2 + margin;
+    float bottomB = y2;
+    float topB = y2 + h2;
+    return !(leftA > rightB || rightA < leftB || topA < bottomB || bottomA > topB);
+}
+
+// Collision detection. Positions and sizes are road-space, so boxes are
+// compared at true size whatever the view: the perspective scale is a screen
+// effect of depth, and applying it per box would shrink far hit boxes (and
+// let a display toggle change the simulation).
+bool checkCollisionScaled(float x1, float y1, float w1, float h1,
+                          float x2, float y2, float w2, float h2) {
+    return (x1 - w1/2.0f < x2 + w2/2.0f && x1 + w1/2.0f > x2 - w2/2.0f &&
+            y1 < y2 + h2 && y1 + h1 > y2);
+}
+
+// One axis of a swept test: narrows [tEnter, tExit] to the times at which
+// p + d * t lies strictly inside (lo, hi)
+static inline bool sweepAxis(float p, float d, float lo, float hi, float &tEnter, float &tExit) {
+    if (d == 0.0f) return p > lo && p < hi;
+    float ta = (lo - p) / d, tb = (hi - p) / d;
+    if (ta > tb) std::swap(ta, tb);
+    tEnter = std::max(tEnter, ta);
+    tExit = std::min(tExit, tb);
+    return tEnter < tExit;
+}
+
+// Swept AABB time of impact: both boxes move linearly from their start to
+// their end positions over one step. Returns the first time in [0, 1] at
+// which they overlap, or -1 if they stay apart. Whenever the end positions
+// overlap (checkCollisionScaled), this reports a hit too.
+float sweptTimeOfImpact(float ax0, float ay0, float ax1, float ay1, float aw, float ah,
+                        float bx0, float by0, float bx1, float by1, float bw, float bh) {
+    // In A's frame B starts at (dx, dy) and moves by (vx, vy)
+    float dx = bx0 - ax0, dy = by0 - ay0;
+    float vx = (bx1 - bx0) - (ax1 - ax0), vy = (by1 - by0) - (ay1 - ay0);
+    float tEnter = 0.0f, tExit = 1.0f;
+    float halfW = (aw + bw) * 0.5f;
+    if (sweepAxis(dx, vx, -halfW, halfW, tEnter, tExit) && sweepAxis(dy, vy, -bh, ah, tEnter, tExit)) {
+        return tEnter;
+    }
+    // Rounding can push an entry that only grazes the end of the step past 1
+    return checkCollisionScaled(ax1, ay1, aw, ah, bx1, by1, bw, bh) ? 1.0f : -1.0f;
+}
+
+// Compute lane center X
+float laneX(int lane) {
+    if (lane < 0) lane = 0;
+    if (lane >= LANE_COUNT) lane = LANE_COUNT - 1;
+    return LANE_X[lane];
+}
+
+// Draw centered text
+void drawCenteredText(int y, void* font, const char* text) {
+    int pixelWidth = glutBitmapLength(font, (const unsigned char*)text);
+    int x = WIDTH/2 - pixelWidth/2;
+    glRasterPos2i(x, y);
+    for (const char* c = text; *c; ++c) glutBitmapCharacter(font, *c);
+}
+
+// ==================== DRAW LIST ====================
+// The scene is recorded as a list of primitives in painter's order, then
+// either replayed through GL or handed to the software rasterizer. Capacity
+// is fixed; recording never allocates.
+
+enum DrawKind : uint8_t {
+    DRAW_QUAD,              // Convex quad, flat color
+    DRAW_GRADIENT_RECT,     // Axis-aligned rect, color blends bottom -> top
+    DRAW_LINE_DDA,
+    DRAW_LINE_BRESENHAM,
+    DRAW_FILLED_CIRCLE,
+    DRAW_POINT,
+    DRAW_PARTICLES          // Batch of additive point sprites (v: first, count, size)
+};
+
+struct DrawCmd {
+    uint8_t kind;
+    float rgb[3];
+    float rgbTop[3];        // Gradient rects only
+    float v[8];             // Quad corners / rect x0,y0,x1,y1 / line ends / circle xc,yc,r / point
+    int bx0, by0, bx1, by1; // Conservative pixel bounds (inclusive), for binning
+};
+
+const int MAX_DRAW_CMDS = 16384;
+const int MAX_LIGHTS = 1024;
+const int MAX_PARTICLE_SPRITES = 65536;
+
+// Writable slice of the list's sprite arrays, laid out for GL vertex arrays
+struct ParticleBatch {
+    float* xy;              // x, y per sprite, in target pixels (writer applies scaleX/Y)
+    uint32_t* rgba;         // RGBA8, premultiplied; blended with GL_ONE, GL_ONE
+    int count;
+    float scaleX, scaleY;
+};
+
+// Additive radial light: color * intensity * (1 - d^2/r^2)^2 inside radius
+struct LightSprite {
+    float x, y, radius, intensity;
+    float rgb[3];
+    int bx0, by0, bx1, by1; // Pixel bounds (inclusive)
+};
+
+class DrawList {
+public:
+    DrawList() : cmds(new DrawCmd[MAX_DRAW_CMDS]), lightBuf(new LightSprite[MAX_LIGHTS]),
+                 spriteXY(new float[2 * MAX_PARTICLE_SPRITES]), spriteRgba(new uint32_t[MAX_PARTICLE_SPRITES]),
+                 count(0), lightCount(0), spriteCount(0), dropped(0), cur{1.0f, 1.0f, 1.0f},
+                 sx(1.0f), sy(1.0f) {}
+
+    void clear() { count = 0; lightCount = 0; spriteCount = 0; dropped = 0; }
+    void color(float r, float g, float b) { cur[0] = r; cur[1] = g; cur[2] = b; }
+
+    // Logical (WIDTH x HEIGHT) to target pixels, applied as commands are
+    // recorded. 1 unless the software path renders below the window size.
+    void setScale(float scaleX, float scaleY) { sx = scaleX; sy = scaleY; }
+
+    void quad(float x0, float y0, float x1, float y1, float x2, float y2, float x3, float y3) {
+        DrawCmd* c = push(DRAW_QUAD);
+        if (!c) return;
+        x0 *= sx; x1 *= sx; x2 *= sx; x3 *= sx;
+        y0 *= sy; y1 *= sy; y2 *= sy; y3 *= sy;
+        float v[8] = {x0, y0, x1, y1, x2, y2, x3, y3};
+        memcpy(c->v, v, sizeof(v));
+        c->bx0 = (int)floorf(std::min(std::min(x0, x1), std::min(x2, x3)));
+        c->bx1 = (int)ceilf(std::max(std::max(x0, x1), std::max(x2, x3)));
+        c->by0 = (int)floorf(std::min(std::min(y0, y1), std::min(y2, y3)));
+        c->by1 = (int)ceilf(std::max(std::max(y0, y1), std::max(y2, y3)));
+    }
+
+    void gradientRect(float x0, float y0, float x1, float y1,
+                      float rBottom, float gBottom, float bBottom, float rTop, float gTop, float bTop) {
+        DrawCmd* c = push(DRAW_GRADIENT_RECT);
+        if (!c) return;
+        x0 *= sx; x1 *= sx;
+        y0 *= sy; y1 *= sy;
+        c->rgb[0] = rBottom; c->rgb[1] = gBottom; c->rgb[2] = bBottom;
+        c->rgbTop[0] = rTop; c->rgbTop[1] = gTop; c->rgbTop[2] = bTop;
+        c->v[0] = x0; c->v[1] = y0; c->v[2] = x1; c->v[3] = y1;
+        c->bx0 = (int)floorf(x0); c->bx1 = (int)ceilf(x1);
+        c->by0 = (int)floorf(y0); c->by1 = (int)ceilf(y1);
+    }
+
+    void lineDDA(float x1, float y1, float x2, float y2) {
+        DrawCmd* c = push(DRAW_LINE_DDA);
+        if (!c) return;
+        x1 *= sx; x2 *= sx;
+        y1 *= sy; y2 *= sy;
+        c->v[0] = x1; c->v[1] = y1; c->v[2] = x2; c->v[3] = y2;
+        c->bx0 = (int)floorf(std::min(x1, x2)) - 1; c->bx1 = (int)ceilf(std::max(x1, x2)) + 1;
+        c->by0 = (int)floorf(std::min(y1, y2)) - 1; c->by1 = (int)ceilf(std::max(y1, y2)) + 1;
+    }
+
+    void lineBresenham(int x1, int y1, int x2, int y2) {
+        DrawCmd* c = push(DRAW_LINE_BRESENHAM);
+        if (!c) return;
+        x1 = scaledX(x1); x2 = scaledX(x2);
+        y1 = scaledY(y1); y2 = scaledY(y2);
+        c->v[0] = (float)x1; c->v[1] = (float)y1; c->v[2] = (float)x2; c->v[3] = (float)y2;
+        c->bx0 = std::min(x1, x2); c->bx1 = std::max(x1, x2);
+        c->by0 = std::min(y1, y2); c->by1 = std::max(y1, y2);
+    }
+
+    void filledCircle(int xc, int yc, int r) {
+        DrawCmd* c = push(DRAW_FILLED_CIRCLE);
+        if (!c) return;
+        xc = scaledX(xc); yc = scaledY(yc); r = scaledX(r);
+        if (r < 1) r = 1;
+        c->v[0] = (float)xc; c->v[1] = (float)yc; c->v[2] = (float)r;
+        c->bx0 = xc - r; c->bx1 = xc + r;
+        c->by0 = yc - r; c->by1 = yc + r;
+    }
+
+    void point(int x, int y) {
+        DrawCmd* c = push(DRAW_POINT);
+        if (!c) return;
+        x = scaledX(x); y = scaledY(y);
+        c->v[0] = (float)x; c->v[1] = (float)y;
+        c->bx0 = c->bx1 = x;
+        c->by0 = c->by1 = y;
+    }
+
+    // Reserves up to n square sprites of pointSize pixels drawn as one command;
+    // the caller fills the returned slice (count may come back short)
+    ParticleBatch particles(int n, float pointSize) {
+        ParticleBatch b = {spriteXY.get() + 2 * spriteCount, spriteRgba.get() + spriteCount, 0, sx, sy};
+        int room = MAX_PARTICLE_SPRITES - spriteCount;
+        if (n > room) {
+            dropped += n - room;
+            n = room;
+        }
+        if (n <= 0) return b;
+        DrawCmd* c = push(DRAW_PARTICLES);
+        if (!c) return b;
+        c->v[0] = (float)spriteCount; c->v[1] = (float)n; c->v[2] = pointSize * sx;
+        c->bx0 = 0; c->bx1 = (int)ceilf(WIDTH * sx) - 1; // Binned per sprite by the rasterizer
+        c->by0 = 0; c->by1 = (int)ceilf(HEIGHT * sy) - 1;
+        spriteCount += n;
+        b.count = n;
+        return b;
+    }
+
+    // Lights land in the lighting layer, composited after all primitives
+    void light(float x, float y, float radius, float intensity) {
+        if (lightCount >= MAX_LIGHTS) {
+            dropped++;
+            return;
+        }
+        LightSprite &l = lightBuf[lightCount++];
+        x *= sx; y *= sy; radius *= sx;
+        l.x = x; l.y = y; l.radius = radius; l.intensity = intensity;
+        memcpy(l.rgb, cur, sizeof(cur));
+        l.bx0 = (int)floorf(x - radius); l.bx1 = (int)ceilf(x + radius);
+        l.by0 = (int)floorf(y - radius); l.by1 = (int)ceilf(y + radius);
+    }
+
+    int size() const { return count; }
+    int lightsSize() const { return lightCount; }
+    int droppedCount() const { return dropped; }
+    const DrawCmd &operator[](int i) const { return cmds[i]; }
+    const LightSprite &lightAt(int i) const { return lightBuf[i]; }
+    const float* particleXY() const { return spriteXY.get(); }
+    const uint32_t* particleRgba() const { return spriteRgba.get(); }
+
+private:
+    int scaledX(int x) const { return (int)lrintf(x * sx); }
+    int scaledY(int y) const { return (int)lrintf(y * sy); }
+
+    DrawCmd* push(DrawKind kind) {
+        if (count >= MAX_DRAW_CMDS) {
+            dropped++; // Drawn short rather than grown mid-frame
+            return nullptr;
+        }
+        DrawCmd* c = &cmds[count++];
+        c->kind = kind;
+        memcpy(c->rgb, cur, sizeof(cur));
+        return c;
+    }
+
+    std::unique_ptr<DrawCmd[]> cmds;
+    std::unique_ptr<LightSprite[]> lightBuf;
+    std::unique_ptr<float[]> spriteXY;
+    std::unique_ptr<uint32_t[]> spriteRgba;
+    int count;
+    int lightCount;
+    int spriteCount;
+    int dropped;
+    float cur[3];
+    float sx, sy;
+};
+
+// Window pixels per logical pixel on the GL path. The Lab line and circle
+// algorithms plot points, so points grow with it to keep lines solid.
+float glPointScale = 1.0f;
+
+// GL path: same primitives, same Lab algorithms, immediate mode
+void replayGl(const DrawList &dl) {
+    glPointSize(glPointScale);
+    for (int i = 0; i < dl.size(); ++i) {
+        const DrawCmd &c = dl[i];
+        const float* v = c.v;
+        glColor3fv(c.rgb);
+        switch (c.kind) {
+            case DRAW_QUAD:
+                glBegin(GL_QUADS);
+                glVertex2f(v[0], v[1]);
+                glVertex2f(v[2], v[3]);
+                glVertex2f(v[4], v[5]);
+                glVertex2f(v[6], v[7]);
+                glEnd();
+                break;
+            case DRAW_GRADIENT_RECT:
+                glBegin(GL_QUADS);
+                glVertex2f(v[0], v[1]);
+                glVertex2f(v[2], v[1]);
+                glColor3fv(c.rgbTop);
+                glVertex2f(v[2], v[3]);
+                glVertex2f(v[0], v[3]);
+                glEnd();
+                break;
+            case DRAW_LINE_DDA:
+                drawLineDDA(v[0], v[1], v[2], v[3]);
+                break;
+            case DRAW_LINE_BRESENHAM:
+                drawLineBresenham((int)v[0], (int)v[1], (int)v[2], (int)v[3]);
+                break;
+            case DRAW_FILLED_CIRCLE:
+                drawFilledCircle((int)v[0], (int)v[1], (int)v[2]);
+                break;
+            case DRAW_POINT:
+                // Batch runs of same-colored points (star field) into one glBegin
+                glBegin(GL_POINTS);
+                glVertex2i((int)v[0], (int)v[1]);
+                while (i + 1 < dl.size() && dl[i + 1].kind == DRAW_POINT &&
+                       memcmp(dl[i + 1].rgb, c.rgb, sizeof(c.rgb)) == 0) {
+                    ++i;
+                    glVertex2i((int)dl[i].v[0], (int)dl[i].v[1]);
+                }
+                glEnd();
+                break;
+            case DRAW_PARTICLES:
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE, GL_ONE);
+                glPointSize(v[2] * glPointScale);
+                glEnableClientState(GL_VERTEX_ARRAY);
+                glEnableClientState(GL_COLOR_ARRAY);
+                glVertexPointer(2, GL_FLOAT, 0, dl.particleXY());
+                glColorPointer(4, GL_UNSIGNED_BYTE, 0, dl.particleRgba());
+                glDrawArrays(GL_POINTS, (GLint)v[0], (GLsizei)v[1]);
+                glDisableClientState(GL_COLOR_ARRAY);
+                glDisableClientState(GL_VERTEX_ARRAY);
+                glPointSize(glPointScale);
+                glDisable(GL_BLEND);
+                break;
+        }
+    }
+}
+
+// GL lighting layer: one additive textured quad per light. The sprite texture
+// holds the same (1 - d^2/r^2)^2 falloff the software compositor evaluates.
+GLuint lightSpriteTexture = 0;
+
+void initLightSprite() {
+    const int SIZE = 64;
+    unsigned char texels[SIZE * SIZE];
+    for (int y = 0; y < SIZE; ++y) {
+        for (int x = 0; x < SIZE; ++x) {
+            float dx = (x + 0.5f) / SIZE * 2.0f - 1.0f;
+            float dy = (y + 0.5f) / SIZE * 2.0f - 1.0f;
+            float t = std::max(0.0f, 1.0f - (dx * dx + dy * dy));
+            texels[y * SIZE + x] = (unsigned char)lrintf(t * t * 255.0f);
+        }
+    }
+    glGenTextures(1, &lightSpriteTexture);
+    glBindTexture(GL_TEXTURE_2D, lightSpriteTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, SIZE, SIZE, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, texels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void replayLightsGl(const DrawList &dl) {
+    if (dl.lightsSize() == 0 || !lightSpriteTexture) return;
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, lightSpriteTexture);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBegin(GL_QUADS);
+    for (int i = 0; i < dl.lightsSize(); ++i) {
+        const LightSprite &l = dl.lightAt(i);
+        glColor3f(l.rgb[0] * l.intensity, l.rgb[1] * l.intensity, l.rgb[2] * l.intensity);
+        glTexCoord2f(0, 0); glVertex2f(l.x - l.radius, l.y - l.radius);
+        glTexCoord2f(1, 0); glVertex2f(l.x + l.radius, l.y - l.radius);
+        glTexCoord2f(1, 1); glVertex2f(l.x + l.radius, l.y + l.radius);
+        glTexCoord2f(0, 1); glVertex2f(l.x - l.radius, l.y + l.radius);
+    }
+    glEnd();
+    glDisable(GL_BLEND);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+}
+
+// Software lighting: adds one light into the clip rect [cx0, cx1) x [cy0, cy1)
+// with saturating byte adds (GL_ONE, GL_ONE). The SSE2 path does four pixels
+// per step with the same float operations, in the same order, as the scalar
+// path, and both round to nearest-even, so they agree bit for bit.
+void compositeLight(uint32_t* fb, int stride, int cx0, int cy0, int cx1, int cy1,
+                    const LightSprite &l, bool useSimd) {
+    const float r2 = l.radius * l.radius;
+    const float invR2 = 1.0f / r2;
+    const float col[3] = {l.rgb[0] * 255.0f, l.rgb[1] * 255.0f, l.rgb[2] * 255.0f};
+    int y0 = std::max(l.by0, cy0), y1 = std::min(l.by1, cy1 - 1);
+
+    for (int y = y0; y <= y1; ++y) {
+        float dy = (y + 0.5f) - l.y;
+        float dy2 = dy * dy;
+        if (dy2 >= r2) continue;
+        // Only the chord can receive light; pixels past it would add zero anyway
+        float chord = sqrtf(r2 - dy2);
+        int x = std::max((int)floorf(l.x - chord), cx0);
+        int x1 = std::min((int)ceilf(l.x + chord), cx1 - 1);
+        uint32_t* row = fb + (size_t)y * stride;
+
+#ifdef NHP_SSE2
+        if (useSimd) {
+            const __m128 half = _mm_set1_ps(0.5f), cxv = _mm_set1_ps(l.x);
+            const __m128 dy2v = _mm_set1_ps(dy2), invR2v = _mm_set1_ps(invR2);
+            const __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+            const __m128 intensity = _mm_set1_ps(l.intensity);
+            const __m128 color = _mm_setr_ps(col[0], col[1], col[2], 0.0f);
+            for (; x + 4 <= x1 + 1; x += 4) {
+                __m128 xv = _mm_cvtepi32_ps(_mm_setr_epi32(x, x + 1, x + 2, x + 3));
+                __m128 dx = _mm_sub_ps(_mm_add_ps(xv, half), cxv);
+                __m128 t = _mm_sub_ps(one, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(dx, dx), dy2v), invR2v));
+                t = _mm_max_ps(t, zero);
+                __m128 wgt = _mm_mul_ps(_mm_mul_ps(t, t), intensity);
+                // Per-pixel RGBA contributions, packed down to bytes
+                __m128i p0 = _mm_cvtps_epi32(_mm_mul_ps(color, _mm_shuffle_ps(wgt, wgt, 0x00)));
+                __m128i p1 = _mm_cvtps_epi32(_mm_mul_ps(color, _mm_shuffle_ps(wgt, wgt, 0x55)));
+                __m128i p2 = _mm_cvtps_epi32(_mm_mul_ps(color, _mm_shuffle_ps(wgt, wgt, 0xAA)));
+                __m128i p3 = _mm_cvtps_epi32(_mm_mul_ps(color, _mm_shuffle_ps(wgt, wgt, 0xFF)));
+                __m128i add = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+                __m128i dst = _mm_loadu_si128((const __m128i*)(row + x));
+                _mm_storeu_si128((__m128i*)(row + x), _mm_adds_epu8(dst, add));
+            }
+        }
+#else
+        (void)useSimd;
+#endif
+        for (; x <= x1; ++x) {
+            float dx = ((float)x + 0.5f) - l.x;
+            float t = 1.0f - (dx * dx + dy2) * invR2;
+            if (t <= 0.0f) continue;
+            float wgt = t * t * l.intensity;
+            uint8_t* px = (uint8_t*)(row + x);
+            for (int k = 0; k < 3; ++k) {
+                int v = px[k] + (int)lrintf(col[k] * wgt);
+                px[k] = (uint8_t)(v > 255 ? 255 : v);
+            }
+        }
+    }
+}
+
+// ==================== SOFTWARE RASTERIZER ====================
+// For CPU-only kiosks: the frame's draw list is binned into TILE x TILE
+// screen tiles, then tiles are rasterized in parallel into one framebuffer.
+// A pixel belongs to exactly one tile and each tile replays its commands in
+// submit order, so the result is bit-identical to a single-threaded pass
+// (a one-tile rasterizer is the reference; see --raster-bench).
+// Framebuffer rows run bottom-up like GL, pixels are RGBA8 (glDrawPixels).
+
+static inline uint32_t packColor(const float* rgb) {
+    auto channel = [](float c) {
+        c = c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+        return (uint32_t)(c * 255.0f + 0.5f);
+    };
+    return channel(rgb[0]) | (channel(rgb[1]) << 8) | (channel(rgb[2]) << 16) | 0xFF000000u;
+}
+
+// Per-byte saturating add of two RGBA8 pixels (the GL_ONE, GL_ONE blend)
+static inline uint32_t addSaturate(uint32_t a, uint32_t b) {
+    uint32_t sum = (a & 0x7F7F7F7Fu) + (b & 0x7F7F7F7Fu); // Low 7 bits, no cross-byte carry
+    uint32_t carry = ((a & b) | ((a | b) & sum)) & 0x80808080u;
+    sum ^= (a ^ b) & 0x80808080u;
+    return sum | ((carry >> 7) * 0xFFu);
+}
+
+// Pixels covered by a square point sprite: centers inside [c - size/2, c + size/2)
+static inline void spriteSpan(float c, float size, int &first, int &last) {
+    first = (int)ceilf(c - size * 0.5f - 0.5f);
+    last = (int)ceilf(c + size * 0.5f - 0.5f) - 1;
+}
+
+// Per-tile bin capacity claimed up front. Bins keep their capacity, but each
+// tile only grows the first time its own traffic peaks, which in a normal run
+// keeps happening long after warm-up; these cover a busy road (16 police, 64
+// criminals) so frames stay off the heap.
+const int TILE_BIN_RESERVE = 256;
+const int TILE_LIGHT_RESERVE = 256;
+const int TILE_SPRITE_RESERVE = 4096;
+
+class TileRasterizer {
+public:
+    TileRasterizer(int width, int height, int tileSize, int numThreads, bool simdLights = true)
+        : w(width), h(height), tile(tileSize), simd(simdLights),
+          tilesX((width + tileSize - 1) / tileSize), tilesY((height + tileSize - 1) / tileSize),
+          fb(new uint32_t[(size_t)width * height]), bins(tilesX * tilesY), lightBins(tilesX * tilesY),
+          spriteBins(tilesX * tilesY),
+          list(nullptr), nextTile(0), generation(0), pending(0), stopping(false) {
+        for (auto &b : bins) b.reserve(TILE_BIN_RESERVE);
+        for (auto &b : lightBins) b.reserve(TILE_LIGHT_RESERVE);
+        for (auto &b : spriteBins) b.reserve(TILE_SPRITE_RESERVE);
+        linePixels.reserve((size_t)4 * (width + height) * 4);
+        gradientRows.reserve((size_t)2 * height);
+        prepass.reserve(MAX_DRAW_CMDS);
+        threadCount = std::max(1, numThreads);
+        // The calling thread rasterizes too; helpers join it per frame
+        for (int t = 1; t < threadCount; ++t) {
+            workers.emplace_back(&TileRasterizer::workerLoop, this);
+        }
+    }
+
+    ~TileRasterizer() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        startCv.notify_all();
+        for (auto &t : workers) t.join();
+    }
+
+    void render(const DrawList &dl, const float* clearRgb, bool withLights = true) {
+        auto start = std::chrono::steady_clock::now();
+        clearColor = packColor(clearRgb);
+        lighting = withLights;
+        binCommands(dl);
+        auto binned = std::chrono::steady_clock::now();
+
+        list = &dl;
+        nextTile.store(0);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            pending = threadCount - 1;
+            generation++;
+        }
+        startCv.notify_all();
+        drainTiles();
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            doneCv.wait(lock, [this] { return pending == 0; });
+        }
+        auto end = std::chrono::steady_clock::now();
+        binUs = std::chrono::duration<double, std::micro>(binned - start).count();
+        rasterUs = std::chrono::duration<double, std::micro>(end - binned).count();
+    }
+
+    const uint32_t* pixels() const { return fb.get(); }
+    int width() const { return w; }
+    int height() const { return h; }
+    int threads() const { return threadCount; }
+    double lastBinUs() const { return binUs; }
+    double lastRasterUs() const { return rasterUs; }
+
+private:
+    // Work shared by every tile a command crosses is done once here: lines are
+    // walked into linePixels (tiles just filter the list) and gradient rows
+    // are colored into gradientRows. Particle batches are binned per sprite.
+    void binCommands(const DrawList &dl) {
+        for (auto &b : bins) b.clear(); // Capacity is kept: no steady-state allocation
+        for (auto &b : lightBins) b.clear();
+        for (auto &b : spriteBins) b.clear();
+        linePixels.clear();
+        gradientRows.clear();
+        prepass.resize(dl.size());
+        auto keep = [this](int x, int y) {
+            if (x >= 0 && x < w && y >= 0 && y < h) linePixels.push_back({(int16_t)x, (int16_t)y});
+        };
+        for (int i = 0; i < dl.size(); ++i) {
+            const DrawCmd &c = dl[i];
+            int x0 = std::max(c.bx0, 0), x1 = std::min(c.bx1, w - 1);
+            int y0 = std::max(c.by0, 0), y1 = std::min(c.by1, h - 1);
+            if (x0 > x1 || y0 > y1) continue;
+            if (c.kind == DRAW_PARTICLES) {
+                binSprites(dl, i);
+                continue;
+            }
+            if (c.kind == DRAW_LINE_DDA || c.kind == DRAW_LINE_BRESENHAM) {
+                prepass[i].first = (int)linePixels.size();
+                if (c.kind == DRAW_LINE_DDA) rasterLineDDA(c.v[0], c.v[1], c.v[2], c.v[3], keep);
+                else rasterLineBresenham((int)c.v[0], (int)c.v[1], (int)c.v[2], (int)c.v[3], keep);
+                prepass[i].second = (int)linePixels.size();
+            } else if (c.kind == DRAW_GRADIENT_RECT) {
+                // Row color sampled at the pixel center, like GL's interpolation
+                int ya = std::max((int)ceilf(c.v[1] - 0.5f), 0);
+                int yb = std::min((int)ceilf(c.v[3] - 0.5f) - 1, h - 1);
+                prepass[i].first = (int)gradientRows.size() - ya; // Indexed by y
+                float height = c.v[3] - c.v[1];
+                for (int y = ya; y <= yb; ++y) {
+                    float f = ((y + 0.5f) - c.v[1]) / height;
+                    float rgb[3];
+                    for (int k = 0; k < 3; ++k) rgb[k] = c.rgb[k] + (c.rgbTop[k] - c.rgb[k]) * f;
+                    gradientRows.push_back(packColor(rgb));
+                }
+            }
+            for (int ty = y0 / tile; ty <= y1 / tile; ++ty) {
+                for (int tx = x0 / tile; tx <= x1 / tile; ++tx) {
+                    bins[ty * tilesX + tx].push_back(i);
+                }
+            }
+        }
+        for (int i = 0; lighting && i < dl.lightsSize(); ++i) {
+            const LightSprite &l = dl.lightAt(i);
+            int x0 = std::max(l.bx0, 0), x1 = std::min(l.bx1, w - 1);
+            int y0 = std::max(l.by0, 0), y1 = std::min(l.by1, h - 1);
+            if (x0 > x1 || y0 > y1) continue;
+            for (int ty = y0 / tile; ty <= y1 / tile; ++ty) {
+                for (int tx = x0 / tile; tx <= x1 / tile; ++tx) {
+                    lightBins[ty * tilesX + tx].push_back(i);
+                }
+            }
+        }
+    }
+
+    // A tile gets the batch command once, plus the sprites that touch it in
+    // submit order (sprites of later batches follow, so tiles walk a cursor)
+    void binSprites(const DrawList &dl, int cmd) {
+        const DrawCmd &c = dl[cmd];
+        const int first = (int)c.v[0], last = first + (int)c.v[1];
+        const float* xy = dl.particleXY();
+        for (int s = first; s < last; ++s) {
+            int xa, xb, ya, yb;
+            spriteSpan(xy[2 * s], c.v[2], xa, xb);
+            spriteSpan(xy[2 * s + 1], c.v[2], ya, yb);
+            xa = std::max(xa, 0); xb = std::min(xb, w - 1);
+            ya = std::max(ya, 0); yb = std::min(yb, h - 1);
+            if (xa > xb || ya > yb) continue;
+            for (int ty = ya / tile; ty <= yb / tile; ++ty) {
+                for (int tx = xa / tile; tx <= xb / tile; ++tx) {
+                    int t = ty * tilesX + tx;
+                    if (bins[t].empty() || bins[t].back() != cmd) bins[t].push_back(cmd);
+                    spriteBins[t].push_back(s);
+                }
+            }
+        }
+    }
+
+    void workerLoop() {
+        int seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                startCv.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            drainTiles();
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                pending--;
+            }
+            doneCv.notify_one();
+        }
+    }
+
+    // Tiles are claimed one at a time, so busy tiles (traffic) don't stall a slice
+    void drainTiles() {
+        int total = tilesX * tilesY;
+        while (true) {
+            int t = nextTile.fetch_add(1);
+            if (t >= total) return;
+            rasterTile(t);
+        }
+    }
+
+    void rasterTile(int t) {
+        const int tx0 = (t % tilesX) * tile, ty0 = (t / tilesX) * tile;
+        const int tx1 = std::min(tx0 + tile, w), ty1 = std::min(ty0 + tile, h); // Exclusive
+        uint32_t* pix = fb.get();
+
+        for (int y = ty0; y < ty1; ++y) {
+            std::fill(pix + (size_t)y * w + tx0, pix + (size_t)y * w + tx1, clearColor);
+        }
+
+        size_t spriteCursor = 0;
+        for (int idx : bins[t]) {
+            const DrawCmd &c = (*list)[idx];
+            const float* v = c.v;
+            uint32_t color = packColor(c.rgb);
+            auto plot = [&](int x, int y) {
+                if (x >= tx0 && x < tx1 && y >= ty0 && y < ty1) pix[(size_t)y * w + x] = color;
+            };
+            auto span = [&](int y, int xa, int xb) { // Inclusive xa..xb
+                if (y < ty0 || y >= ty1) return;
+                xa = std::max(xa, tx0);
+                xb = std::min(xb, tx1 - 1);
+                if (xa <= xb) std::fill(pix + (size_t)y * w + xa, pix + (size_t)y * w + xb + 1, color);
+            };
+
+            switch (c.kind) {
+                case DRAW_QUAD:
+                    rasterQuad(v, std::max(c.by0, ty0), std::min(c.by1, ty1 - 1), span);
+                    break;
+                case DRAW_GRADIENT_RECT: {
+                    // Same center-sampling rule as rasterQuad, without the edge walk
+                    int xa = (int)ceilf(v[0] - 0.5f), xb = (int)ceilf(v[2] - 0.5f) - 1;
+                    int ya = std::max((int)ceilf(v[1] - 0.5f), ty0);
+                    int yb = std::min((int)ceilf(v[3] - 0.5f) - 1, ty1 - 1);
+                    for (int y = ya; y <= yb; ++y) {
+                        color = gradientRows[prepass[idx].first + y];
+                        span(y, xa, xb);
+                    }
+                    break;
+                }
+                case DRAW_LINE_DDA:
+                case DRAW_LINE_BRESENHAM:
+                    for (int k = prepass[idx].first; k < prepass[idx].second; ++k) {
+                        plot(linePixels[k].x, linePixels[k].y);
+                    }
+                    break;
+                case DRAW_FILLED_CIRCLE:
+                    rasterFilledCircle((int)v[0], (int)v[1], (int)v[2], span);
+                    break;
+                case DRAW_POINT:
+                    plot((int)v[0], (int)v[1]);
+                    break;
+                case DRAW_PARTICLES: {
+                    const std::vector<int> &sprites = spriteBins[t];
+                    const int end = (int)v[0] + (int)v[1];
+                    const float* xy = list->particleXY();
+                    const uint32_t* rgba = list->particleRgba();
+                    for (; spriteCursor < sprites.size() && sprites[spriteCursor] < end; ++spriteCursor) {
+                        int s = sprites[spriteCursor];
+                        int xa, xb, ya, yb;
+                        spriteSpan(xy[2 * s], v[2], xa, xb);
+                        spriteSpan(xy[2 * s + 1], v[2], ya, yb);
+                        xa = std::max(xa, tx0); xb = std::min(xb, tx1 - 1);
+                        ya = std::max(ya, ty0); yb = std::min(yb, ty1 - 1);
+                        for (int y = ya; y <= yb; ++y) {
+                            uint32_t* row = pix + (size_t)y * w;
+                            for (int x = xa; x <= xb; ++x) row[x] = addSaturate(row[x], rgba[s]);
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+
+        // Lighting layer over the finished tile
+        for (int idx : lightBins[t]) {
+            compositeLight(pix, w, tx0, ty0, tx1, ty1, list->lightAt(idx), simd);
+        }
+    }
+
+    // Convex quad by scanline: a pixel is covered when its center lies inside
+    template <typename Span>
+    static void rasterQuad(const float* v, int yFirst, int yLast, Span span) {
+        for (int y = yFirst; y <= yLast; ++y) {
+            float yc = y + 0.5f;
+            float xl = 1e30f, xr = -1e30f;
+            for (int e = 0; e < 4; ++e) {
+                float ax = v[e * 2], ay = v[e * 2 + 1];
+                float bx = v[(e * 2 + 2) % 8], by = v[(e * 2 + 3) % 8];
+                if ((ay <= yc && yc < by) || (by <= yc && yc < ay)) {
+                    float x = ax + (yc - ay) * (bx - ax) / (by - ay);
+                    xl = std::min(xl, x);
+                    xr = std::max(xr, x);
+                }
+            }
+            if (xl < xr) span(y, (int)ceilf(xl - 0.5f), (int)ceilf(xr - 0.5f) - 1);
+        }
+    }
+
+    int w, h, tile;
+    bool simd;
+    int tilesX, tilesY;
+    std::unique_ptr<uint32_t[]> fb;
+    std::vector<std::vector<int>> bins;
+    std::vector<std::vector<int>> lightBins;
+    std::vector<std::vector<int>> spriteBins;  // Sprite indices per tile, submit order
+    bool lighting = true;
+    struct LinePixel { int16_t x, y; };
+    std::vector<LinePixel> linePixels;
+    std::vector<uint32_t> gradientRows;
+    std::vector<std::pair<int,int>> prepass;   // Per command: line [first, last), gradient row base
+    const DrawList* list;
+    uint32_t clearColor = 0;
+    double binUs = 0.0, rasterUs = 0.0;
+
+    int threadCount;
+    std::vector<std::thread> workers;
+    std::atomic<int> nextTile;
+    std::mutex mtx;
+    std::condition_variable startCv;
+    std::condition_variable doneCv;
+    int generation;
+    int pending;
+    bool stopping;
+};
+
+const int RASTER_TILE = 64;
+const float CLEAR_RGB[3] = {0.04f, 0.04f, 0.14f}; // Matches glClearColor in init()
+
+// Windowed game: scene list for this frame, and the software path when enabled
+DrawList sceneList;
+std::unique_ptr<TileRasterizer> softwareRaster;
+int softwareRasterThreads = 0;      // --software-render [N]; 0 = GL path
+bool nightLighting = true;          // N toggles the lighting layer
+
+// ==================== RESOLUTION SCALING ====================
+// The scene can be drawn at an internal resolution below the window's and
+// scaled up afterwards, so fill cost falls with the square of the scale. The
+// software path upscales on the CPU: pixels are replicated when the window
+// is an exact multiple of the internal size, bilinear otherwise. The GL path
+// copies the smaller viewport into a texture and stretches it. Gameplay and
+// HUD coordinates stay WIDTH x HEIGHT whatever the window size.
+
+const float MIN_RENDER_SCALE = 0.5f;
+const double FRAME_BUDGET_MS = 12.0; // Render share of the 16 ms tick
+
+// Bilinear blend of two RGBA8 pixels, f in [0, 255] toward q. Red/blue and
+// green/alpha go through as 16-bit lanes; a lane peaks at 255 * 256, so it
+// never carries into its neighbour.
+static inline uint32_t lerpPixel(uint32_t p, uint32_t q, uint32_t f) {
+    uint32_t g = 256 - f;
+    uint32_t rb = (((p & 0x00FF00FFu) * g + (q & 0x00FF00FFu) * f) >> 8) & 0x00FF00FFu;
+    uint32_t ga = ((((p >> 8) & 0x00FF00FFu) * g + ((q >> 8) & 0x00FF00FFu) * f)) & 0xFF00FF00u;
+    return rb | ga;
+}
+
+// Source -> destination sample tables are built when the sizes change. A
+// frame scales each needed source row horizontally once (two scratch rows,
+// reused while consecutive output rows sample the same pair), then blends
+// each output row vertically at full width. The SSE2 paths use the same
+// integer arithmetic as lerpPixel, so both agree bit for bit.
+class Upscaler {
+public:
+    void configure(int srcW, int srcH, int dstW, int dstH) {
+        if (srcW == sw && srcH == sh && dstW == dw && dstH == dh) return;
+        sw = srcW; sh = srcH; dw = dstW; dh = dstH;
+        integer = dw % sw == 0 && dh % sh == 0;
+        out.reset(new uint32_t[(size_t)dw * dh]);
+        rows.reset(new uint32_t[2 * (size_t)dw]);
+        sampleAxis(sw, dw, colIndex, colWeight);
+        sampleAxis(sh, dh, rowIndex, rowWeight);
+        // Per column: (256 - f, f) repeated per channel, matching the
+        // left/right byte interleave the SSE2 pass builds
+        colLanes.resize(8 * (size_t)dw);
+        pairCols = 0;
+        for (int x = 0; x < dw; ++x) {
+            for (int k = 0; k < 4; ++k) {
+                colLanes[8 * x + 2 * k] = (uint16_t)(256 - colWeight[x]);
+                colLanes[8 * x + 2 * k + 1] = (uint16_t)colWeight[x];
+            }
+            if (colIndex[x] + 1 < sw) pairCols = x + 1; // Right neighbour is in the row
+        }
+    }
+
+    const uint32_t* run(const uint32_t* src, bool useSimd = true) {
+        if (integer) replicate(src, useSimd);
+        else bilinear(src, useSimd);
+        return out.get();
+    }
+
+    bool isInteger() const { return integer; }
+    int width() const { return dw; }
+    int height() const { return dh; }
+
+private:
+    // Pixel centers line up: source coordinate (d + 0.5) * src / dst - 0.5
+    static void sampleAxis(int src, int dst, std::vector<int> &index, std::vector<uint32_t> &weight) {
+        index.resize(dst);
+        weight.resize(dst);
+        for (int d = 0; d < dst; ++d) {
+            float f = std::max(0.0f, (d + 0.5f) * src / dst - 0.5f);
+            int i = (int)f;
+            int w = (int)lrintf((f - i) * 256.0f);
+            if (w == 256) { i++; w = 0; }
+            if (i >= src - 1) { i = src - 1; w = 0; }
+            index[d] = i;
+            weight[d] = (uint32_t)w;
+        }
+    }
+
+    void replicate(const uint32_t* src, bool useSimd) {
+        const int kx = dw / sw, ky = dh / sh;
+        for (int y = 0; y < sh; ++y) {
+            const uint32_t* s = src + (size_t)y * sw;
+            uint32_t* d = out.get() + (size_t)y * ky * dw;
+            int x = 0;
+#ifdef NHP_SSE2
+            if (useSimd && kx == 2) {
+                for (; x + 4 <= sw; x += 4) {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(s + x));
+                    _mm_storeu_si128((__m128i*)(d + 2 * x), _mm_unpacklo_epi32(v, v));
+                    _mm_storeu_si128((__m128i*)(d + 2 * x + 4), _mm_unpackhi_epi32(v, v));
+                }
+            }
+#else
+            (void)useSimd;
+#endif
+            for (; x < sw; ++x) {
+                for (int k = 0; k < kx; ++k) d[x * kx + k] = s[x];
+            }
+            for (int k = 1; k < ky; ++k) memcpy(d + (size_t)k * dw, d, sizeof(uint32_t) * dw);
+        }
+    }
+
+    // Source row i scaled to the output width, cached in scratch row i & 1
+    const uint32_t* scaledRow(const uint32_t* src, int i, bool useSimd) {
+        uint32_t* r = rows.get() + (size_t)(i & 1) * dw;
+        if (cachedRow[i & 1] == i) return r;
+        cachedRow[i & 1] = i;
+        const uint32_t* s = src + (size_t)i * sw;
+        int x = 0;
+#ifdef NHP_SSE2
+        if (useSimd) {
+            // Four output pixels per step. Each loads its left/right pair as
+            // 64 bits, interleaves the two pixels' bytes per channel and lets
+            // one multiply-add produce the four channel sums.
+            const __m128i zero = _mm_setzero_si128();
+            auto blend = [&](int c) {
+                __m128i lr = _mm_loadl_epi64((const __m128i*)(s + colIndex[c]));
+                __m128i mixed = _mm_unpacklo_epi8(_mm_unpacklo_epi8(lr, _mm_srli_si128(lr, 4)), zero);
+                return _mm_srli_epi32(_mm_madd_epi16(mixed, _mm_loadu_si128((const __m128i*)&colLanes[8 * c])), 8);
+            };
+            for (; x + 4 <= pairCols; x += 4) {
+                __m128i lo = _mm_packs_epi32(blend(x), blend(x + 1));
+                __m128i hi = _mm_packs_epi32(blend(x + 2), blend(x + 3));
+                _mm_storeu_si128((__m128i*)(r + x), _mm_packus_epi16(lo, hi));
+            }
+        }
+#endif
+        for (; x < dw; ++x) r[x] = lerpPixel(s[colIndex[x]], s[std::min(colIndex[x] + 1, sw - 1)], colWeight[x]);
+        return r;
+    }
+
+    void bilinear(const uint32_t* src, bool useSimd) {
+        cachedRow[0] = cachedRow[1] = -1; // New frame
+        for (int y = 0; y < dh; ++y) {
+            const uint32_t* a = scaledRow(src, rowIndex[y], useSimd);
+            const uint32_t* b = scaledRow(src, std::min(rowIndex[y] + 1, sh - 1), useSimd);
+            const uint32_t fy = rowWeight[y];
+            uint32_t* d = out.get() + (size_t)y * dw;
+            int x = 0;
+#ifdef NHP_SSE2
+            if (useSimd) {
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i wa = _mm_set1_epi16((short)(256 - fy)), wb = _mm_set1_epi16((short)fy);
+                for (; x + 4 <= dw; x += 4) {
+                    __m128i pa = _mm_loadu_si128((const __m128i*)(a + x));
+                    __m128i pb = _mm_loadu_si128((const __m128i*)(b + x));
+                    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pa, zero), wa),
+                                               _mm_mullo_epi16(_mm_unpacklo_epi8(pb, zero), wb));
+                    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pa, zero), wa),
+                                               _mm_mullo_epi16(_mm_unpackhi_epi8(pb, zero), wb));
+                    __m128i v = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+                    _mm_storeu_si128((__m128i*)(d + x), v);
+                }
+            }
+#endif
+            for (; x < dw; ++x) d[x] = lerpPixel(a[x], b[x], fy);
+        }
+    }
+
+    int sw = 0, sh = 0, dw = 0, dh = 0;
+    bool integer = false;
+    int pairCols = 0;                   // Leading output columns whose pair lies inside the row
+    int cachedRow[2] = {-1, -1};
+    std::unique_ptr<uint32_t[]> out;
+    std::unique_ptr<uint32_t[]> rows;   // Two horizontally scaled source rows
+    std::vector<int> colIndex, rowIndex;
+    std::vector<uint32_t> colWeight, rowWeight;
+    std::vector<uint16_t> colLanes;
+};
+
+// Automatic mode. Frame time is not proportional to pixel count: a bilinear
+// upscale costs about as much as the raster it saves until the scale gets
+// low, so 87.5% and 75% can be slower than native. The governor therefore
+// keeps the measured average per scale level and decides from that table:
+// over budget it drops to the finest level measured inside the budget, or
+// straight to the coarsest (always the cheapest) when none is known; with
+// long headroom it returns to the finest level measured inside the budget,
+// probing native first and otherwise an unmeasured level one step up. A level measured slower
+// than native is never chosen. Entries expire, so a lighter scene can earn
+// back a finer level.
+const float RENDER_SCALES[] = {1.0f, 0.875f, 0.75f, 0.625f, 0.5f};
+const int RENDER_SCALE_LEVELS = 5;
+const int SCALE_SETTLE_FRAMES = 30;  // Frames at a level before its average counts
+const int SCALE_TABLE_FRAMES = 1800; // About 30 s; older entries are measured again
+
+class RenderScaleGovernor {
+public:
+    bool enabled = false;
+    float scale = 1.0f;
+    float maxScale = 1.0f;
+
+    // Returns true when the scale changed
+    bool onFrame(double ms) {
+        if (!enabled) return false;
+        if (levelCount == 0) buildLevels();
+        frame++;
+        avgMs = avgMs <= 0.0 ? ms : avgMs + (ms - avgMs) * 0.1;
+        if (++settled >= SCALE_SETTLE_FRAMES) {
+            measuredMs[level] = avgMs;
+            measuredAt[level] = frame;
+        }
+        if (avgMs > FRAME_BUDGET_MS) { overFrames++; underFrames = 0; }
+        else if (avgMs < FRAME_BUDGET_MS * 0.5) { underFrames++; overFrames = 0; }
+        else { overFrames = 0; underFrames = 0; }
+
+        int next = level;
+        if (overFrames >= 15) next = fasterLevel();
+        else if (underFrames >= 120) next = finerLevel();
+        else return false;
+        overFrames = 0;
+        underFrames = 0;
+        if (next == level) return false;
+        level = next;
+        scale = levels[level];
+        avgMs = 0.0; // Measure the new size from scratch
+        settled = 0;
+        return true;
+    }
+
+private:
+    // Level 0 is maxScale, then every table scale below it
+    void buildLevels() {
+        levels[levelCount++] = maxScale;
+        for (float s : RENDER_SCALES) {
+            if (s < maxScale - 1e-3f) levels[levelCount++] = s;
+        }
+        level = 0;
+        scale = maxScale;
+    }
+
+    bool known(int k) const { return measuredAt[k] > 0 && frame - measuredAt[k] < SCALE_TABLE_FRAMES; }
+
+    // Usable: measured inside the budget and not slower than native
+    bool usable(int k) const {
+        return known(k) && measuredMs[k] <= FRAME_BUDGET_MS && !(k > 0 && known(0) && measuredMs[k] >= measuredMs[0]);
+    }
+
+    int fasterLevel() const {
+        for (int k = level + 1; k < levelCount; ++k) {
+            if (usable(k)) return k;
+        }
+        return levelCount - 1;
+    }
+
+    int finerLevel() const {
+        if (!known(0)) return 0; // Native is the reference; measure it first
+        for (int k = 0; k < level; ++k) {
+            if (usable(k)) return k;
+        }
+        int probe = level - 1; // One step up, unless it is known to be no good
+        return probe >= 0 && !known(probe) ? probe : level;
+    }
+
+    float levels[RENDER_SCALE_LEVELS + 1] = {};
+    int levelCount = 0, level = 0;
+    double measuredMs[RENDER_SCALE_LEVELS + 1] = {};
+    long long measuredAt[RENDER_SCALE_LEVELS + 1] = {};
+    long long frame = 0;
+    double avgMs = 0.0;
+    int settled = 0;
+    int overFrames = 0, underFrames = 0;
+};
+
+// Window area the game occupies: the largest WIDTH:HEIGHT rect that fits,
+// centered (letterbox or pillarbox bars around it)
+struct ScreenArea {
+    int x, y, w, h;
+};
+
+ScreenArea fitScreenArea(int windowW, int windowH) {
+    int w = windowW, h = windowW * HEIGHT / WIDTH;
+    if (h > windowH) {
+        h = windowH;
+        w = windowH * WIDTH / HEIGHT;
+    }
+    return {(windowW - w) / 2, (windowH - h) / 2, std::max(1, w), std::max(1, h)};
+}
+
+int windowW = WIDTH, windowH = HEIGHT;
+ScreenArea screenArea = {0, 0, WIDTH, HEIGHT};
+int renderW = WIDTH, renderH = HEIGHT; // Internal resolution
+RenderScaleGovernor renderScale;       // --render-scale PCT | auto
+Upscaler upscaler;
+GLuint sceneTexture = 0;               // GL path: internal-resolution copy
+int sceneTextureW = 0, sceneTextureH = 0;
+
+// Re-derives the internal resolution from the area and scale; reallocates
+// only what changed size (rasterizer, upscaler, scene texture)
+void applyRenderSize() {
+    renderW = std::max(1, (int)lrintf(screenArea.w * renderScale.scale));
+    renderH = std::max(1, (int)lrintf(screenArea.h * renderScale.scale));
+    glPointScale = std::max(1.0f, floorf((float)renderW / WIDTH + 0.5f));
+    if (softwareRasterThreads > 0) {
+        if (!softwareRaster || softwareRaster->width() != renderW || softwareRaster->height() != renderH) {
+            softwareRaster.reset(new TileRasterizer(renderW, renderH, RASTER_TILE, softwareRasterThreads));
+        }
+        upscaler.configure(renderW, renderH, screenArea.w, screenArea.h);
+        return;
+    }
+    if (renderW == screenArea.w && renderH == screenArea.h) return;
+    // Power-of-two texture for old GL; only the render-sized corner is used
+    int tw = 1, th = 1;
+    while (tw < renderW) tw <<= 1;
+    while (th < renderH) th <<= 1;
+    if (!sceneTexture) glGenTextures(1, &sceneTexture);
+    glBindTexture(GL_TEXTURE_2D, sceneTexture);
+    if (tw != sceneTextureW || th != sceneTextureH) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tw, th, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        sceneTextureW = tw;
+        sceneTextureH = th;
+    }
+    bool exact = screenArea.w % renderW == 0 && screenArea.h % renderH == 0;
+    GLint filter = exact ? GL_NEAREST : GL_LINEAR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// GL path: the scene was drawn into the bottom-left renderW x renderH of the
+// area; copy it out of the back buffer and stretch it over the whole area
+void stretchSceneGl() {
+    glBindTexture(GL_TEXTURE_2D, sceneTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, screenArea.x, screenArea.y, renderW, renderH);
+    glViewport(screenArea.x, screenArea.y, screenArea.w, screenArea.h);
+    float u = (float)renderW / sceneTextureW, v = (float)renderH / sceneTextureH;
+    glEnable(GL_TEXTURE_2D);
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0, 0); glVertex2f(0, 0);
+    glTexCoord2f(u, 0); glVertex2f(WIDTH, 0);
+    glTexCoord2f(u, v); glVertex2f(WIDTH, HEIGHT);
+    glTexCoord2f(0, v); glVertex2f(0, HEIGHT);
+    glEnd();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+}
+
+// ==================== PARTICLES ====================
+// Cosmetic particles: crash sparks, catch bursts and exhaust. A pool is a
+// fixed-capacity structure of arrays kept dense (a dead particle is replaced
+// by the last live one), so integration always streams over [0, count) four
+// lanes at a time. The blend is additive, so draw order within a pool does
+// not show. Effects read the world's per-tick events and have their own RNG:
+// they never feed back into the simulation.
+
+const float PARTICLE_DT = 16.0f / 1000.0f;   // One simulation tick
+const float PARTICLE_KILL_Y = -8.0f;         // Scrolled off the bottom edge
+
+class ParticlePool {
+public:
+    ParticlePool(int cap, float sizePx, float dragPerSecond)
+        : capacity(cap), pointSize(sizePx), drag(dragPerSecond), count(0), dropped(0),
+          px(new float[cap]), py(new float[cap]), pvx(new float[cap]), pvy(new float[cap]),
+          plife(new float[cap]), pinvLife(new float[cap]), pcolor(new uint32_t[cap]) {}
+
+    // Full pool: the particle is dropped (capacity is the budget)
+    bool spawn(float x, float y, float vx, float vy, float life, uint32_t rgb) {
+        if (count >= capacity || life <= 0.0f) {
+            dropped++;
+            return false;
+        }
+        px[count] = x; py[count] = y;
+        pvx[count] = vx; pvy[count] = vy;
+        plife[count] = life; pinvLife[count] = 1.0f / life;
+        pcolor[count] = rgb;
+        count++;
+        return true;
+    }
+
+    // Drag, move, scroll with the road and age by dt; then drop the dead
+    void update(float dt, float scrollY, bool useSimd = true) {
+        const float keep = std::max(0.0f, 1.0f - drag * dt);
+        bool anyDead = false;
+        int i = 0;
+#ifdef NHP_SSE2
+        if (useSimd) {
+            const __m128 keepv = _mm_set1_ps(keep), dtv = _mm_set1_ps(dt);
+            const __m128 scrollv = _mm_set1_ps(scrollY), killY = _mm_set1_ps(PARTICLE_KILL_Y);
+            const __m128 zero = _mm_setzero_ps();
+            __m128 dead = zero;
+            for (; i + 4 <= count; i += 4) {
+                __m128 vx = _mm_mul_ps(_mm_loadu_ps(pvx.get() + i), keepv);
+                __m128 vy = _mm_mul_ps(_mm_loadu_ps(pvy.get() + i), keepv);
+                __m128 x = _mm_add_ps(_mm_loadu_ps(px.get() + i), _mm_mul_ps(vx, dtv));
+                __m128 y = _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(py.get() + i), _mm_mul_ps(vy, dtv)), scrollv);
+                __m128 life = _mm_sub_ps(_mm_loadu_ps(plife.get() + i), dtv);
+                life = _mm_and_ps(life, _mm_cmpge_ps(y, killY));
+                dead = _mm_or_ps(dead, _mm_cmple_ps(life, zero));
+                _mm_storeu_ps(pvx.get() + i, vx);
+                _mm_storeu_ps(pvy.get() + i, vy);
+                _mm_storeu_ps(px.get() + i, x);
+                _mm_storeu_ps(py.get() + i, y);
+                _mm_storeu_ps(plife.get() + i, life);
+            }
+            anyDead = _mm_movemask_ps(dead) != 0;
+        }
+#else
+        (void)useSimd;
+#endif
+        for (; i < count; ++i) {
+            pvx[i] *= keep;
+            pvy[i] *= keep;
+            px[i] += pvx[i] * dt;
+            py[i] = (py[i] + pvy[i] * dt) - scrollY;
+            plife[i] -= dt;
+            if (!(py[i] >= PARTICLE_KILL_Y)) plife[i] = 0.0f;
+            if (plife[i] <= 0.0f) anyDead = true;
+        }
+        if (anyDead) compact();
+    }
+
+    // One batch per pool, faded by remaining life
+    void emit(DrawList &dl) const {
+        ParticleBatch b = dl.particles(count, pointSize);
+        for (int i = 0; i < b.count; ++i) {
+            uint32_t f = (uint32_t)(plife[i] * pinvLife[i] * 256.0f);
+            uint32_t c = pcolor[i];
+            uint32_t r = ((c & 0xFFu) * f) >> 8;
+            uint32_t g = (((c >> 8) & 0xFFu) * f) >> 8;
+            uint32_t bl = (((c >> 16) & 0xFFu) * f) >> 8;
+            float x, y;
+            projectPoint(px[i], py[i], x, y);
+            b.xy[2 * i] = x * b.scaleX;
+            b.xy[2 * i + 1] = y * b.scaleY;
+            b.rgba[i] = r | (g << 8) | (bl << 16) | 0xFF000000u;
+        }
+    }
+
+    void clear() { count = 0; }
+    int live() const { return count; }
+    int droppedCount() const { return dropped; }
+
+private:
+    void compact() {
+        int n = count;
+        for (int k = 0; k < n;) {
+            if (plife[k] > 0.0f) {
+                ++k;
+                continue;
+            }
+            --n;
+            px[k] = px[n]; py[k] = py[n];
+            pvx[k] = pvx[n]; pvy[k] = pvy[n];
+            plife[k] = plife[n]; pinvLife[k] = pinvLife[n];
+            pcolor[k] = pcolor[n];
+        }
+        count = n;
+    }
+
+    int capacity;
+    float pointSize;
+    float drag;
+    int count;
+    int dropped;
+    std::unique_ptr<float[]> px, py, pvx, pvy, plife, pinvLife;
+    std::unique_ptr<uint32_t[]> pcolor;
+};
+
+constexpr uint32_t rgb8(int r, int g, int b) {
+    return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16);
+}
+
+// The windowed game's effects: one pool of sparks and one of exhaust smoke
+class ParticleEffects {
+public:
+    ParticleEffects() : sparks(16384, 2.0f, 2.5f), smoke(8192, 4.0f, 1.0f), rng(0x9E3779B9u), ticks(0) {}
+
+    // Bursts for the world's events of this tick, exhaust behind every car,
+    // then one integration step. Frozen while the world is paused.
+    void tick(const GameWorld &w) {
+        if (w.paused) return;
+        for (int k = 0; k < w.eventCount; ++k) {
+            const WorldEvent &ev = w.events[k];
+            if (ev.kind == EVENT_CATCH) {
+                static const uint32_t CATCH[4] = {rgb8(255, 220, 90), rgb8(255, 255, 255),
+                                                  rgb8(80, 140, 255), rgb8(255, 60, 60)};
+                burst(sparks, ev.x, ev.y, 90, 60.0f, 260.0f, 0.4f, 0.9f, CATCH, 4);
+            } else if (ev.kind == EVENT_CRASH) {
+                static const uint32_t SPARK[3] = {rgb8(255, 170, 40), rgb8(255, 230, 120),
+                                                  rgb8(255, 255, 230)};
+                static const uint32_t DUST[1] = {rgb8(70, 70, 80)};
+                burst(sparks, ev.x, ev.y, 260, 80.0f, 420.0f, 0.5f, 1.4f, SPARK, 3);
+                burst(smoke, ev.x, ev.y, 40, 10.0f, 60.0f, 0.8f, 1.6f, DUST, 1);
+            }
+        }
+
+        // A puff from each car every third tick, drifting back from the bumper
+        if (!w.gameOver && ticks++ % 3 == 0) {
+            const EntityStore &e = w.ents;
+            for (int i = 0; i < e.count; ++i) {
+                if (e.role[i] == ROLE_NONE || e.y[i] < -40.0f || e.y[i] > HEIGHT) continue;
+                float side = (nextFloat() < 0.5f ? -0.25f : 0.25f) * e.width[i];
+                smoke.spawn(e.x[i] + side, e.y[i], (nextFloat() - 0.5f) * 20.0f,
+                            -20.0f - 20.0f * nextFloat(), 0.5f + 0.3f * nextFloat(), rgb8(40, 40, 48));
+            }
+        }
+
+        // Particles sit on the road, which scrolls down unless the run is over
+        float scroll = w.gameOver ? 0.0f : ROAD_SCROLL * w.gameSpeed;
+        sparks.update(PARTICLE_DT, scroll);
+        smoke.update(PARTICLE_DT, scroll);
+    }
+
+    void emit(DrawList &dl) const {
+        smoke.emit(dl);
+        sparks.emit(dl);
+    }
+
+    void clear() {
+        sparks.clear();
+        smoke.clear();
+    }
+
+    int live() const { return sparks.live() + smoke.live(); }
+
+private:
+    float nextFloat() {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return (rng >> 8) / 16777216.0f;
+    }
+
+    // n particles flying out in all directions at speeds in [vMin, vMax]
+    void burst(ParticlePool &pool, float x, float y, int n, float vMin, float vMax,
+               float lifeMin, float lifeMax, const uint32_t* palette, int paletteSize) {
+        for (int k = 0; k < n; ++k) {
+            float angle = nextFloat() * 6.2831853f;
+            float speed = vMin + (vMax - vMin) * nextFloat();
+            float life = lifeMin + (lifeMax - lifeMin) * nextFloat();
+            uint32_t color = palette[(int)(nextFloat() * paletteSize) % paletteSize];
+            pool.spawn(x, y, cosf(angle) * speed, sinf(angle) * speed, life, color);
+        }
+    }
+
+    ParticlePool sparks;
+    ParticlePool smoke;
+    uint32_t rng;
+    unsigned ticks;
+};
+
+ParticleEffects effects;
+
+// ==================== DRAWING FUNCTIONS ====================
+
+// Perspective road: bands narrowing toward the vanishing point, darker with
+// distance, and edge lines converging on it
+void drawRoadPerspective(DrawList &dl) {
+    const int bands = 24;
+    const int rows = (int)view.rowScale.size() - 1;
+    for (int b = 0; b < bands; ++b) {
+        int r0 = rows * b / bands;
+        int r1 = rows * (b + 1) / bands;
+        float s0 = view.rowScale[r0], s1 = view.rowScale[r1];
+        float shade = 0.35f + 0.65f * s0;
+        dl.color(0.18f * shade, 0.18f * shade, 0.22f * shade);
+        dl.quad(view.vpX + (ROAD_LEFT - LANE_CENTER) * s0, (float)r0,
+                view.vpX + (ROAD_RIGHT - LANE_CENTER) * s0, (float)r0,
+                view.vpX + (ROAD_RIGHT - LANE_CENTER) * s1, (float)r1,
+                view.vpX + (ROAD_LEFT - LANE_CENTER) * s1, (float)r1);
+    }
+
+    dl.color(1.0f, 1.0f, 1.0f);
+    dl.lineDDA(view.vpX + (ROAD_LEFT - LANE_CENTER), 0, view.vpX, view.horizon);
+    dl.lineDDA(view.vpX + (ROAD_RIGHT - LANE_CENTER), 0, view.vpX, view.horizon);
+    dl.color(1.0f, 0.9f, 0.1f);
+    dl.lineDDA(view.vpX + (ROAD_LEFT + 3 - LANE_CENTER), 0, view.vpX, view.horizon);
+    dl.lineDDA(view.vpX + (ROAD_RIGHT - 3 - LANE_CENTER), 0, view.vpX, view.horizon);
+}
+
+void drawRoad(DrawList &dl) {
+    if (view.enabled) {
+        drawRoadPerspective(dl);
+        return;
+    }
+
+    // Gradient road
+    dl.gradientRect(ROAD_LEFT, 0, ROAD_RIGHT, HEIGHT,
+                    0.18f, 0.18f, 0.22f, 0.12f, 0.12f, 0.16f);
+
+    // Road boundaries (DDA)
+    dl.color(1.0f, 1.0f, 1.0f);
+    dl.lineDDA(ROAD_LEFT, 0, ROAD_LEFT, HEIGHT);
+    dl.lineDDA(ROAD_RIGHT, 0, ROAD_RIGHT, HEIGHT);
+
+    // Yellow edge lines
+    dl.color(1.0f, 0.9f, 0.1f);
+    dl.lineDDA(ROAD_LEFT + 3, 0, ROAD_LEFT + 3, HEIGHT);
+    dl.lineDDA(ROAD_RIGHT - 3, 0, ROAD_RIGHT - 3, HEIGHT);
+}
+
+// Road-space quad through the view projection
+static void roadQuad(DrawList &dl, float x0, float y0, float x1, float y1,
+                     float x2, float y2, float x3, float y3) {
+    projectPoint(x0, y0, x0, y0);
+    projectPoint(x1, y1, x1, y1);
+    projectPoint(x2, y2, x2, y2);
+    projectPoint(x3, y3, x3, y3);
+    dl.quad(x0, y0, x1, y1, x2, y2, x3, y3);
+}
+
+// Per-segment road paint and roadside scenery for the visible part of the stream
+void drawRoadSegments(DrawList &dl, const RoadStream &r) {
+    const float laneWidth = (ROAD_RIGHT - ROAD_LEFT) / (float)LANE_COUNT;
+    const float farY = view.enabled ? (float)DEPTH_LUT_MAX : (float)HEIGHT;
+
+    for (int k = 0; k < SEGMENT_POOL; ++k) {
+        const RoadSegment &seg = r.pool[k];
+        double start = seg.index * (double)SEGMENT_LENGTH;
+        float y0 = (float)(start - r.distance);
+        if (y0 > farY || y0 + SEGMENT_LENGTH < -40.0f) continue;
+
+        // Lane markers (dashes keep their spacing across segment joins)
+        dl.color(1.0f, 0.95f, 0.3f);
+        double firstDash = ceil(start / DASH_SPACING) * DASH_SPACING;
+        for (double d = firstDash; d < start + SEGMENT_LENGTH; d += DASH_SPACING) {
+            float y = (float)(d - r.distance);
+            for (int lane = 0; lane < LANE_COUNT; lane += LANE_COUNT - 1) {
+                if (lane >= seg.laneCount) continue;
+                roadQuad(dl, LANE_X[lane] - 3, y,
+                         LANE_X[lane] + 3, y,
+                         LANE_X[lane] + 3, y + 32,
+                         LANE_X[lane] - 3, y + 32);
+            }
+        }
+
+        // Closed lanes: hatching and a row of cones along the open edge
+        if (seg.laneCount < LANE_COUNT) {
+            float left = ROAD_LEFT + laneWidth * seg.laneCount;
+            float right = ROAD_RIGHT - 6.0f;
+            dl.color(0.85f, 0.45f, 0.05f);
+            for (float y = y0; y < y0 + SEGMENT_LENGTH - 20.0f; y += 24.0f) {
+                float ax, ay, bx, by;
+                projectPoint(left, y, ax, ay);
+                projectPoint(right, y + 20.0f, bx, by);
+                dl.lineBresenham((int)ax, (int)ay, (int)bx, (int)by);
+            }
+            dl.color(1.0f, 0.5f, 0.0f);
+            for (float y = y0 + 10.0f; y < y0 + SEGMENT_LENGTH; y += 50.0f) {
+                float cx, cy;
+                projectPoint(left, y, cx, cy);
+                dl.filledCircle((int)cx, (int)cy, (int)std::max(1.0f, 4.0f * getScaleForY(y)));
+            }
+        }
+
+        // Exit ramp leaving the shoulder, with its sign
+        if (seg.exitSide >= 0) {
+            float edge = seg.exitSide == 0 ? ROAD_LEFT : ROAD_RIGHT;
+            float dir = seg.exitSide == 0 ? -1.0f : 1.0f;
+            dl.color(0.16f, 0.16f, 0.2f);
+            roadQuad(dl, edge, y0 + 80.0f,
+                     edge, y0 + 260.0f,
+                     edge + dir * 70.0f, y0 + 330.0f,
+                     edge + dir * 70.0f, y0 + 150.0f);
+            dl.color(0.05f, 0.45f, 0.15f);
+            roadQuad(dl, edge + dir * 8.0f, y0 + 40.0f,
+                     edge + dir * 48.0f, y0 + 40.0f,
+                     edge + dir * 48.0f, y0 + 58.0f,
+                     edge + dir * 8.0f, y0 + 58.0f);
+        }
+
+        // Street lights on both shoulders
+        float tint = (seg.lampTint % 4) * 0.05f;
+        dl.color(1.0f, 0.8f + tint, 0.45f + tint);
+        for (int i = 0; i < 8; ++i) {
+            if (!(seg.lightMask & (1 << i))) continue;
+            float x, y;
+            float s = getScaleForY(y0 + 50.0f + (i % 4) * 100.0f);
+            projectPoint(i < 4 ? ROAD_LEFT - 14.0f : ROAD_RIGHT + 14.0f,
+                         y0 + 50.0f + (i % 4) * 100.0f, x, y);
+            dl.filledCircle((int)x, (int)y, (int)std::max(1.0f, 3.0f * s));
+            dl.light(x, y, 48.0f * s, 0.28f);
+        }
+    }
+}
+
+void drawPoliceCar(DrawList &dl, const EntityStore &ents, int id) {
+    float px, py;
+    projectPoint(ents.x[id], ents.y[id], px, py);
+    const PoliceControl &pilot = ents.pilot[id];
+    float scale = getScaleForY(ents.y[id]);
+    float w = ents.width[id] * scale;
+    float h = ents.height[id] * scale;
+
+    // Body
+    dl.color(0.05f, 0.08f, 0.65f);
+    dl.quad(px - w/2, py,
+            px + w/2, py,
+            px + w/2, py + h * 0.65f,
+            px - w/2, py + h * 0.65f);
+
+    // Top cabin
+    dl.color(0.08f, 0.12f, 0.7f);
+    dl.quad(px - w * 0.35f, py + h * 0.65f,
+            px + w * 0.35f, py + h * 0.65f,
+            px + w * 0.3f, py + h,
+            px - w * 0.3f, py + h);
+
+    // Outline (Bresenham)
+    dl.color(1.0f, 1.0f, 1.0f);
+    int x1 = (int)roundf(px - w/2);
+    int x2 = (int)roundf(px + w/2);
+    int y1 = (int)roundf(py);
+    int y2 = (int)roundf(py + h);
+    dl.lineBresenham(x1, y1, x2, y1);
+    dl.lineBresenham(x2, y1, x2, y2);
+    dl.lineBresenham(x2, y2, x1, y2);
+    dl.lineBresenham(x1, y2, x1, y1);
+
+    // Windshield
+    dl.color(0.5f, 0.7f, 0.95f);
+    dl.quad(px - w * 0.28f, py + h * 0.68f,
+            px + w * 0.28f, py + h * 0.68f,
+            px + w * 0.25f, py + h * 0.9f,
+            px - w * 0.25f, py + h * 0.9f);
+
+    // Police stripe
+    dl.color(1.0f, 1.0f, 1.0f);
+    dl.quad(px - w * 0.4f, py + h * 0.42f,
+            px + w * 0.4f, py + h * 0.42f,
+            px + w * 0.4f, py + h * 0.48f,
+            px - w * 0.4f, py + h * 0.48f);
+
+    // Wheels (Midpoint Circle)
+    dl.color(0.08f, 0.08f, 0.08f);
+    int wheelRadius = (int)std::max(4.0f, 6.0f * scale);
+    dl.filledCircle((int)roundf(px - w * 0.35f), (int)roundf(py + h * 0.15f), wheelRadius);
+    dl.filledCircle((int)roundf(px + w * 0.35f), (int)roundf(py + h * 0.15f), wheelRadius);
+
+    // Headlight glow ahead of the car
+    dl.color(1.0f, 0.95f, 0.8f);
+    dl.light(px - w * 0.3f, py + h + 12.0f * scale, 36.0f * scale, 0.35f);
+    dl.light(px + w * 0.3f, py + h + 12.0f * scale, 36.0f * scale, 0.35f);
+
+    // Siren lights (alternating), each with a wide glow
+    if (pilot.sirenOn) {
+        float sirenY = py + h - 4.0f * scale;
+        if (pilot.sirenBlink == 0) {
+            dl.color(1.0f, 0.1f, 0.1f);
+            dl.filledCircle((int)roundf(px - w * 0.2f), (int)roundf(sirenY), (int)std::max(3.0f, 5.0f * scale));
+            dl.light(px - w * 0.2f, sirenY, 70.0f * scale, 0.7f);
+        } else {
+            dl.color(0.1f, 0.2f, 1.0f);
+            dl.filledCircle((int)roundf(px + w * 0.2f), (int)roundf(sirenY), (int)std::max(3.0f, 5.0f * scale));
+            dl.light(px + w * 0.2f, sirenY, 70.0f * scale, 0.7f);
+        }
+    }
+}
+
+void drawCivilianCar(DrawList &dl, const EntityStore &ents, int id) {
+    float cx, cy;
+    projectPoint(ents.x[id], ents.y[id], cx, cy);
+    float scale = getScaleForY(ents.y[id]);
+    float w = ents.width[id] * scale;
+    float h = ents.height[id] * scale;
+
+    // Color by type
+    switch(ents.color[id]) {
+        case 0: dl.color(0.05f, 0.45f, 0.8f); break;   // Blue
+        case 1: dl.color(0.05f, 0.65f, 0.2f); break;   // Green
+        case 2: dl.color(0.9f, 0.75f, 0.05f); break;   // Yellow
+        case 3: dl.color(0.65f, 0.25f, 0.75f); break;  // Purple
+        default: dl.color(0.85f, 0.35f, 0.15f); break; // Orange
+    }
+
+    // Body
+    dl.quad(cx - w/2, cy,
+            cx + w/2, cy,
+            cx + w/2, cy + h * 0.65f,
+            cx - w/2, cy + h * 0.65f);
+
+    // Top
+    dl.quad(cx - w * 0.35f, cy + h * 0.65f,
+            cx + w * 0.35f, cy + h * 0.65f,
+            cx + w * 0.3f, cy + h,
+            cx - w * 0.3f, cy + h);
+
+    // Wheels
+    dl.color(0.08f, 0.08f, 0.08f);
+    int wheelR = (int)std::max(2.0f, 5.0f * scale);
+    dl.filledCircle((int)roundf(cx - w * 0.35f), (int)roundf(cy + h * 0.15f), wheelR);
+    dl.filledCircle((int)roundf(cx + w * 0.35f), (int)roundf(cy + h * 0.15f), wheelR);
+
+    // Window
+    dl.color(0.25f, 0.3f, 0.4f);
+    dl.quad(cx - w * 0.25f, cy + h * 0.68f,
+            cx + w * 0.25f, cy + h * 0.68f,
+            cx + w * 0.22f, cy + h * 0.9f,
+            cx - w * 0.22f, cy + h * 0.9f);
+
+    // Bus special features
+    if (ents.render[id] == RENDER_BUS) {
+        dl.color(0.95f, 0.95f, 0.95f);
+        for (int i = 0; i < 3; ++i) {
+            float wx = cx - w * 0.3f + i * (w * 0.3f);
+            dl.quad(wx, cy + h * 0.5f,
+                    wx + w * 0.15f, cy + h * 0.5f,
+                    wx + w * 0.15f, cy + h * 0.62f,
+                    wx, cy + h * 0.62f);
+        }
+    }
+
+    // Tail lights
+    dl.color(0.7f, 0.05f, 0.05f);
+    dl.quad(cx - w * 0.38f, cy + h * 0.12f,
+            cx - w * 0.32f, cy + h * 0.12f,
+            cx - w * 0.32f, cy + h * 0.22f,
+            cx - w * 0.38f, cy + h * 0.22f);
+    dl.quad(cx + w * 0.32f, cy + h * 0.12f,
+            cx + w * 0.38f, cy + h * 0.12f,
+            cx + w * 0.38f, cy + h * 0.22f,
+            cx + w * 0.32f, cy + h * 0.22f);
+    dl.light(cx - w * 0.35f, cy + h * 0.17f, 16.0f * scale, 0.55f);
+    dl.light(cx + w * 0.35f, cy + h * 0.17f, 16.0f * scale, 0.55f);
+
+    // Headlight glow ahead of the car
+    dl.color(1.0f, 0.95f, 0.8f);
+    dl.light(cx - w * 0.3f, cy + h + 10.0f * scale, 30.0f * scale, 0.25f);
+    dl.light(cx + w * 0.3f, cy + h + 10.0f * scale, 30.0f * scale, 0.25f);
+}
+
+void drawCriminalCar(DrawList &dl, const EntityStore &ents, int id) {
+    float cx, cy;
+    projectPoint(ents.x[id], ents.y[id], cx, cy);
+    float scale = getScaleForY(ents.y[id]);
+    float w = ents.width[id] * scale;
+    float h = ents.height[id] * scale;
+
+    // Body (aggressive red)
+    dl.color(0.95f, 0.05f, 0.05f);
+    dl.quad(cx - w/2, cy,
+            cx + w/2, cy,
+            cx + w/2, cy + h * 0.65f,
+            cx - w/2, cy + h * 0.65f);
+
+    // Top
+    dl.color(0.8f, 0.05f, 0.05f);
+    dl.quad(cx - w * 0.35f, cy + h * 0.65f,
+            cx + w * 0.35f, cy + h * 0.65f,
+            cx + w * 0.3f, cy + h,
+            cx - w * 0.3f, cy + h);
+
+    // Racing stripes
+    dl.color(1.0f, 1.0f, 1.0f);
+    dl.quad(cx - 4 * scale, cy,
+            cx + 4 * scale, cy,
+            cx + 4 * scale, cy + h * 0.8f,
+            cx - 4 * scale, cy + h * 0.8f);
+
+    // Danger stripe
+    dl.color(1.0f, 1.0f, 0.0f);
+    dl.quad(cx - w * 0.4f, cy + h * 0.45f,
+            cx + w * 0.4f, cy + h * 0.45f,
+            cx + w * 0.4f, cy + h * 0.5f,
+            cx - w * 0.4f, cy + h * 0.5f);
+
+    // Wheels
+    dl.color(0.05f, 0.05f, 0.05f);
+    int wheelR = (int)std::max(3.0f, 6.0f * scale);
+    dl.filledCircle((int)roundf(cx - w * 0.35f), (int)roundf(cy + h * 0.15f), wheelR);
+    dl.filledCircle((int)roundf(cx + w * 0.35f), (int)roundf(cy + h * 0.15f), wheelR);
+
+    // Tinted window
+    dl.color(0.1f, 0.1f, 0.15f);
+    dl.quad(cx - w * 0.28f, cy + h * 0.68f,
+            cx + w * 0.28f, cy + h * 0.68f,
+            cx + w * 0.25f, cy + h * 0.9f,
+            cx - w * 0.25f, cy + h * 0.9f);
+
+    // Tail light glow and headlights
+    dl.color(1.0f, 0.1f, 0.05f);
+    dl.light(cx - w * 0.35f, cy + 3.0f * scale, 18.0f * scale, 0.6f);
+    dl.light(cx + w * 0.35f, cy + 3.0f * scale, 18.0f * scale, 0.6f);
+    dl.color(1.0f, 0.95f, 0.8f);
+    dl.light(cx - w * 0.3f, cy + h + 12.0f * scale, 36.0f * scale, 0.35f);
+    dl.light(cx + w * 0.3f, cy + h + 12.0f * scale, 36.0f * scale, 0.35f);
+}
+
+void drawBackground(DrawList &dl) {
+    // Gradient sky
+    dl.gradientRect(0, 0, WIDTH, HEIGHT,
+                    0.04f, 0.04f, 0.14f, 0.02f, 0.02f, 0.08f);
+
+    // Stars
+    dl.color(1.0f, 1.0f, 1.0f);
+    for (const auto &s : stars) {
+        dl.point(s.first, s.second);
+        dl.point(s.first + 1, s.second);
+        dl.point(s.first, s.second + 1);
+    }
+
+    // In perspective the skyline stands on the horizon at half size, above
+    // dark ground that fades into the distance
+    float base = 0.0f, k = 1.0f;
+    if (view.enabled) {
+        base = view.horizon;
+        k = 0.5f;
+        dl.gradientRect(0, 0, WIDTH, view.horizon,
+                        0.03f, 0.05f, 0.04f, 0.05f, 0.06f, 0.1f);
+    }
+
+    // Buildings (left side)
+    dl.color(0.08f, 0.08f, 0.14f);
+    for(int i = 0; i < 3; i++) {
+        int x = 30 + i * 60;
+        int h = 100 + (i % 3) * 80;
+        dl.quad(x, base,
+                x + 45, base,
+                x + 45, base + h * k,
+                x, base + h * k);
+
+        // Windows
+        dl.color(1.0f, 0.9f, 0.4f);
+        for(int j = 0; j < h/25; j++) {
+            if((i + j) % 3 != 0) {
+                float wy0 = base + (10 + j * 20) * k;
+                float wy1 = base + (16 + j * 20) * k;
+                dl.quad(x + 5, wy0,
+                        x + 15, wy0,
+                        x + 15, wy1,
+                        x + 5, wy1);
+                dl.quad(x + 25, wy0,
+                        x + 35, wy0,
+                        x + 35, wy1,
+                        x + 25, wy1);
+                dl.light(x + 10, base + (13 + j * 20) * k, 14.0f * k, 0.22f);
+                dl.light(x + 30, base + (13 + j * 20) * k, 14.0f * k, 0.22f);
+            }
+        }
+        dl.color(0.08f, 0.08f, 0.14f);
+    }
+
+    // Buildings (right side)
+    for(int i = 0; i < 3; i++) {
+        int x = WIDTH - 175 + i * 60;
+        int h = 120 + (i % 3) * 70;
+        dl.quad(x, base,
+                x + 45, base,
+                x + 45, base + h * k,
+                x, base + h * k);
+    }
+}
+
+// The whole world in painter's order (HUD text stays on GL in drawUI)
+void recordScene(DrawList &dl, const GameWorld &w, const ParticleEffects* fx = nullptr) {
+    dl.clear();
+    drawBackground(dl);
+    drawRoad(dl);
+    drawRoadSegments(dl, w.road);
+
+    const EntityStore &ents = w.ents;
+    ArenaScope scratch;
+    int* sorted = frameArena.alloc<int>(ents.count);
+
+    // In perspective every vehicle is depth-sorted, far to near
+    if (view.enabled) {
+        for (int i = 0; i < ents.count; ++i) sorted[i] = i;
+        std::sort(sorted, sorted + ents.count, [&ents](int a, int b) {
+            return ents.y[a] > ents.y[b];
+        });
+        for (int k = 0; k < ents.count; ++k) {
+            int i = sorted[k];
+            if (ents.role[i] == ROLE_CIVILIAN) drawCivilianCar(dl, ents, i);
+            else if (ents.role[i] == ROLE_CRIMINAL) drawCriminalCar(dl, ents, i);
+            else if (ents.role[i] == ROLE_POLICE) drawPoliceCar(dl, ents, i);
+        }
+        if (fx) fx->emit(dl);
+        return;
+    }
+
+    // Sort and draw civilians (back to front)
+    int sortedCount = 0;
+    for (int i = 0; i < ents.count; ++i) {
+        if (ents.role[i] == ROLE_CIVILIAN) sorted[sortedCount++] = i;
+    }
+    std::sort(sorted, sorted + sortedCount, [&ents](int a, int b) {
+        return ents.y[a] > ents.y[b];
+    });
+
+    for (int k = 0; k < sortedCount; ++k) {
+        drawCivilianCar(dl, ents, sorted[k]);
+    }
+
+    // Pursuit units on top: criminals, then police
+    for (int i = 0; i < ents.count; ++i) {
+        if (ents.role[i] == ROLE_CRIMINAL) drawCriminalCar(dl, ents, i);
+    }
+    for (int i = 0; i < ents.count; ++i) {
+        if (ents.role[i] == ROLE_POLICE) drawPoliceCar(dl, ents, i);
+    }
+
+    if (fx) fx->emit(dl);
+}
+
+void drawUI(const GameWorld &w) {
+    // Control panel (left)
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glRasterPos2i(10, HEIGHT - 20);
+    const char* title = "CONTROLS";
+    for(const char* c = title; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
+
+    glRasterPos2i(10, HEIGHT - 42);
+    const char* line1 = "Arrows: Move";
+    for(const char* c = line1; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+
+    glRasterPos2i(10, HEIGHT - 60);
+    const char* line2 = "S: Siren | P: Pause";
+    for(const char* c = line2; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+
+    glRasterPos2i(10, HEIGHT - 78);
+    const char* line3 = "R: Restart | ESC: Exit";
+    for(const char* c = line3; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+
+    // Siren indicator
+    glRasterPos2i(10, HEIGHT - 105);
+    const char* sirenText = "Siren: ";
+    for(const char* c = sirenText; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+    int player = w.player;
+    if (player >= 0 && w.ents.pilot[player].sirenOn) {
+        glColor3f(1.0f, 0.2f, 0.2f);
+        drawFilledCircle(55, HEIGHT - 100, 5);
+    } else {
+        glColor3f(0.4f, 0.4f, 0.4f);
+        drawFilledCircle(55, HEIGHT - 100, 5);
+    }
+
+    // Score panel (right side with background)
+    glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBegin(GL_QUADS);
+    glVertex2f(WIDTH - 220, HEIGHT - 90);
+    glVertex2f(WIDTH - 10, HEIGHT - 90);
+    glVertex2f(WIDTH - 10, HEIGHT - 10);
+    glVertex2f(WIDTH - 220, HEIGHT - 10);
+    glEnd();
+    glDisable(GL_BLEND);
+
+    // Score
+    glColor3f(1.0f, 1.0f, 0.2f);
+    glRasterPos2i(WIDTH - 210, HEIGHT - 25);
+    char scoreText[32];
+    snprintf(scoreText, sizeof(scoreText), "Score: %d", w.score);
+    for(const char* c = scoreText; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
+
+    // Criminals caught
+    glColor3f(1.0f, 0.4f, 0.4f);
+    glRasterPos2i(WIDTH - 210, HEIGHT - 48);
+    char caughtText[32];
+    if (w.rival >= 0) {
+        const char* rivalLabel = w.config.rival == RIVAL_CRIMINAL ? "P2 busted" : "P2";
+        snprintf(caughtText, sizeof(caughtText), "Caught: %d  %s: %d", w.criminalsCaught, rivalLabel, w.rivalCaught);
+    } else {
+        snprintf(caughtText, sizeof(caughtText), "Caught: %d", w.criminalsCaught);
+    }
+    for(const char* c = caughtText; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+
+    // Speed
+    glColor3f(0.4f, 1.0f, 0.4f);
+    glRasterPos2i(WIDTH - 210, HEIGHT - 70);
+    char speedText[32];
+    snprintf(speedText, sizeof(speedText), "Speed: %d%%", (int)(w.gameSpeed * 100));
+    for(const char* c = speedText; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+
+    // High score (top right, below speed)
+    glColor3f(1.0f, 0.8f, 0.2f);
+    glRasterPos2i(WIDTH - 210, HEIGHT - 88);
+    char highScoreText[32];
+    snprintf(highScoreText, sizeof(highScoreText), "High: %d", highScore);
+    for(const char* c = highScoreText; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+
+    if(w.paused) {
+        glColor4f(0.0f, 0.0f, 0.0f, 0.7f);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glBegin(GL_QUADS);
+        glVertex2f(0, 0);
+        glVertex2f(WIDTH, 0);
+        glVertex2f(WIDTH, HEIGHT);
+        glVertex2f(0, HEIGHT);
+        glEnd();
+        glDisable(GL_BLEND);
+
+        glColor3f(1.0f, 1.0f, 0.0f);
+        drawCenteredText(HEIGHT/2, GLUT_BITMAP_TIMES_ROMAN_24, "PAUSED");
+        glColor3f(1.0f, 1.0f, 1.0f);
+        drawCenteredText(HEIGHT/2 - 30, GLUT_BITMAP_HELVETICA_12, "Press P to Resume");
+    }
+
+    if(w.gameOver) {
+        glColor4f(0.0f, 0.0f, 0.0f, 0.8f);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glBegin(GL_QUADS);
+        glVertex2f(0, 0);
+        glVertex2f(WIDTH, 0);
+        glVertex2f(WIDTH, HEIGHT);
+        glVertex2f(0, HEIGHT);
+        glEnd();
+        glDisable(GL_BLEND);
+
+        glColor3f(1.0f, 0.1f, 0.1f);
+        drawCenteredText(HEIGHT/2 + 50, GLUT_BITMAP_TIMES_ROMAN_24, "GAME OVER!");
+
+        glColor3f(1.0f, 1.0f, 1.0f);
+        char totalScore[48];
+        snprintf(totalScore, sizeof(totalScore), "Final Score: %d", w.score);
+        drawCenteredText(HEIGHT/2 + 15, GLUT_BITMAP_HELVETICA_18, totalScore);
+
+        char highScoreDisplay[48];
+        snprintf(highScoreDisplay, sizeof(highScoreDisplay), "High Score: %d", highScore);
+        drawCenteredText(HEIGHT/2 - 5, GLUT_BITMAP_HELVETICA_18, highScoreDisplay);
+
+        char caughtTotal[48];
+        snprintf(caughtTotal, sizeof(caughtTotal), "Criminals Caught: %d", w.criminalsCaught);
+        drawCenteredText(HEIGHT/2 - 25, GLUT_BITMAP_HELVETICA_18, caughtTotal);
+
+        drawCenteredText(HEIGHT/2 - 60, GLUT_BITMAP_HELVETICA_18, "Press R to Restart");
+    }
+}
+
+// ==================== GAME LOGIC ====================
+
+// ==================== GAME LOGIC ====================
+
+// Civilian of a given type (RenderTemplate 0-2) with random color, size and pace
+Car civilianTemplate(GameWorld &w, int type) {
+    Car car;
+    car.type = type;
+    car.color = randInt(w, 0, 4);
+    
+    if (car.type == 0) { // Regular car
+        car.width = (float)randInt(w, 30, 42);
+        car.height = (float)randInt(w, 45, 60);
+        car.speed = 1.6f + randFloat(w, 0.0f, 1.2f);
+    } else if (car.type == 1) { // Bus
+        car.width = (float)randInt(w, 48, 62);
+        car.height = (float)randInt(w, 55, 70);
+        car.speed = 0.9f + randFloat(w, 0.0f, 0.6f);
+    } else { // Bike
+        car.width = (float)randInt(w, 18, 24);
+        car.height = (float)randInt(w, 30, 42);
+        car.speed = 2.6f + randFloat(w, 0.0f, 1.0f);
+    }
+    return car;
+}
+
+Car generateRandomCivilianTemplate(GameWorld &w) {
+    return civilianTemplate(w, randInt(w, 0, 2));
+}
+
+// Civilians and criminals block placement; police never spawn mid-road
+bool canPlaceAt(const GameWorld &w, float cx, float cy, float cw, float ch, int ignoreId = -1) {
+    const EntityStore &e = w.ents;
+    for (int i = 0; i < e.count; ++i) {
+        if (i == ignoreId) continue;
+        if (e.role[i] != ROLE_CIVILIAN && e.role[i] != ROLE_CRIMINAL) continue;
+        if (rectOverlap(cx, cy, cw, ch, e.x[i], e.y[i], e.width[i], e.height[i], 10.0f)) return false;
+    }
+    return true;
+}
+
+const int MAX_CIV_COUNT = 12;       // Hard cap on civilians per world
+const int MAX_ACTIVE_CIVILIANS = 8; // Cap for dynamic spawning
+
+// Place a new civilian above the screen; returns its entity id or -1
+int spawnCivilian(GameWorld &w, int tries = 50) {
+    Car templateCar = generateRandomCivilianTemplate(w);
+    Car car = templateCar;
+
+    int attempt = 0;
+    bool placed = false;
+
+    while (attempt < tries && !placed) {
+        // Simple random lane selection
+        int lane = randInt(w, 0, LANE_COUNT - 1);
+        car.lane = lane;
+        float jitter = randFloat(w, -15.0f, 15.0f);
+        car.x = laneX(lane) + jitter;
+
+        // Random spawn distance
+        car.y = HEIGHT + 100.0f + randFloat(w, 0.0f, 400.0f) + attempt * 50.0f;
+
+        if (laneOpenAt(w.road, lane, car.y) && canPlaceAt(w, car.x, car.y, car.width, car.height)) {
+            placed = true;
+        }
+        ++attempt;
+    }
+
+    // Fallback: push higher
+    if (!placed) {
+        for (int k = 0; k < 50; ++k) {
+            car.y += 70.0f;
+            ++attempt;
+            if (laneOpenAt(w.road, car.lane, car.y) && canPlaceAt(w, car.x, car.y, car.width, car.height)) {
+                placed = true;
+                break;
+            }
+        }
+    }
+    TrafficSample &t = w.traffic;
+    if (t.placements < MAX_TICK_PLACEMENTS) t.spawnAttempts[t.placements] = (uint8_t)std::min(attempt, 255);
+    t.placements++;
+    if (!placed) {
+        t.spawnsFailed++;
+        return -1;
+    }
+
+    EntityStore &e = w.ents;
+    int id = createEntity(e, ROLE_CIVILIAN);
+    if (id < 0) {
+        t.spawnsFailed++;
+        return -1;
+    }
+    t.spawnsPlaced++;
+    e.x[id] = car.x;
+    e.y[id] = car.y;
+    e.width[id] = car.width;
+    e.height[id] = car.height;
+    e.speed[id] = car.speed;
+    e.pace[id] = car.speed;
+    e.render[id] = (uint8_t)car.type;
+    e.color[id] = (uint8_t)car.color;
+    e.lane[id] = (int8_t)car.lane;
+    settleEntity(e, id);
+    w.activeCivilianCount++;
+    return id;
+}
+
+// Simple civilian spawning based on police speed. A spawn waits out the
+// interval, then succeeds with spawnChance per tick; the number of ticks to
+// the first success is geometric, so it is drawn once here and armed as one
+// timer instead of rolled every tick. At the civilian cap the interval is
+// skipped and only the chance wait applies, as before.
+void armCivilianSpawn(GameWorld &w, bool afterSpawn) {
+    // Calculate spawn chance based on police speed
+    float playerVx = w.player >= 0 ? w.ents.vx[w.player] : 0.0f;
+    float policeSpeedFactor = fabsf(playerVx) / 100.0f; // Normalize speed
+    float spawnChance = 0.02f + policeSpeedFactor * 0.03f; // Higher speed = more spawns
+    if (spawnChance > 1.0f) spawnChance = 1.0f;
+    
+    // Calculate current spawn interval based on police speed
+    float currentSpawnInterval = w.baseSpawnInterval - policeSpeedFactor * 1.5f;
+    if (currentSpawnInterval < 0.5f) currentSpawnInterval = 0.5f; // Minimum interval
+    
+    float ticks = afterSpawn ? currentSpawnInterval * 1000.0f / 16.0f : 0.0f;
+    if (spawnChance < 1.0f) {
+        float u = randFloat(w, 1e-6f, 1.0f);
+        ticks += floorf(logf(u) / logf(1.0f - spawnChance)); // Failed rolls before a success
+    }
+    armTimer(w.sched, TIMER_CIVILIAN_SPAWN, (uint32_t)std::min(ticks, 1e6f) + 1);
+}
+
+const float CRIMINAL_RESPAWN_Y = -350.0f;  // Respawned once this far below the screen
+const float CRIMINAL_WATCH_MAX_TICKS = 30.0f;
+
+// Arms the criminal's respawn check for when it should pass CRIMINAL_RESPAWN_Y
+// at its current pace. Catches speed the game up, so the wait is capped; the
+// check fires offscreen, where a few ticks late cannot be seen.
+void armCriminalWatch(GameWorld &w, int id) {
+    const EntityStore &e = w.ents;
+    float perTick = std::max(e.pace[id] * w.gameSpeed, 0.1f);
+    float ticks = (e.y[id] - CRIMINAL_RESPAWN_Y) / perTick;
+    ticks = std::min(std::max(ticks, 1.0f), CRIMINAL_WATCH_MAX_TICKS);
+    armTimer(w.sched, TIMER_ENTITY_BASE + id, (uint32_t)ticks);
+}
+
+// (Re)start a criminal entity above the screen in a random lane
+void spawnCriminal(GameWorld &w, int id) {
+    EntityStore &e = w.ents;
+    CriminalBrain &b = e.brain[id];
+    int lane = randInt(w, 0, LANE_COUNT - 1);
+    e.lane[id] = (int8_t)lane;
+    b.targetLane = lane;
+    b.replanIn = 0;
+    b.baseX = laneX(lane);
+    e.x[id] = b.baseX;
+    e.y[id] = HEIGHT + 250.0f + randFloat(w, 0.0f, 250.0f);
+    e.width[id] = BASE_VEH_W;
+    e.height[id] = BASE_VEH_H;
+    e.speed[id] = 2.4f + randFloat(w, 0.0f, 0.4f);
+    e.pace[id] = e.speed[id];
+    b.zigzag = randFloat(w, 0.0f, 3.14f);
+    e.render[id] = RENDER_CRIMINAL;
+    settleEntity(e, id);
+    armCriminalWatch(w, id);
+}
+
+const uint32_t SIREN_BLINK_TICKS = 15;  // Half a siren cycle
+
+// Police units line up by the bottom of the screen: unit 0 (the player) in the
+// middle, extra units in the outer lanes, further rows behind
+void spawnPolice(GameWorld &w, int id, int unit) {
+    static const int LANE_ORDER[LANE_COUNT] = {1, 0, 2};
+    EntityStore &e = w.ents;
+    e.x[id] = unit == 0 ? WIDTH / 2.0f : laneX(LANE_ORDER[unit % LANE_COUNT]);
+    e.y[id] = 80.0f + (unit / LANE_COUNT) * 90.0f;
+    e.width[id] = BASE_VEH_W;
+    e.height[id] = BASE_VEH_H;
+    e.vx[id] = 0.0f;
+    e.render[id] = RENDER_POLICE;
+    settleEntity(e, id);
+    PoliceControl &p = e.pilot[id];
+    p.leftPressed = p.rightPressed = false;
+    p.sirenOn = true;
+    p.sirenBlink = 0;
+    p.maxVx = 250.0f;
+    armTimer(w.sched, TIMER_ENTITY_BASE + id, SIREN_BLINK_TICKS);
+}
+
+// Reset a world to the start of a run; the seed fixes every random choice
+void resetWorld(GameWorld &w, uint32_t seed) {
+    w.rngState = seed ? seed : 0x9E3779B9u; // xorshift must never hold 0
+
+    // Road layout gets its own seed so it streams independently of spawns
+    resetRoad(w.road, nextRandom(w) | 1u);
+
+    w.score = 0;
+    w.criminalsCaught = 0;
+    w.gameOver = false;
+    w.endCause = END_NONE;
+    w.paused = false;
+    w.gameSpeed = 1.0f;
+    w.baseSpawnInterval = 3.0f;
+    clearWheel(w.sched, 0);
+
+    // Empty the road
+    w.ents.count = 0;
+    w.player = -1;
+    w.rival = -1;
+    w.rivalCaught = 0;
+    w.activeCivilianCount = 0;
+
+    // Police units (the first one is the player's, the second a rival's)
+    int policeUnits = std::max(w.config.rival == RIVAL_POLICE ? 2 : 1, w.config.policeUnits);
+    for (int k = 0; k < policeUnits; ++k) {
+        int id = createEntity(w.ents, ROLE_POLICE);
+        if (id < 0) break;
+        spawnPolice(w, id, k);
+        if (k == 0) w.player = id;
+        if (k == 1 && w.config.rival == RIVAL_POLICE) w.rival = id;
+    }
+
+    // Spawn initial civilians with more spacing
+    int initialSpawns = 3 + randInt(w, 0, 2); // 3-4 initial cars
+    for (int i = 0; i < initialSpawns; ++i) {
+        spawnCivilian(w, 50);
+    }
+
+    // Spawn criminals
+    int criminalUnits = std::max(w.config.rival == RIVAL_CRIMINAL ? 1 : 0, w.config.criminalUnits);
+    for (int k = 0; k < criminalUnits; ++k) {
+        int id = createEntity(w.ents, ROLE_CRIMINAL);
+        if (id < 0) break;
+        spawnCriminal(w, id);
+        if (k == 0 && w.config.rival == RIVAL_CRIMINAL) {
+            w.rival = id;
+            w.ents.pilot[id] = PoliceControl{};
+        }
+    }
+
+    armTimer(w.sched, TIMER_SCORE, SCORE_TICKS);
+    armCivilianSpawn(w, true);
+}
+
+// Decorative star field (render-only randomness)
+void scatterStars() {
+    stars.clear();
+    for (int i = 0; i < 100; ++i) {
+        int sx = rand() % WIDTH;
+        int sy = rand() % HEIGHT;
+        if (sx >= (int)ROAD_LEFT - 15 && sx <= (int)ROAD_RIGHT + 15) {
+            sx = (sx < WIDTH/2) ? sx - 180 : sx + 180;
+            if (sx < 0) sx += WIDTH;
+            if (sx >= WIDTH) sx -= WIDTH;
+        }
+        stars.emplace_back(sx, sy);
+    }
+}
+
+// Road segments for the windowed world are generated ahead on a worker thread
+SegmentPrefetcher* roadPrefetcher = nullptr;
+
+void initGame() {
+    if (!roadPrefetcher) roadPrefetcher = new SegmentPrefetcher(); // Lives until exit
+    world.road.source = roadPrefetcher;
+    resetWorld(world, (uint32_t)rand() ^ ((uint32_t)rand() << 16));
+    if (!history) history.reset(new SnapshotRing(HISTORY_BYTES, HISTORY_FRAMES));
+    history->clear();
+    history->record(world);
+    effects.clear();
+    scatterStars();
+}
+
+// ==================== CRIMINAL AI ====================
+// Lane-aware evasion: every few ticks the criminal scores each lane by the
+// traffic ahead of it and by how threatening the police cars are, then eases
+// into the cheapest lane. Plans are rationed per tick (CRIMINAL_PLANS_PER_TICK)
+// so the cost stays bounded however many criminals share a road; a criminal
+// that misses the budget keeps its current target and plans on a later tick.
+
+const int CRIMINAL_REPLAN_TICKS = 12;       // ~0.2 s between plans per criminal
+const int CRIMINAL_PLANS_PER_TICK = 4;      // Budget across all criminals
+const float CRIMINAL_LOOKAHEAD = 260.0f;    // Traffic considered ahead (px)
+const float CRIMINAL_THREAT_RANGE = 420.0f; // Police influence in y (px)
+const float CRIMINAL_LANE_SPEED = 2.2f;     // Max lateral ease per tick (px, x gameSpeed)
+const float CRIMINAL_WEAVE = 10.0f;         // Residual zigzag amplitude (px)
+const float RIVAL_CRIMINAL_SPEED = 4.0f;    // Lateral px per tick for a player-driven criminal
+
+// Lower is better; BLOCKED when the lane cannot be entered right now
+float scoreEscapeLane(const GameWorld &w, int id, int lane) {
+    const float BLOCKED = 1e9f;
+    const EntityStore &e = w.ents;
+    const float cy = e.y[id];
+    const float ch = e.height[id];
+    const int curLane = e.lane[id];
+    float cost = 0.6f * (float)abs(lane - curLane); // Prefer small moves
+    float threat = 0.0f;
+    if (!laneOpenAt(w.road, lane, cy + ch + 120.0f)) cost += 5.0f; // Closure coming
+
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] == ROLE_CIVILIAN) {
+            if (e.lane[i] != lane) continue;
+            // Side by side with a car: merging now would clip it
+            if (lane != curLane && fabsf(e.y[i] - cy) < (e.height[i] + ch) * 0.6f) return BLOCKED;
+            // Traffic below the criminal is what it is closing on
+            float gap = cy - (e.y[i] + e.height[i]);
+            if (gap > -e.height[i] && gap < CRIMINAL_LOOKAHEAD) {
+                cost += 3.0f * (1.0f - std::max(gap, 0.0f) / CRIMINAL_LOOKAHEAD);
+            }
+        } else if (e.role[i] == ROLE_POLICE) {
+            // Threat grows as the criminal closes in and the lane lines up
+            // with where a police car is heading; the worst unit counts
+            float dy = cy - (e.y[i] + e.height[i]);
+            float near = 1.0f - std::min(std::max(dy, 0.0f) / CRIMINAL_THREAT_RANGE, 1.0f);
+            float predictedX = e.x[i] + e.vx[i] * 0.3f;
+            float align = 1.0f - std::min(fabsf(laneX(lane) - predictedX) / (ROAD_RIGHT - ROAD_LEFT), 1.0f);
+            threat = std::max(threat, near * align);
+        }
+    }
+    return cost + 4.0f * threat;
+}
+
+void planCriminalLane(GameWorld &w, int id) {
+    CriminalBrain &b = w.ents.brain[id];
+    int best = b.targetLane;
+    float bestCost = scoreEscapeLane(w, id, best) - 0.4f; // Hysteresis: keep the plan
+    for (int lane = 0; lane < LANE_COUNT; ++lane) {
+        if (lane == best) continue;
+        float cost = scoreEscapeLane(w, id, lane);
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = lane;
+        }
+    }
+    if (best != b.targetLane) w.aiStats.laneChanges++;
+    b.targetLane = best;
+}
+
+// A player-driven criminal slides sideways on its keys (no plan, no weave)
+static void steerRivalCriminal(GameWorld &w, int id) {
+    EntityStore &e = w.ents;
+    CriminalBrain &b = e.brain[id];
+    const PoliceControl &keys = e.pilot[id];
+    if (keys.leftPressed && !keys.rightPressed) b.baseX -= RIVAL_CRIMINAL_SPEED;
+    if (keys.rightPressed && !keys.leftPressed) b.baseX += RIVAL_CRIMINAL_SPEED;
+    b.baseX = std::min(std::max(b.baseX, ROAD_LEFT + 35.0f), ROAD_RIGHT - 35.0f);
+    int lane = (int)((b.baseX - ROAD_LEFT) * LANE_COUNT / (ROAD_RIGHT - ROAD_LEFT));
+    e.lane[id] = (int8_t)std::min(std::max(lane, 0), LANE_COUNT - 1);
+    b.targetLane = e.lane[id];
+    e.x[id] = b.baseX;
+}
+
+// Plan (within budget) and steer every criminal in the world
+void updateCriminalAi(GameWorld &w) {
+    auto start = std::chrono::steady_clock::now();
+    EntityStore &e = w.ents;
+    int budget = CRIMINAL_PLANS_PER_TICK;
+
+    // Rotate the starting point so a tight budget is shared fairly
+    int count = e.count;
+    int first = count > 0 ? (int)(w.aiStats.ticks % count) : 0;
+    for (int n = 0; n < count; ++n) {
+        int id = (first + n) % count;
+        if (e.role[id] != ROLE_CRIMINAL) continue;
+        if (id == w.rival) {
+            steerRivalCriminal(w, id);
+            continue;
+        }
+        CriminalBrain &b = e.brain[id];
+
+        if (b.replanIn > 0) {
+            b.replanIn--;
+        } else if (budget > 0) {
+            planCriminalLane(w, id);
+            b.replanIn = CRIMINAL_REPLAN_TICKS;
+            budget--;
+            w.aiStats.plans++;
+        } else {
+            w.aiStats.deferred++;
+        }
+
+        // Smooth lane change, rate-limited and eased
+        float targetX = laneX(b.targetLane);
+        float maxStep = CRIMINAL_LANE_SPEED * w.gameSpeed;
+        float step = (targetX - b.baseX) * 0.12f;
+        if (step > maxStep) step = maxStep;
+        if (step < -maxStep) step = -maxStep;
+        b.baseX += step;
+        if (fabsf(targetX - b.baseX) < 2.0f) e.lane[id] = (int8_t)b.targetLane;
+
+        b.zigzag += 0.10f * w.gameSpeed;
+        e.x[id] = b.baseX + sinf(b.zigzag) * CRIMINAL_WEAVE;
+    }
+
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    w.aiStats.ticks++;
+    w.aiStats.totalUs += us;
+    if (us > w.aiStats.maxTickUs) w.aiStats.maxTickUs = us;
+}
+
+// Headless planner cost check: N criminals weaving through T civilians.
+// Traffic is scattered over a long stretch and wrapped, so density stays fixed.
+int runAiBenchmark(int numCriminals, int traffic, int steps) {
+    GameWorld w;
+    w.config.criminalUnits = std::min(numCriminals, MAX_ENTITIES / 2);
+    resetWorld(w, 4242u);
+    EntityStore &e = w.ents;
+    const float stretch = std::max(2000.0f, traffic * 40.0f);
+
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] == ROLE_CIVILIAN) destroyEntity(e, i);
+    }
+    for (int t = 0; t < traffic; ++t) {
+        int id = createEntity(e, ROLE_CIVILIAN);
+        if (id < 0) break;
+        Car car = generateRandomCivilianTemplate(w);
+        e.lane[id] = (int8_t)randInt(w, 0, LANE_COUNT - 1);
+        e.x[id] = laneX(e.lane[id]);
+        e.y[id] = randFloat(w, 0.0f, stretch);
+        e.width[id] = car.width;
+        e.height[id] = car.height;
+        e.speed[id] = car.speed;
+    }
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] != ROLE_CRIMINAL) continue;
+        e.y[i] = randFloat(w, 0.0f, stretch);
+        e.brain[i].replanIn = randInt(w, 0, CRIMINAL_REPLAN_TICKS);
+    }
+
+    for (int s = 0; s < steps; ++s) {
+        for (int i = 0; i < e.count; ++i) {
+            if (e.role[i] != ROLE_CIVILIAN && e.role[i] != ROLE_CRIMINAL) continue;
+            e.y[i] -= e.speed[i];
+            if (e.y[i] < 0.0f) e.y[i] += stretch;
+        }
+        updateCriminalAi(w);
+    }
+
+    const CriminalAiStats &st = w.aiStats;
+    std::cout << "criminals=" << w.config.criminalUnits << " traffic=" << traffic << " steps=" << steps
+              << " plans_per_tick_cap=" << CRIMINAL_PLANS_PER_TICK << "\n";
+    std::cout << "plans=" << st.plans << " deferred=" << st.deferred
+              << " lane_changes=" << st.laneChanges << "\n";
+    std::cout << "ai_us_per_tick avg=" << st.totalUs / std::max(1LL, st.ticks)
+              << " max=" << st.maxTickUs << std::endl;
+    return 0;
+}
+
+// ==================== GAME UPDATE ====================
+
+// Autopilot for police units other than the player's: chase the nearest
+// criminal ahead, sidestepping civilians directly in front
+void steerPoliceUnit(GameWorld &w, int id) {
+    EntityStore &e = w.ents;
+    PoliceControl &p = e.pilot[id];
+    float targetX = e.x[id];
+    float bestDy = 1e9f;
+
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] == ROLE_CRIMINAL) {
+            float dy = e.y[i] - e.y[id];
+            if (dy > 0.0f && dy < bestDy) {
+                bestDy = dy;
+                targetX = e.x[i];
+            }
+        }
+    }
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] != ROLE_CIVILIAN) continue;
+        float dy = e.y[i] - (e.y[id] + e.height[id]);
+        float reach = (e.width[i] + e.width[id]) * 0.5f + 12.0f;
+        if (dy > -e.height[i] && dy < 180.0f && fabsf(e.x[i] - targetX) < reach) {
+            // Pass on the side with more road
+            targetX = (e.x[i] < LANE_CENTER) ? e.x[i] + reach : e.x[i] - reach;
+        }
+    }
+
+    float dx = targetX - e.x[id];
+    p.leftPressed = dx < -6.0f;
+    p.rightPressed = dx > 6.0f;
+}
+
+// Timer handlers re-arm themselves. An entity timer whose slot no longer
+// holds its role (an autopilot unit knocked out) just lapses.
+static void runTimer(GameWorld &w, int id) {
+    EntityStore &e = w.ents;
+    if (id == TIMER_SCORE) {
+        w.score += 1;
+        armTimer(w.sched, TIMER_SCORE, SCORE_TICKS);
+    } else if (id == TIMER_CIVILIAN_SPAWN) {
+        bool room = w.activeCivilianCount < MAX_ACTIVE_CIVILIANS;
+        if (room) spawnCivilian(w, 60);
+        armCivilianSpawn(w, room);
+    } else {
+        int i = id - TIMER_ENTITY_BASE;
+        if (e.role[i] == ROLE_POLICE) {
+            e.pilot[i].sirenBlink ^= 1;
+            armTimer(w.sched, id, SIREN_BLINK_TICKS);
+        } else if (e.role[i] == ROLE_CRIMINAL) {
+            if (e.y[i] < CRIMINAL_RESPAWN_Y) spawnCriminal(w, i); // Re-arms the check
+            else armCriminalWatch(w, i);
+        }
+    }
+}
+
+// Records an effects event; a full tick's worth past the cap is dropped
+static void pushEvent(GameWorld &w, WorldEventKind kind, float x, float y) {
+    if (w.eventCount >= MAX_WORLD_EVENTS) return;
+    w.events[w.eventCount++] = {(uint8_t)kind, x, y};
+}
+
+// Swept collisions. Police, civilians and criminals are tested along their
+// paths over the tick rather than only where they end up, so a fast unit
+// cannot pass through a bike between two ticks, and when a tick holds both
+// a catch and a crash, whichever happened first wins. Vehicles move in a
+// straight line per tick; a police unit's path is its integration substeps.
+const float SUBSTEP_TRAVEL = 6.0f;  // Max lateral police travel per substep near traffic (px)
+const int MAX_SUBSTEPS = 4;
+const float NO_IMPACT = 2.0f;       // Time of impact past the end of the tick
+
+// A fast unit is integrated in substeps only while a vehicle is within reach
+// of this tick's travel; one step is exact enough everywhere else
+static int policeSubsteps(const GameWorld &w, int id, float travel) {
+    if (travel <= SUBSTEP_TRAVEL) return 1;
+    const EntityStore &e = w.ents;
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] != ROLE_CIVILIAN && e.role[i] != ROLE_CRIMINAL) continue;
+        float reachX = travel + (e.width[i] + e.width[id]) * 0.5f;
+        float reachY = std::max(e.speed[i], e.pace[i]) * w.gameSpeed + 8.0f;
+        if (fabsf(e.x[i] - e.x[id]) < reachX &&
+            e.y[i] < e.y[id] + e.height[id] + reachY && e.y[i] + e.height[i] > e.y[id] - reachY) {
+            return std::min(MAX_SUBSTEPS, (int)ceilf(travel / SUBSTEP_TRAVEL));
+        }
+    }
+    return 1;
+}
+
+// Exact at both ends (t = 0 gives a, t = 1 gives b)
+static inline float sweepLerp(float a, float b, float t) {
+    return a * (1.0f - t) + b * t;
+}
+
+// Police x at tick fraction t along its substep path
+static float pathAt(const float* path, int steps, float t) {
+    float f = std::min(std::max(t, 0.0f), 1.0f) * steps;
+    int s = std::min((int)f, steps - 1);
+    return sweepLerp(path[s], path[s + 1], f - s);
+}
+
+// A police unit's motion this tick: x along its substeps, and the x range
+// they cover (for the broad phase)
+struct PolicePath {
+    float x[MAX_SUBSTEPS + 1];
+    int steps;
+    float xMin, xMax;
+};
+
+// First contact between police unit p and vehicle i as a fraction of the
+// tick, or -1. One swept test per police substep, against the matching
+// stretch of the vehicle's straight path.
+static float policeTimeOfImpact(GameWorld &w, int p, const PolicePath &pp, int i) {
+    const EntityStore &e = w.ents;
+    // Broad phase: boxes around both whole sweeps must overlap
+    if (std::max(e.y0[i], e.y[i]) + e.height[i] <= e.y[p] ||
+        std::min(e.y0[i], e.y[i]) >= e.y[p] + e.height[p]) return -1.0f;
+    float halfW = (e.width[p] + e.width[i]) * 0.5f;
+    if (std::max(e.x0[i], e.x[i]) <= pp.xMin - halfW || std::min(e.x0[i], e.x[i]) >= pp.xMax + halfW) return -1.0f;
+
+    const float* path = pp.x;
+    const int steps = pp.steps;
+
+    w.collisionStats.sweptTests++;
+    for (int s = 0; s < steps; ++s) {
+        float ta = (float)s / steps, tb = (float)(s + 1) / steps;
+        float t = sweptTimeOfImpact(path[s], e.y[p], path[s + 1], e.y[p], e.width[p], e.height[p],
+                                    sweepLerp(e.x0[i], e.x[i], ta), sweepLerp(e.y0[i], e.y[i], ta),
+                                    sweepLerp(e.x0[i], e.x[i], tb), sweepLerp(e.y0[i], e.y[i], tb),
+                                    e.width[i], e.height[i]);
+        if (t < 0.0f) continue;
+        if (!checkCollisionScaled(path[steps], e.y[p], e.width[p], e.height[p],
+                                  e.x[i], e.y[i], e.width[i], e.height[i])) {
+            w.collisionStats.tunnels++;
+        }
+        return (s + t) / steps;
+    }
+    return -1.0f;
+}
+
+// First time the unit's box touches a road edge, or -1
+static float edgeTimeOfImpact(const float* path, int steps, float halfw) {
+    for (int s = 0; s < steps; ++s) {
+        float a = path[s], b = path[s + 1];
+        float limit = b < a ? ROAD_LEFT + halfw : ROAD_RIGHT - halfw;
+        bool past = b < a ? b <= limit : b >= limit;
+        if (!past) continue;
+        float t = a == b ? 0.0f : std::min(std::max((limit - a) / (b - a), 0.0f), 1.0f);
+        return (s + t) / steps;
+    }
+    return -1.0f;
+}
+
+// Car following (intelligent driver model). Speeds here are along the road,
+// in px per tick at gameSpeed 1: a vehicle scrolling down the screen at
+// `pace` drives forward at ROAD_SCROLL - pace. Each civilian accelerates
+// toward the pace of its template and brakes for the vehicle ahead of it in
+// its lane (the next one up the screen) by gap and closing speed. Criminals
+// follow the same way until their planner takes them out of the lane.
+// gameSpeed only scales the time step, so traffic behaves the same at every
+// speed, just sampled more coarsely.
+const float IDM_ACCEL = 0.02f;          // px/tick^2
+const float IDM_COMFORT_BRAKE = 0.06f;
+const float IDM_MAX_BRAKE = 0.6f;
+const float IDM_HEADWAY = 12.0f;        // Ticks of travel kept as a gap
+const float IDM_JAM_GAP = 12.0f;        // Bumper gap in a standing queue (px)
+const float IDM_MIN_GAP = 4.0f;         // No step closes a gap below this
+const float IDM_MIN_SPEED = 0.05f;      // Floor on desired speeds (bikes pace near the road)
+const float IDM_FREE_GAP = 1e6f;        // A lane's front vehicle has open road
+
+// One IDM step for n followers: gap to the leader's tail, the leader's speed
+// and the desired speed in, the follower's speed updated in place. dt is in
+// gameSpeed-1 ticks. Branch-free; the new speed is also capped so the gap
+// stays above IDM_MIN_GAP even if the leader brakes as hard as it can, which
+// keeps queues collision-free and stable however large the step.
+void carFollowingKernel(const float* gap, const float* leadSpeed, const float* desired, float* speed,
+                        int n, float dt, bool simd) {
+    const float interaction = 1.0f / (2.0f * sqrtf(IDM_ACCEL * IDM_COMFORT_BRAKE));
+    const float invDt = 1.0f / dt;
+    int k = 0;
+#ifdef NHP_SSE2
+    if (simd) {
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        const __m128 accel = _mm_set1_ps(IDM_ACCEL), jam = _mm_set1_ps(IDM_JAM_GAP);
+        const __m128 headway = _mm_set1_ps(IDM_HEADWAY), inter = _mm_set1_ps(interaction);
+        const __m128 maxBrake = _mm_set1_ps(-IDM_MAX_BRAKE), minGap = _mm_set1_ps(IDM_MIN_GAP);
+        const __m128 step = _mm_set1_ps(dt), invStep = _mm_set1_ps(invDt);
+        const __m128 leadBrake = _mm_set1_ps(IDM_MAX_BRAKE * dt), tiny = _mm_set1_ps(0.01f);
+        for (; k + 4 <= n; k += 4) {
+            __m128 v = _mm_loadu_ps(speed + k);
+            __m128 lead = _mm_loadu_ps(leadSpeed + k);
+            __m128 s = _mm_loadu_ps(gap + k);
+            __m128 ratio = _mm_div_ps(v, _mm_loadu_ps(desired + k));
+            ratio = _mm_mul_ps(ratio, ratio);
+            __m128 closing = _mm_mul_ps(_mm_mul_ps(v, _mm_sub_ps(v, lead)), inter);
+            __m128 wanted = _mm_add_ps(jam, _mm_max_ps(zero, _mm_add_ps(_mm_mul_ps(v, headway), closing)));
+            __m128 q = _mm_div_ps(wanted, _mm_max_ps(s, tiny));
+            __m128 a = _mm_mul_ps(accel, _mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(ratio, ratio)), _mm_mul_ps(q, q)));
+            __m128 next = _mm_add_ps(v, _mm_mul_ps(_mm_max_ps(a, maxBrake), step));
+            __m128 bound = _mm_add_ps(_mm_max_ps(zero, _mm_sub_ps(lead, leadBrake)),
+                                      _mm_mul_ps(_mm_sub_ps(s, minGap), invStep));
+            _mm_storeu_ps(speed + k, _mm_max_ps(zero, _mm_min_ps(next, bound)));
+        }
+    }
+#else
+    (void)simd;
+#endif
+    for (; k < n; ++k) {
+        float v = speed[k], lead = leadSpeed[k], s = gap[k];
+        float ratio = v / desired[k];
+        ratio *= ratio;
+        float wanted = IDM_JAM_GAP + std::max(0.0f, v * IDM_HEADWAY + v * (v - lead) * interaction);
+        float q = wanted / std::max(s, 0.01f);
+        float a = IDM_ACCEL * (1.0f - ratio * ratio - q * q);
+        float next = v + std::max(a, -IDM_MAX_BRAKE) * dt;
+        float bound = std::max(0.0f, lead - IDM_MAX_BRAKE * dt) + (s - IDM_MIN_GAP) * invDt;
+        speed[k] = std::max(0.0f, std::min(next, bound));
+    }
+}
+
+// Car following over every lane. Vehicles (laneOf < 0 = in none) are kept
+// in `order` by lane, then from the bottom of the screen up, so each one's
+// leader is the next in its lane. The order persists from tick to tick and
+// rarely changes, so an insertion sort puts it right in about one pass; only
+// a cold or heavily changed order is sorted from scratch. Ties break by id,
+// so every starting order ends the same. Followers are gathered into flat
+// arrays, stepped in one kernel call, and their new paces scattered back.
+// wallGap (optional) is a standing obstacle ahead, such as a lane closure,
+// followed instead of the leader when it is nearer.
+void followTraffic(int n, const int8_t* laneOf, const uint8_t* follows, const float* y, const float* h,
+                   const float* desiredPace, float* pace, float gameSpeed, bool simd,
+                   int16_t* order, int &orderCount, const float* wallGap = nullptr) {
+    ArenaScope scratch;
+    auto before = [laneOf, y](int a, int b) {
+        if (laneOf[a] != laneOf[b]) return laneOf[a] < laneOf[b];
+        if (y[a] != y[b]) return y[a] < y[b];
+        return a < b;
+    };
+
+    // Last tick's order minus vehicles that left, then the newcomers
+    uint8_t* seen = frameArena.alloc<uint8_t>(n);
+    memset(seen, 0, (size_t)n);
+    int total = 0;
+    for (int k = 0; k < orderCount; ++k) {
+        int id = order[k];
+        if (id >= n || laneOf[id] < 0 || seen[id]) continue;
+        seen[id] = 1;
+        order[total++] = (int16_t)id;
+    }
+    const int kept = total;
+    for (int i = 0; i < n; ++i) {
+        if (laneOf[i] >= 0 && !seen[i]) order[total++] = (int16_t)i;
+    }
+    orderCount = total;
+    if (total - kept > 32) {
+        std::sort(order, order + total, before);
+    } else {
+        for (int k = 1; k < total; ++k) {
+            int id = order[k], j = k;
+            for (; j > 0 && before(id, order[j - 1]); --j) order[j] = order[j - 1];
+            order[j] = (int16_t)id;
+        }
+    }
+
+    int* who = frameArena.alloc<int>(total);
+    float* gap = frameArena.alloc<float>(total);
+    float* lead = frameArena.alloc<float>(total);
+    float* desired = frameArena.alloc<float>(total);
+    float* speed = frameArena.alloc<float>(total);
+    int m = 0;
+    for (int k = 0; k < total; ++k) {
+        int id = order[k];
+        if (!follows[id]) continue;
+        who[m] = id;
+        speed[m] = ROAD_SCROLL - pace[id];
+        desired[m] = std::max(ROAD_SCROLL - desiredPace[id], IDM_MIN_SPEED);
+        if (k + 1 < total && laneOf[order[k + 1]] == laneOf[id]) {
+            int ahead = order[k + 1];
+            gap[m] = y[ahead] - (y[id] + h[id]);
+            lead[m] = ROAD_SCROLL - pace[ahead];
+        } else {
+            gap[m] = IDM_FREE_GAP;
+            lead[m] = speed[m];
+        }
+        if (wallGap && wallGap[id] < gap[m]) {
+            gap[m] = wallGap[id];
+            lead[m] = 0.0f; // Fixed to the road
+        }
+        m++;
+    }
+    carFollowingKernel(gap, lead, desired, speed, m, gameSpeed, simd);
+    for (int k = 0; k < m; ++k) pace[who[k]] = ROAD_SCROLL - speed[k];
+}
+
+void updateGame(GameWorld &w) {
+    w.eventCount = 0;
+    if (w.gameOver || w.paused) return;
+
+    const float dt = 16.0f / 1000.0f;
+    EntityStore &e = w.ents;
+    ArenaScope scratch;
+
+    // Sweeps start from where everything stands now
+    memcpy(e.x0, e.x, sizeof(float) * e.count);
+    memcpy(e.y0, e.y, sizeof(float) * e.count);
+
+    // Police system: movement with acceleration and damping, in substeps
+    // when fast and near traffic; each unit's path feeds the swept tests
+    const float ACC = 1200.0f;
+    const float DAMP = 6.0f;
+    PolicePath* paths = frameArena.alloc<PolicePath>(e.count);
+    float* crashT = frameArena.alloc<float>(e.count);   // First crash per unit (NO_IMPACT = none)
+    int* crashWith = frameArena.alloc<int>(e.count);    // Civilian hit, or -1 for the road edge
+
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] != ROLE_POLICE) continue;
+        PoliceControl &p = e.pilot[i];
+
+        // Gradually increase max speed (difficulty)
+        p.maxVx += 2.5f * dt * 60.0f;
+        if (p.maxVx > 650.0f) p.maxVx = 650.0f;
+
+        if (!isHumanDriven(w, i)) steerPoliceUnit(w, i);
+
+        PolicePath &pp = paths[i];
+        float* path = pp.x;
+        int steps = policeSubsteps(w, i, (fabsf(e.vx[i]) + ACC * dt) * dt);
+        const float h = dt / steps;
+        float halfw = e.width[i] * 0.5f;
+        path[0] = e.x[i];
+        for (int s = 0; s < steps; ++s) {
+            if (p.leftPressed && !p.rightPressed) {
+                e.vx[i] -= ACC * h;
+                if (e.vx[i] < -p.maxVx) e.vx[i] = -p.maxVx;
+            } else if (p.rightPressed && !p.leftPressed) {
+                e.vx[i] += ACC * h;
+                if (e.vx[i] > p.maxVx) e.vx[i] = p.maxVx;
+            } else {
+                e.vx[i] -= e.vx[i] * DAMP * h;
+                if (fabsf(e.vx[i]) < 0.5f) e.vx[i] = 0.0f;
+            }
+
+            e.x[i] += e.vx[i] * h;
+
+            // Autopilot units just scrape the barrier; a player crashing
+            // into it is resolved with the other collisions below
+            if (!isHumanDriven(w, i) && (e.x[i] - halfw <= ROAD_LEFT || e.x[i] + halfw >= ROAD_RIGHT)) {
+                e.x[i] = std::min(std::max(e.x[i], ROAD_LEFT + halfw + 1.0f), ROAD_RIGHT - halfw - 1.0f);
+                e.vx[i] = 0.0f;
+            }
+            path[s + 1] = e.x[i];
+        }
+        pp.steps = steps;
+        pp.xMin = *std::min_element(path, path + steps + 1);
+        pp.xMax = *std::max_element(path, path + steps + 1);
+        if (steps > 1) {
+            w.collisionStats.substeppedUnits++;
+            w.collisionStats.substeps += steps;
+        }
+
+        crashT[i] = NO_IMPACT;
+        crashWith[i] = -1;
+        if (isHumanDriven(w, i)) {
+            float t = edgeTimeOfImpact(path, steps, halfw);
+            if (t >= 0.0f) crashT[i] = t;
+        }
+    }
+
+    // Scroll the road (streams segments in ahead, recycles them behind)
+    advanceRoad(w.road, ROAD_SCROLL * w.gameSpeed);
+
+    // Merge out of a lane that closes just ahead once the open lane has room
+    // for the car; until then the closure is a standing obstacle to follow
+    // (car following never separates cars that overlap)
+    float* wallGap = frameArena.alloc<float>(e.count);
+    std::fill(wallGap, wallGap + e.count, IDM_FREE_GAP);
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] != ROLE_CIVILIAN) continue;
+        RoadSegment ahead = segmentAt(w.road, e.y[i] + e.height[i] + 150.0f);
+        if (e.lane[i] < ahead.laneCount) continue;
+        int open = ahead.laneCount - 1;
+        if (canPlaceAt(w, laneX(open), e.y[i], e.width[i], e.height[i], i)) {
+            e.lane[i] = (int8_t)open;
+        } else {
+            float closesAt = (float)(ahead.index * (double)SEGMENT_LENGTH - w.road.distance);
+            float gap = closesAt - (e.y[i] + e.height[i]);
+            if (gap >= 0.0f) wallGap[i] = gap;
+        }
+    }
+
+    // Car following in lanes: civilians, plus criminals close to a lane's
+    // center. Runs before anything moves, so a car spawned or merged last
+    // tick never moves at a pace the car ahead does not allow.
+    int8_t* laneOf = frameArena.alloc<int8_t>(e.count);
+    uint8_t* follows = frameArena.alloc<uint8_t>(e.count);
+    for (int i = 0; i < e.count; ++i) {
+        laneOf[i] = -1;
+        follows[i] = e.role[i] == ROLE_CIVILIAN || e.role[i] == ROLE_CRIMINAL;
+        if (e.role[i] == ROLE_CIVILIAN) {
+            laneOf[i] = e.lane[i];
+        } else if (e.role[i] == ROLE_CRIMINAL) {
+            for (int lane = 0; lane < LANE_COUNT; ++lane) {
+                if (fabsf(e.x[i] - laneX(lane)) < 70.0f) laneOf[i] = (int8_t)lane;
+            }
+        }
+    }
+    followTraffic(e.count, laneOf, follows, e.y, e.height, e.speed, e.pace, w.gameSpeed, true,
+                  w.laneOrder, w.laneOrderCount, wallGap);
+
+    // Move civilian cars and maintain lane alignment (and take the traffic
+    // readings while each car is at hand)
+    TrafficSample &traffic = w.traffic;
+    traffic = TrafficSample{};
+    const int me = w.player;
+    const float front = me >= 0 ? e.y[me] + e.height[me] : -1e9f;
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] != ROLE_CIVILIAN) continue;
+        e.y[i] -= e.pace[i] * w.gameSpeed;
+        float targetX = laneX(e.lane[i]);
+        float dx = targetX - e.x[i];
+        e.x[i] += dx * 0.08f; // Smooth return to lane
+
+        traffic.laneCivilians[std::max((int)e.lane[i], 0)]++;
+        if (e.y0[i] >= front && e.y[i] < front) {
+            float gap = fabsf(e.x[i] - e.x[me]) - (e.width[i] + e.width[me]) * 0.5f;
+            traffic.nearMisses += gap >= 0.0f && gap < NEAR_MISS_GAP;
+        }
+    }
+
+    // Retire civilians that fell off and try spawning new ones
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] == ROLE_CIVILIAN && e.y[i] < -350.0f) {
+            destroyEntity(e, i);
+            w.activeCivilianCount--;
+            w.score += 10;
+        }
+    }
+    
+    // Scheduled work due this tick: score, civilian spawns, siren blink, respawns
+    int16_t* fired = frameArena.alloc<int16_t>(MAX_TIMERS);
+    int firedCount = advanceWheel(w.sched, fired);
+    for (int k = 0; k < firedCount; ++k) runTimer(w, fired[k]);
+
+    // Criminal system: drive forward, then let the evasion planner steer
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] == ROLE_CRIMINAL) e.y[i] -= e.pace[i] * w.gameSpeed;
+    }
+    updateCriminalAi(w);
+
+    // Each unit's first crash this tick: a civilian, or the road edge (player)
+    for (int p = 0; p < e.count; ++p) {
+        if (e.role[p] != ROLE_POLICE) continue;
+        for (int i = 0; i < e.count; ++i) {
+            if (e.role[i] != ROLE_CIVILIAN) continue;
+            float t = policeTimeOfImpact(w, p, paths[p], i);
+            if (t >= 0.0f && t < crashT[p]) {
+                crashT[p] = t;
+                crashWith[p] = i;
+            }
+        }
+    }
+
+    for (int c = 0; c < e.count; ++c) {
+        if (e.role[c] != ROLE_CRIMINAL) continue;
+
+        // Keep criminal on road
+        if (e.x[c] < ROAD_LEFT + 35.0f) e.x[c] = ROAD_LEFT + 35.0f;
+        if (e.x[c] > ROAD_RIGHT - 35.0f) e.x[c] = ROAD_RIGHT - 35.0f;
+
+        // Caught by a unit that reaches it before that unit crashes
+        int catcher = -1;
+        for (int p = 0; p < e.count && catcher < 0; ++p) {
+            if (e.role[p] != ROLE_POLICE) continue;
+            float t = policeTimeOfImpact(w, p, paths[p], c);
+            if (t >= 0.0f && t < crashT[p]) catcher = p;
+        }
+        if (catcher >= 0) {
+            w.score += 50;
+            w.criminalsCaught++;
+            if (catcher == w.rival || c == w.rival) w.rivalCaught++;
+            pushEvent(w, EVENT_CATCH, e.x[c], e.y[c] + e.height[c] * 0.5f);
+
+            // Increase difficulty every 2 criminals caught
+            if (w.criminalsCaught % 2 == 0) {
+                for (int p = 0; p < e.count; ++p) {
+                    if (e.role[p] != ROLE_POLICE) continue;
+                    e.pilot[p].maxVx += 45.0f;
+                    if (e.pilot[p].maxVx > 850.0f) e.pilot[p].maxVx = 850.0f;
+                }
+                w.gameSpeed *= 1.15f;
+                if (w.gameSpeed > 4.5f) w.gameSpeed = 4.5f;
+            }
+
+            spawnCriminal(w, c);
+        }
+    }
+
+    // Crashes, at their time of impact
+    for (int p = 0; p < e.count; ++p) {
+        if (e.role[p] != ROLE_POLICE || crashT[p] > 1.0f) continue;
+        if (isHumanDriven(w, p)) {
+            // A player stops where it hit, not where the tick would have taken it
+            float t = crashT[p];
+            int i = crashWith[p];
+            e.x[p] = pathAt(paths[p].x, paths[p].steps, t);
+            if (i < 0) {
+                float edge = e.x[p] < LANE_CENTER ? ROAD_LEFT : ROAD_RIGHT;
+                pushEvent(w, EVENT_CRASH, edge, e.y[p] + e.height[p] * 0.5f);
+            } else {
+                pushEvent(w, EVENT_CRASH, (e.x[p] + sweepLerp(e.x0[i], e.x[i], t)) * 0.5f,
+                          (e.y[p] + e.height[p] + sweepLerp(e.y0[i], e.y[i], t)) * 0.5f);
+            }
+            if (w.config.crashEndsRun) {
+                w.gameOver = true;
+                w.endCause = i < 0 ? END_ROAD_EDGE : END_CIVILIAN;
+                return;
+            }
+            // Scripted run: tow the car, put the unit back on the road and carry on
+            if (i >= 0 && e.role[i] == ROLE_CIVILIAN) {
+                destroyEntity(e, i);
+                w.activeCivilianCount--;
+            }
+            float halfw = e.width[p] * 0.5f;
+            e.x[p] = std::min(std::max(e.x[p], ROAD_LEFT + halfw + 1.0f), ROAD_RIGHT - halfw - 1.0f);
+            e.vx[p] = 0.0f;
+            continue;
+        }
+        cancelTimer(w.sched, TIMER_ENTITY_BASE + p);
+        destroyEntity(e, p); // Autopilot unit is out of the chase
+    }
+}
+
+// Headless scaling check: M police units and N criminals on one road.
+// The player unit just holds its lane; a crash restarts the run.
+int runConvoyBenchmark(int policeUnits, int criminals, int steps) {
+    GameWorld w;
+    w.config.policeUnits = policeUnits;
+    w.config.criminalUnits = criminals;
+    uint32_t seed = 777u;
+    resetWorld(w, seed);
+    long long runs = 1, caught = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s) {
+        updateGame(w);
+        if (w.gameOver) {
+            caught += w.criminalsCaught;
+            resetWorld(w, ++seed);
+            runs++;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    caught += w.criminalsCaught;
+
+    std::cout << "police=" << policeUnits << " criminals=" << criminals << " steps=" << steps
+              << " entities=" << w.ents.count << "\n";
+    std::cout << "runs=" << runs << " caught=" << caught << "\n";
+    const CollisionStats &cs = w.collisionStats;
+    std::cout << "swept_tests_per_tick=" << (double)cs.sweptTests / steps
+              << " substepped_unit_ticks=" << cs.substeppedUnits
+              << " (" << cs.substeps << " substeps) tunnels_caught=" << cs.tunnels << "\n";
+    std::cout << "us_per_tick=" << elapsed * 1e6 / steps << std::endl;
+    return 0;
+}
+
+// Car following at scale and under stress. Throughput: `vehicles` spread
+// over the lanes of a long road, one full lane pass (bucket, order, gather,
+// kernel, scatter) per tick, and the kernel alone, scalar against SSE2.
+// Stability: in every lane a queue of faster cars behind a slow leader that
+// brakes to a stop halfway through, stepped at gameSpeed 1, 2.5 and 4.5;
+// the closest gap must never drop below IDM_MIN_GAP.
+int runTrafficBenchmark(int vehicles, int steps) {
+    vehicles = std::min(std::max(vehicles, LANE_COUNT), 8000); // Scratch fits the frame arena
+    uint32_t seed = 2718u;
+    auto rnd = [&seed](float lo, float hi) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return lo + (hi - lo) * ((seed >> 8) / 16777216.0f);
+    };
+
+    std::vector<int8_t> lane((size_t)vehicles);
+    std::vector<uint8_t> follows((size_t)vehicles, 1);
+    std::vector<float> y((size_t)vehicles), h((size_t)vehicles), desired((size_t)vehicles), pace((size_t)vehicles);
+    const float roadLength = vehicles * 90.0f / LANE_COUNT;
+    for (int i = 0; i < vehicles; ++i) {
+        lane[i] = (int8_t)(i % LANE_COUNT);
+        y[i] = rnd(0.0f, roadLength);
+        h[i] = rnd(30.0f, 70.0f);
+        desired[i] = pace[i] = rnd(0.9f, 3.6f);
+    }
+    // Traffic moves between passes, so the kept order has real fix-ups to do;
+    // the first (cold) pass sorts from scratch and is reported apart
+    std::vector<int16_t> order((size_t)vehicles);
+    int orderCount = 0;
+    auto pass = [&]() {
+        auto start = std::chrono::steady_clock::now();
+        followTraffic(vehicles, lane.data(), follows.data(), y.data(), h.data(), desired.data(), pace.data(), 1.0f, true,
+                      order.data(), orderCount);
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    };
+    double coldUs = pass();
+    double passUs = 0.0;
+    for (int s = 0; s < steps; ++s) {
+        for (int i = 0; i < vehicles; ++i) {
+            y[i] -= pace[i];
+            if (y[i] < 0.0f) y[i] += roadLength; // Ring road: the bottom wraps to the top
+        }
+        passUs += pass();
+    }
+    passUs /= steps;
+
+    // Kernel alone on the same number of followers
+    std::vector<float> gap((size_t)vehicles), lead((size_t)vehicles), want((size_t)vehicles), speed((size_t)vehicles);
+    for (int i = 0; i < vehicles; ++i) {
+        gap[i] = rnd(2.0f, 300.0f);
+        lead[i] = rnd(0.0f, 2.6f);
+        want[i] = rnd(IDM_MIN_SPEED, 2.6f);
+        speed[i] = rnd(0.0f, 2.6f);
+    }
+    double kernelNs[2] = {1e30, 1e30};
+    for (int pass = 0; pass < 6; ++pass) {
+        int simd = pass % 2;
+        auto start = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; ++s) {
+            carFollowingKernel(gap.data(), lead.data(), want.data(), speed.data(), vehicles, 1.0f, simd != 0);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / steps / vehicles;
+        kernelNs[simd] = std::min(kernelNs[simd], ns);
+    }
+
+    std::cout << "vehicles=" << vehicles << " lanes=" << LANE_COUNT << " steps=" << steps << "\n";
+    std::cout << "lane_pass_us_per_tick=" << passUs << " ns_per_vehicle=" << passUs * 1000.0 / vehicles
+              << " vehicles_per_ms=" << (int)(vehicles * 1000.0 / passUs) << " cold_sort_us=" << coldUs << "\n";
+#ifdef NHP_SSE2
+    std::cout << "kernel_ns_per_vehicle scalar=" << kernelNs[0] << " sse2=" << kernelNs[1] << "\n";
+#else
+    std::cout << "kernel_ns_per_vehicle scalar=" << kernelNs[0] << " (no SSE2 on this target)\n";
+#endif
+
+    // Stability: queues form behind each lane's leader, which then stops
+    const int QUEUE = 40;
+    const int n = QUEUE * LANE_COUNT;
+    const float SPEEDS[3] = {1.0f, 2.5f, 4.5f};
+    bool ok = true;
+    for (float gs : SPEEDS) {
+        std::vector<float> qy((size_t)n), qh((size_t)n), qd((size_t)n), qp((size_t)n);
+        std::vector<int8_t> ql((size_t)n);
+        std::vector<uint8_t> qf((size_t)n, 1);
+        std::vector<int16_t> qo((size_t)n);
+        int qoCount = 0;
+        for (int i = 0; i < n; ++i) {
+            int slot = i / LANE_COUNT;  // 0 = bottom of the queue
+            ql[i] = (int8_t)(i % LANE_COUNT);
+            qh[i] = rnd(30.0f, 70.0f);
+            qy[i] = slot * 130.0f;
+            qd[i] = slot == QUEUE - 1 ? 2.2f : rnd(0.9f, 1.6f); // Leader paces slowest
+            qp[i] = qd[i];
+        }
+        float minGap = 1e9f, maxBrake = 0.0f;
+        bool finite = true;
+        for (int s = 0; s < steps; ++s) {
+            if (s == steps / 2) {
+                for (int i = n - LANE_COUNT; i < n; ++i) qd[i] = ROAD_SCROLL; // Leaders stop
+            }
+            for (int i = 0; i < n; ++i) qy[i] -= qp[i] * gs;
+            std::vector<float> before = qp;
+            followTraffic(n, ql.data(), qf.data(), qy.data(), qh.data(), qd.data(), qp.data(), gs, true, qo.data(), qoCount);
+            for (int i = 0; i < n; ++i) {
+                finite = finite && std::isfinite(qp[i]);
+                maxBrake = std::max(maxBrake, (qp[i] - before[i]) / gs); // Pace up = slowing down
+                if (i + LANE_COUNT < n) minGap = std::min(minGap, qy[i + LANE_COUNT] - (qy[i] + qh[i]));
+            }
+        }
+        bool stable = finite && minGap >= IDM_MIN_GAP - 1e-3f;
+        ok = ok && stable;
+        std::cout << "game_speed=" << gs << " queue=" << QUEUE << "x" << LANE_COUNT << " min_gap_px=" << minGap
+                  << " max_brake=" << maxBrake << (stable ? " stable" : " UNSTABLE") << "\n";
+    }
+    std::cout << (ok ? "PASS" : "FAIL: queue collided or diverged") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// Checks sweptTimeOfImpact against dense sampling of the same motion on
+// random pairs, including bike-sized boxes at top police and scroll speeds,
+// and counts the hits an end-of-tick overlap test alone would miss
+int runSweepCheck(int cases) {
+    uint32_t seed = 4242u;
+    auto rnd = [&seed](float lo, float hi) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return lo + (hi - lo) * ((seed >> 8) / 16777216.0f);
+    };
+    const int SAMPLES = 4096;
+    int hits = 0, tunnels = 0, mismatches = 0, grazes = 0;
+    for (int k = 0; k < cases; ++k) {
+        // Police box, lateral only; other box falls at up to 4.5x scroll speed
+        float aw = 40.0f, ah = 70.0f, bw = rnd(18.0f, 60.0f), bh = rnd(30.0f, 110.0f);
+        float ax0 = rnd(0.0f, 200.0f), ax1 = ax0 + rnd(-40.0f, 40.0f);
+        float bx0 = rnd(0.0f, 200.0f), bx1 = bx0 + rnd(-4.0f, 4.0f);
+        float by0 = rnd(-80.0f, 150.0f), by1 = by0 - rnd(0.0f, 60.0f);
+        float t = sweptTimeOfImpact(ax0, 0.0f, ax1, 0.0f, aw, ah, bx0, by0, bx1, by1, bw, bh);
+
+        float sampled = -1.0f;
+        for (int s = 0; s <= SAMPLES; ++s) {
+            float u = (float)s / SAMPLES;
+            if (checkCollisionScaled(sweepLerp(ax0, ax1, u), 0.0f, aw, ah,
+                                     sweepLerp(bx0, bx1, u), sweepLerp(by0, by1, u), bw, bh)) {
+                sampled = u;
+                break;
+            }
+        }
+        // Sampling finds a contact no earlier than the exact time and at most
+        // one sample later; it can only miss contacts shorter than a sample
+        if (sampled >= 0.0f) {
+            if (t < 0.0f || t > sampled + 1e-4f || sampled - t > 1.0f / SAMPLES + 1e-4f) mismatches++;
+        } else if (t >= 0.0f) {
+            grazes++;
+        }
+        if (t >= 0.0f) {
+            hits++;
+            if (!checkCollisionScaled(ax1, 0.0f, aw, ah, bx1, by1, bw, bh)) tunnels++;
+        }
+    }
+    std::cout << "cases=" << cases << " hits=" << hits << " missed_by_end_of_tick_test=" << tunnels
+              << " sub_sample_grazes=" << grazes << " mismatches_vs_sampling=" << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Soak step for snapshot runs: a finished run restarts from its own RNG, so
+// the whole sequence is a pure function of the starting state
+static void soakStep(GameWorld &w) {
+    updateGame(w);
+    if (w.gameOver) resetWorld(w, nextRandom(w));
+}
+
+// Records every tick into a rewind ring and reports snapshot cost and history
+// density, then checks that restoring a past tick and replaying reproduces
+// the recorded present exactly (and that a saved file round-trips).
+int runSnapshotBenchmark(int policeUnits, int criminals, int steps,
+                         const std::string &savePath, const std::string &loadPath) {
+    std::unique_ptr<GameWorld> w(new GameWorld());
+    w->config.policeUnits = policeUnits;
+    w->config.criminalUnits = criminals;
+    if (loadPath.empty()) {
+        resetWorld(*w, 9001u);
+    } else if (!loadSnapshotFile(loadPath, *w)) {
+        std::cerr << "Cannot load snapshot " << loadPath << "\n";
+        return 1;
+    }
+
+    SnapshotRing ring(HISTORY_BYTES, HISTORY_FRAMES);
+    ring.record(*w);
+    for (int s = 0; s < steps; ++s) {
+        soakStep(*w);
+        ring.record(*w);
+    }
+
+    // Restore latency over a spread of ticks (keyframes and deltas)
+    std::unique_ptr<GameWorld> probe(new GameWorld());
+    const int RESTORES = 1000;
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < RESTORES; ++k) {
+        ring.restore(ring.oldest() + (ring.frameCount() - 1) * k / RESTORES, *probe);
+    }
+    double restoreNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RESTORES;
+
+    // Fork-and-simulate: one second of lookahead on a private copy
+    const int LOOKAHEAD = 60;
+    start = std::chrono::steady_clock::now();
+    forkWorld(*w, *probe);
+    double forkNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    for (int s = 0; s < LOOKAHEAD; ++s) soakStep(*probe);
+    double lookaheadUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    // Replay from the middle of the history must land on the recorded present
+    std::unique_ptr<uint8_t[]> a(new uint8_t[MAX_SNAPSHOT_BYTES]);
+    std::unique_ptr<uint8_t[]> b(new uint8_t[MAX_SNAPSHOT_BYTES]);
+    long long mid = ring.oldest() + ring.frameCount() / 2;
+    ring.restore(mid, *probe);
+    for (long long t = mid; t < ring.newest(); ++t) soakStep(*probe);
+    size_t sizeA = packWorld(*probe, a.get());
+    size_t sizeB = packWorld(*w, b.get());
+    bool replayOk = sizeA == sizeB && memcmp(a.get(), b.get(), sizeA) == 0;
+
+    bool fileOk = true;
+    if (!savePath.empty()) {
+        fileOk = saveSnapshotFile(savePath, *w) && loadSnapshotFile(savePath, *probe);
+        sizeA = packWorld(*probe, a.get());
+        fileOk = fileOk && sizeA == sizeB && memcmp(a.get(), b.get(), sizeA) == 0;
+    }
+
+    double perMinute = ring.encodedBytesPerFrame() * 60 * 60;
+    std::cout << "police=" << policeUnits << " criminals=" << criminals << " steps=" << steps
+              << " entities=" << w->ents.count << "\n";
+    std::cout << "ns_per_snapshot=" << ring.nsPerRecord() << " restore_ns=" << restoreNs << "\n";
+    std::cout << "raw_bytes_per_frame=" << ring.rawBytesPerFrame()
+              << " encoded_bytes_per_frame=" << ring.encodedBytesPerFrame() << "\n";
+    std::cout << "kb_per_minute=" << perMinute / 1024 << " (60 Hz)"
+              << " history_seconds=" << ring.frameCount() / 60.0
+              << " history_kb=" << ring.bytesHeld() / 1024 << "\n";
+    std::cout << "fork_ns=" << forkNs << " lookahead_" << LOOKAHEAD << "_ticks_us=" << lookaheadUs << "\n";
+    std::cout << "replay_from_tick_" << mid << "=" << (replayOk ? "match" : "MISMATCH");
+    if (!savePath.empty()) std::cout << " file_roundtrip=" << (fileOk ? "match" : "MISMATCH");
+    std::cout << std::endl;
+    return replayOk && fileOk ? 0 : 1;
+}
+
+// Renders a running world through the tiled rasterizer (SIMD lights) and
+// through a one-tile, single-threaded reference (scalar lights), and checks
+// every frame matches; then times the lighting layer on its own
+int runRasterBenchmark(int policeUnits, int criminals, int numThreads, int frames) {
+    std::unique_ptr<GameWorld> w(new GameWorld());
+    w->config.policeUnits = policeUnits;
+    w->config.criminalUnits = criminals;
+    resetWorld(*w, 31337u);
+    srand(31337u);
+    scatterStars();
+
+    DrawList dl;
+    std::unique_ptr<ParticleEffects> fx(new ParticleEffects());
+    TileRasterizer reference(WIDTH, HEIGHT, std::max(WIDTH, HEIGHT), 1, false);
+    TileRasterizer tiled(WIDTH, HEIGHT, RASTER_TILE, numThreads, true);
+    double refUs = 0.0, tiledUs = 0.0, binUs = 0.0;
+    long long cmds = 0, lights = 0;
+    int mismatches = 0;
+
+    long long particles = 0;
+    for (int f = 0; f < frames; ++f) {
+        soakStep(*w);
+        fx->tick(*w);
+        recordScene(dl, *w, fx.get());
+        particles += fx->live();
+        cmds += dl.size();
+        lights += dl.lightsSize();
+        reference.render(dl, CLEAR_RGB);
+        tiled.render(dl, CLEAR_RGB);
+        refUs += reference.lastBinUs() + reference.lastRasterUs();
+        tiledUs += tiled.lastBinUs() + tiled.lastRasterUs();
+        binUs += tiled.lastBinUs();
+        if (memcmp(reference.pixels(), tiled.pixels(), sizeof(uint32_t) * WIDTH * HEIGHT) != 0) mismatches++;
+    }
+
+    std::cout << "police=" << policeUnits << " criminals=" << criminals << " frames=" << frames
+              << " tile=" << RASTER_TILE << " threads=" << numThreads << "\n";
+    // Lighting layer alone, over the last frame, whole screen as one clip rect
+    std::unique_ptr<uint32_t[]> canvas(new uint32_t[(size_t)WIDTH * HEIGHT]);
+    double lightUs[2] = {0.0, 0.0};
+    const int LIGHT_REPS = 50;
+    for (int simd = 0; simd < 2; ++simd) {
+        auto start = std::chrono::steady_clock::now();
+        for (int rep = 0; rep < LIGHT_REPS; ++rep) {
+            memcpy(canvas.get(), reference.pixels(), sizeof(uint32_t) * WIDTH * HEIGHT);
+            for (int i = 0; i < dl.lightsSize(); ++i) {
+                compositeLight(canvas.get(), WIDTH, 0, 0, WIDTH, HEIGHT, dl.lightAt(i), simd != 0);
+            }
+        }
+        lightUs[simd] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / LIGHT_REPS;
+    }
+
+    std::cout << "cmds_per_frame=" << cmds / std::max(1, frames)
+              << " lights_per_frame=" << lights / std::max(1, frames)
+              << " particles_per_frame=" << particles / std::max(1, frames) << "\n";
+#ifdef NHP_SSE2
+    std::cout << "lighting_ms scalar=" << lightUs[0] / 1000.0 << " sse2=" << lightUs[1] / 1000.0
+              << " (" << dl.lightsSize() << " lights, incl. frame copy)\n";
+#else
+    std::cout << "lighting_ms scalar=" << lightUs[0] / 1000.0 << " (no SSE2 on this target)\n";
+#endif
+    std::cout << "reference_ms_per_frame=" << refUs / frames / 1000.0
+              << " tiled_ms_per_frame=" << tiledUs / frames / 1000.0
+              << " (bin " << binUs / frames / 1000.0 << ")\n";
+    std::cout << "speedup=" << (tiledUs > 0 ? refUs / tiledUs : 0.0)
+              << " mismatched_frames=" << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Floods a pool from 64 emitters, topping it up to 50k live particles every
+// tick, and times spawning, integration (SSE2 and scalar, on twin pools fed
+// the same bursts) and batch emission into a draw list. Budget: the whole
+// tick within 1 ms on one core.
+int runParticleBenchmark(int steps) {
+    const int CAPACITY = 65536, TARGET = 50000, EMITTERS = 64, BURST = 32;
+    std::unique_ptr<ParticlePool> simdPool(new ParticlePool(CAPACITY, 2.0f, 2.5f));
+    std::unique_ptr<ParticlePool> scalarPool(new ParticlePool(CAPACITY, 2.0f, 2.5f));
+    DrawList dl, scalarDl;
+    uint32_t seed = 2024u;
+    auto rnd = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return (seed >> 8) / 16777216.0f;
+    };
+
+    double spawnUs = 0.0, simdUs = 0.0, scalarUs = 0.0, emitUs = 0.0;
+    long long live = 0, spawned = 0;
+    int emitter = 0;
+    for (int s = 0; s < steps; ++s) {
+        auto t0 = std::chrono::steady_clock::now();
+        while (simdPool->live() < TARGET) {
+            float ex = ROAD_LEFT + (ROAD_RIGHT - ROAD_LEFT) * (emitter % 8 + 0.5f) / 8.0f;
+            float ey = 100.0f + 50.0f * (emitter / 8 % 8);
+            emitter = (emitter + 1) % EMITTERS;
+            for (int k = 0; k < BURST; ++k) {
+                float angle = rnd() * 6.2831853f, speed = 80.0f + 340.0f * rnd();
+                float life = 0.5f + rnd();
+                uint32_t color = rgb8(255, 150 + (int)(rnd() * 100), 40);
+                simdPool->spawn(ex, ey, cosf(angle) * speed, sinf(angle) * speed, life, color);
+                scalarPool->spawn(ex, ey, cosf(angle) * speed, sinf(angle) * speed, life, color);
+                spawned++;
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        simdPool->update(PARTICLE_DT, ROAD_SCROLL);
+        auto t2 = std::chrono::steady_clock::now();
+        scalarPool->update(PARTICLE_DT, ROAD_SCROLL, false);
+        auto t3 = std::chrono::steady_clock::now();
+        dl.clear();
+        simdPool->emit(dl);
+        auto t4 = std::chrono::steady_clock::now();
+
+        live += simdPool->live();
+        spawnUs += std::chrono::duration<double, std::micro>(t1 - t0).count() / 2.0; // Two pools filled
+        simdUs += std::chrono::duration<double, std::micro>(t2 - t1).count();
+        scalarUs += std::chrono::duration<double, std::micro>(t3 - t2).count();
+        emitUs += std::chrono::duration<double, std::micro>(t4 - t3).count();
+    }
+
+    // Twin pools must have stayed identical
+    scalarDl.clear();
+    scalarPool->emit(scalarDl);
+    bool match = simdPool->live() == scalarPool->live() &&
+                 memcmp(dl.particleXY(), scalarDl.particleXY(), sizeof(float) * 2 * simdPool->live()) == 0 &&
+                 memcmp(dl.particleRgba(), scalarDl.particleRgba(), sizeof(uint32_t) * simdPool->live()) == 0;
+
+    double tickUs = (spawnUs + simdUs + emitUs) / steps;
+    std::cout << "steps=" << steps << " capacity=" << CAPACITY << " emitters=" << EMITTERS << "\n";
+    std::cout << "live_avg=" << live / steps << " spawned_per_tick=" << spawned / steps << "\n";
+#ifdef NHP_SSE2
+    std::cout << "integrate_us sse2=" << simdUs / steps << " scalar=" << scalarUs / steps << "\n";
+#else
+    std::cout << "integrate_us scalar=" << scalarUs / steps << " (no SSE2 on this target)\n";
+#endif
+    std::cout << "spawn_us=" << spawnUs / steps << " emit_us=" << emitUs / steps << "\n";
+    std::cout << "ms_per_tick=" << tickUs / 1000.0 << " budget_1ms=" << (tickUs <= 1000.0 ? "ok" : "OVER")
+              << " simd_vs_scalar=" << (match ? "match" : "MISMATCH") << std::endl;
+    return match ? 0 : 1;
+}
+
+// Software path on a kiosk-sized area (default 1600x1200, twice the game):
+// per internal scale, raster + upscale cost per frame against the native
+// raster, with the SSE2 and scalar upscalers checked against each other
+int runUpscaleBenchmark(int areaW, int areaH, int numThreads, int frames) {
+    std::unique_ptr<GameWorld> w(new GameWorld());
+    w->config.policeUnits = 4;
+    w->config.criminalUnits = 8;
+    resetWorld(*w, 31337u);
+    srand(31337u);
+    scatterStars();
+    std::unique_ptr<ParticleEffects> fx(new ParticleEffects());
+    for (int s = 0; s < 300; ++s) {
+        soakStep(*w);
+        fx->tick(*w);
+    }
+
+    DrawList dl;
+    int mismatches = 0;
+    double nativeMs = 0.0;
+    double frameMsAt[RENDER_SCALE_LEVELS] = {};
+    std::cout << "area=" << areaW << "x" << areaH << " threads=" << numThreads << " frames=" << frames << "\n";
+    for (int level = 0; level < RENDER_SCALE_LEVELS; ++level) {
+        const float scale = RENDER_SCALES[level];
+        int rw = std::max(1, (int)lrintf(areaW * scale)), rh = std::max(1, (int)lrintf(areaH * scale));
+        TileRasterizer raster(rw, rh, RASTER_TILE, numThreads);
+        Upscaler simd, scalar;
+        simd.configure(rw, rh, areaW, areaH);
+        scalar.configure(rw, rh, areaW, areaH);
+        dl.setScale((float)rw / WIDTH, (float)rh / HEIGHT);
+        double rasterUs = 0.0, upUs = 0.0, scalarUs = 0.0;
+        for (int f = 0; f < frames; ++f) {
+            soakStep(*w);
+            fx->tick(*w);
+            recordScene(dl, *w, fx.get());
+            raster.render(dl, CLEAR_RGB);
+            rasterUs += raster.lastBinUs() + raster.lastRasterUs();
+            if (rw == areaW && rh == areaH) continue;
+            auto t0 = std::chrono::steady_clock::now();
+            const uint32_t* a = simd.run(raster.pixels(), true);
+            auto t1 = std::chrono::steady_clock::now();
+            const uint32_t* b = scalar.run(raster.pixels(), false);
+            auto t2 = std::chrono::steady_clock::now();
+            upUs += std::chrono::duration<double, std::micro>(t1 - t0).count();
+            scalarUs += std::chrono::duration<double, std::micro>(t2 - t1).count();
+            if (memcmp(a, b, sizeof(uint32_t) * areaW * areaH) != 0) mismatches++;
+        }
+        double frameMs = (rasterUs + upUs) / frames / 1000.0;
+        if (level == 0) nativeMs = frameMs;
+        frameMsAt[level] = frameMs;
+        std::cout << "scale=" << (int)lrintf(scale * 100.0f) << "% internal=" << rw << "x" << rh
+                  << " upscaler=" << (rw == areaW && rh == areaH ? "none" : simd.isInteger() ? "integer" : "bilinear")
+                  << " raster_ms=" << rasterUs / frames / 1000.0
+                  << " upscale_ms=" << upUs / frames / 1000.0 << " (scalar " << scalarUs / frames / 1000.0 << ")"
+                  << " frame_ms=" << frameMs << " vs_native=" << (nativeMs > 0.0 ? nativeMs / frameMs : 1.0) << "x\n";
+    }
+
+    // Governor driven by the frame times just measured, under three loads:
+    // heavy (native 20 ms), light (native 5 ms), then medium (native 14 ms).
+    // Counts frames spent at a scale slower than native.
+    RenderScaleGovernor governor;
+    governor.enabled = true;
+    const double loads[3] = {20.0, 5.0, 14.0};
+    int changes = 0, slowerFrames = 0;
+    for (int phase = 0; phase < 3; ++phase) {
+        double factor = loads[phase] / std::max(nativeMs, 1e-6);
+        for (int f = 0; f < 3000; ++f) {
+            int level = 0;
+            while (level + 1 < RENDER_SCALE_LEVELS && RENDER_SCALES[level] > governor.scale + 1e-3f) level++;
+            if (frameMsAt[level] > frameMsAt[0]) slowerFrames++;
+            if (governor.onFrame(frameMsAt[level] * factor)) changes++;
+        }
+        std::cout << "governor: native_ms=" << loads[phase] << " settled_scale="
+                  << (int)lrintf(governor.scale * 100.0f) << "%\n";
+    }
+    std::cout << "governor: changes=" << changes << " frames_slower_than_native=" << slowerFrames
+              << " (" << FRAME_BUDGET_MS << " ms budget)\n";
+    std::cout << "simd_vs_scalar_mismatched_frames=" << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// ==================== DRIVER ENVIRONMENT API ====================
+// Bot/RL interface over a private GameWorld: reset(seed), step(action).
+// Actions mirror the arrow keys; observations are a fixed-size float vector:
+//   [0] police x (-1..1 across the road)   [1] police vx / 850
+//   [2] criminal dx from police (road half-widths)  [3] criminal dy / HEIGHT
+//   [4] criminal active (0/1)              [5] gameSpeed / 4.5
+//   ("police" is the player unit, "criminal" the one nearest to it in y)
+//   then per lane, the OBS_NEAREST_PER_LANE civilians nearest to the police
+//   in y (closest first): dx, dy, present (0/1); absent slots are all zero.
+
+enum DriverAction { ACTION_NONE = 0, ACTION_LEFT = 1, ACTION_RIGHT = 2, ACTION_COUNT = 3 };
+
+const int OBS_NEAREST_PER_LANE = 3;
+const int OBS_HEADER = 6;
+const int OBS_PER_CAR = 3;
+const int OBS_SIZE = OBS_HEADER + LANE_COUNT * OBS_NEAREST_PER_LANE * OBS_PER_CAR;
+const float CRASH_PENALTY = 100.0f;
+
+void writeObservation(const GameWorld &w, float* out) {
+    const float halfRoad = (ROAD_RIGHT - ROAD_LEFT) * 0.5f;
+    const EntityStore &e = w.ents;
+    const int p = w.player;
+    const float px = p >= 0 ? e.x[p] : LANE_CENTER;
+    const float py = p >= 0 ? e.y[p] : 80.0f;
+    out[0] = (px - LANE_CENTER) / halfRoad;
+    out[1] = p >= 0 ? e.vx[p] / 850.0f : 0.0f;
+
+    int crim = -1;
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] != ROLE_CRIMINAL) continue;
+        if (crim < 0 || fabsf(e.y[i] - py) < fabsf(e.y[crim] - py)) crim = i;
+    }
+    out[2] = crim >= 0 ? (e.x[crim] - px) / halfRoad : 0.0f;
+    out[3] = crim >= 0 ? (e.y[crim] - py) / (float)HEIGHT : 0.0f;
+    out[4] = crim >= 0 ? 1.0f : 0.0f;
+    out[5] = w.gameSpeed / 4.5f;
+
+    // Keep the K nearest per lane with a tiny insertion sort (no allocation)
+    int nearest[LANE_COUNT][OBS_NEAREST_PER_LANE];
+    float nearestDist[LANE_COUNT][OBS_NEAREST_PER_LANE];
+    int found[LANE_COUNT] = {0};
+    for (int i = 0; i < e.count; ++i) {
+        if (e.role[i] != ROLE_CIVILIAN || e.lane[i] < 0 || e.lane[i] >= LANE_COUNT) continue;
+        float d = fabsf(e.y[i] - py);
+        int lane = e.lane[i];
+        int n = found[lane];
+        if (n == OBS_NEAREST_PER_LANE && d >= nearestDist[lane][n - 1]) continue;
+        int j = (n < OBS_NEAREST_PER_LANE) ? n++ : n - 1;
+        while (j > 0 && nearestDist[lane][j - 1] > d) {
+            nearest[lane][j] = nearest[lane][j - 1];
+            nearestDist[lane][j] = nearestDist[lane][j - 1];
+            --j;
+        }
+        nearest[lane][j] = i;
+        nearestDist[lane][j] = d;
+        found[lane] = n;
+    }
+
+    float* slot = out + OBS_HEADER;
+    for (int lane = 0; lane < LANE_COUNT; ++lane) {
+        for (int k = 0; k < OBS_NEAREST_PER_LANE; ++k, slot += OBS_PER_CAR) {
+            if (k < found[lane]) {
+                int c = nearest[lane][k];
+                slot[0] = (e.x[c] - px) / halfRoad;
+                slot[1] = (e.y[c] - py) / (float)HEIGHT;
+                slot[2] = 1.0f;
+            } else {
+                slot[0] = slot[1] = slot[2] = 0.0f;
+            }
+        }
+    }
+}
+
+class DriverEnv {
+public:
+    typedef std::array<float, OBS_SIZE> Observation;
+
+    struct StepResult {
+        Observation obs;
+        float reward;   // Score gained this tick, minus CRASH_PENALTY on game over
+        bool done;
+    };
+
+    Observation reset(uint32_t seed) {
+        resetWorld(sim, seed);
+        Observation obs;
+        writeObservation(sim, obs.data());
+        return obs;
+    }
+
+    StepResult step(int action) {
+        StepResult r;
+        r.reward = 0.0f;
+        if (!sim.gameOver) {
+            PoliceControl* pc = playerControl(sim);
+            pc->leftPressed = (action == ACTION_LEFT);
+            pc->rightPressed = (action == ACTION_RIGHT);
+            int before = sim.score;
+            updateGame(sim);
+            r.reward = (float)(sim.score - before);
+            if (sim.gameOver) r.reward -= CRASH_PENALTY;
+        }
+        r.done = sim.gameOver;
+        writeObservation(sim, r.obs.data());
+        return r;
+    }
+
+    const GameWorld &state() const { return sim; }
+
+private:
+    GameWorld sim;
+};
+
+// N environments stepped in lockstep by a small pool of worker threads.
+// Buffers are contiguous (env-major) so a trainer can hand them straight to a
+// tensor library. Finished environments reset automatically with a new seed.
+class VectorDriverEnv {
+public:
+    VectorDriverEnv(int numEnvs, int numThreads)
+        : envs(numEnvs), obs((size_t)numEnvs * OBS_SIZE), rewardBuf(numEnvs), doneBuf(numEnvs),
+          seeds(numEnvs), actions(nullptr), job(JOB_NONE), generation(0), pending(0), stopping(false) {
+        if (numThreads < 1) numThreads = 1;
+        if (numThreads > numEnvs) numThreads = numEnvs;
+        threadCount = numThreads;
+        // The calling thread works slice 0; helpers take the rest
+        for (int t = 1; t < threadCount; ++t) {
+            workers.emplace_back(&VectorDriverEnv::workerLoop, this, t);
+        }
+    }
+
+    ~VectorDriverEnv() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        startCv.notify_all();
+        for (auto &t : workers) t.join();
+    }
+
+    void reset(uint32_t baseSeed) {
+        for (int i = 0; i < size(); ++i) seeds[i] = baseSeed + (uint32_t)i * 7919u;
+        run(JOB_RESET);
+    }
+
+    // actions[size()] -> observations(), rewards(), dones()
+    void step(const int* acts) {
+        actions = acts;
+        run(JOB_STEP);
+    }
+
+    int size() const { return (int)envs.size(); }
+    const float* observations() const { return obs.data(); }
+    const float* rewards() const { return rewardBuf.data(); }
+    const uint8_t* dones() const { return doneBuf.data(); }
+
+private:
+    enum Job { JOB_NONE, JOB_RESET, JOB_STEP };
+
+    void run(Job j) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            job = j;
+            pending = threadCount - 1;
+            generation++;
+        }
+        startCv.notify_all();
+        runSlice(0);
+        std::unique_lock<std::mutex> lock(mtx);
+        doneCv.wait(lock, [this] { return pending == 0; });
+    }
+
+    void workerLoop(int t) {
+        int seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                startCv.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            runSlice(t);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                pending--;
+            }
+            doneCv.notify_one();
+        }
+    }
+
+    void runSlice(int t) {
+        int n = size();
+        int begin = n * t / threadCount;
+        int end = n * (t + 1) / threadCount;
+        for (int i = begin; i < end; ++i) {
+            float* o = &obs[(size_t)i * OBS_SIZE];
+            if (job == JOB_RESET) {
+                DriverEnv::Observation first = envs[i].reset(seeds[i]);
+                std::copy(first.begin(), first.end(), o);
+                rewardBuf[i] = 0.0f;
+                doneBuf[i] = 0;
+                continue;
+            }
+            DriverEnv::StepResult r = envs[i].step(actions[i]);
+            rewardBuf[i] = r.reward;
+            doneBuf[i] = r.done ? 1 : 0;
+            if (r.done) {
+                // Report the terminal reward, then start the next episode
+                seeds[i] = seeds[i] * 1664525u + 1013904223u;
+                r.obs = envs[i].reset(seeds[i]);
+            }
+            std::copy(r.obs.begin(), r.obs.end(), o);
+        }
+    }
+
+    std::vector<DriverEnv> envs;
+    std::vector<float> obs;
+    std::vector<float> rewardBuf;
+    std::vector<uint8_t> doneBuf;
+    std::vector<uint32_t> seeds;
+    const int* actions;
+
+    int threadCount;
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable startCv;
+    std::condition_variable doneCv;
+    Job job;
+    int generation;
+    int pending;
+    bool stopping;
+};
+
+// Headless throughput check: random drivers over N worlds
+int runEnvBenchmark(int numEnvs, int numThreads, int steps) {
+    VectorDriverEnv envs(numEnvs, numThreads);
+    envs.reset(12345u);
+    std::vector<int> acts(numEnvs, ACTION_NONE);
+    uint32_t rng = 2463534242u;
+    long long episodes = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s) {
+        for (int i = 0; i < numEnvs; ++i) {
+            rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+            acts[i] = (int)(rng % ACTION_COUNT);
+        }
+        envs.step(acts.data());
+        for (int i = 0; i < numEnvs; ++i) episodes += envs.dones()[i];
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long long total = (long long)numEnvs * steps;
+    std::cout << "envs=" << numEnvs << " threads=" << numThreads << " steps=" << steps
+              << " obs_size=" << OBS_SIZE << "\n";
+    std::cout << "env_steps=" << total << " episodes=" << episodes
+              << " seconds=" << elapsed << "\n";
+    std::cout << "env_steps/sec=" << (long long)(total / (elapsed > 0 ? elapsed : 1)) << std::endl;
+    return 0;
+}
+
+// ==================== NETPLAY ====================
+// Head-to-head sessions between two processes (same machine or LAN). Both
+// peers run the same world from the same seed and only inputs cross the wire
+// (UDP). Deterministic lockstep with rollback: a tick never waits for the
+// other player. Their input is predicted (they keep holding what they held),
+// each tick's starting state is saved as a packed snapshot, and when a real
+// input arrives that differs from the prediction the world is restored to
+// that tick and re-simulated to the present within the same frame. A peer
+// only stalls once it runs ROLLBACK_WINDOW ticks past the last remote input.
+// Side 0 drives the player's unit, side 1 the rival (see RivalKind).
+
+const int ROLLBACK_WINDOW = 12;         // Max ticks simulated on predicted input
+const int STATE_SLOTS = ROLLBACK_WINDOW + 2;
+const int NET_INPUT_RING = 128;         // Input history per side (ticks)
+const int MAX_INPUT_DELAY = 8;
+const int NET_MAX_INPUTS = 32;          // Unacknowledged inputs per packet, oldest first
+const int NET_CHECKSUM_TICKS = 30;      // Confirmed-state hash exchanged this often
+const int NET_CHECKSUM_HISTORY = 8;
+const size_t NET_MAX_PACKET = 128;
+const uint32_t NET_MAGIC = 0x4E50484Eu; // "NHPN"
+const uint32_t NO_ROLLBACK = 0xFFFFFFFFu;
+
+// One side's input for one tick
+enum NetInputBits : uint8_t {
+    INPUT_LEFT = 1,
+    INPUT_RIGHT = 2,
+    INPUT_SIREN = 4,        // Toggle, sent for one tick
+    INPUT_RESTART = 8       // After game over, sent for one tick
+};
+const uint8_t INPUT_HELD = INPUT_LEFT | INPUT_RIGHT; // The only bits ever predicted
+
+// Both peers must agree on everything that shapes the run
+uint32_t netplaySessionKey(const WorldConfig &cfg, uint32_t seed, int inputDelay) {
+    uint32_t key = seed;
+    key = key * 31u + (uint32_t)cfg.policeUnits;
+    key = key * 31u + (uint32_t)cfg.criminalUnits;
+    key = key * 31u + cfg.rival;
+    key = key * 31u + (uint32_t)inputDelay;
+    return key;
+}
+
+// FNV-1a over a packed world, for desync checks
+static uint32_t hashBytes(const uint8_t* data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) h = (h ^ data[i]) * 16777619u;
+    return h;
+}
+
+// Entity a side drives; looked up every tick since a restart can move it
+static int sideEntity(const GameWorld &w, int side) {
+    return side == 0 ? w.player : w.rival;
+}
+
+// One tick with both sides' inputs applied
+void netplayTick(GameWorld &w, const uint8_t input[2]) {
+    bool restart = false;
+    for (int side = 0; side < 2; ++side) {
+        restart = restart || (input[side] & INPUT_RESTART);
+        int id = sideEntity(w, side);
+        if (id < 0) continue;
+        PoliceControl &pc = w.ents.pilot[id];
+        pc.leftPressed = (input[side] & INPUT_LEFT) != 0;
+        pc.rightPressed = (input[side] & INPUT_RIGHT) != 0;
+        if ((input[side] & INPUT_SIREN) && w.ents.role[id] == ROLE_POLICE) pc.sirenOn = !pc.sirenOn;
+    }
+    if (w.gameOver && restart) {
+        resetWorld(w, nextRandom(w)); // Same next seed on both peers
+        return;
+    }
+    updateGame(w);
+}
+
+// Session accounting (both wall-clock costs and protocol counters)
+struct NetplayStats {
+    long long ticks = 0;
+    long long stalls = 0;           // Frames that could not advance
+    long long rollbacks = 0;
+    long long resimTicks = 0;
+    int maxDepth = 0;               // Most ticks re-simulated in one rollback
+    double rollbackUs = 0.0;        // Restore + re-simulation, all rollbacks
+    double maxFrameUs = 0.0;        // Worst advance(): rollback plus the new tick
+    double saveUs = 0.0;
+    long long packetsReceived = 0;
+    long long packetsRejected = 0;  // Wrong magic, session or side
+    long long checksumsCompared = 0;
+    long long desyncs = 0;
+};
+
+class NetplaySession {
+public:
+    NetplaySession(GameWorld &w, int side, int inputDelay, uint32_t sessionKey)
+        : w(w), side(side), delay(std::min(std::max(inputDelay, 0), MAX_INPUT_DELAY)), key(sessionKey),
+          states(new uint8_t[STATE_SLOTS * MAX_SNAPSHOT_BYTES]) {
+        memset(localIn, 0, sizeof(localIn));
+        memset(remoteIn, 0, sizeof(remoteIn));
+        memset(usedRemote, 0, sizeof(usedRemote));
+        memset(sums, 0, sizeof(sums));
+        memset(stateSize, 0, sizeof(stateSize));
+        // Inputs before the delay has elapsed are neutral on both sides
+        localKnown = remoteKnown = remoteAck = (uint32_t)delay;
+    }
+
+    // Simulate one tick with this frame's local input (applied `delay` ticks
+    // from now). Returns false when too far ahead of the remote player.
+    bool advance(uint8_t localInput) {
+        auto start = std::chrono::steady_clock::now();
+        settle();
+        if ((int64_t)now - remoteKnown >= ROLLBACK_WINDOW ||
+            now + delay + 1 - remoteAck > (uint32_t)NET_INPUT_RING) {
+            stat.stalls++;
+            return false;
+        }
+        localIn[localKnown % NET_INPUT_RING] = localInput;
+        localKnown++;
+        simulate(now);
+        now++;
+        stat.ticks++;
+        recordChecksums();
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        if (us > stat.maxFrameUs) stat.maxFrameUs = us;
+        return true;
+    }
+
+    // Re-simulate from the earliest mispredicted tick, if any
+    void settle() {
+        if (rollbackFrom >= now) {
+            rollbackFrom = NO_ROLLBACK;
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        uint32_t from = rollbackFrom;
+        rollbackFrom = NO_ROLLBACK;
+        unpackWorld(states.get() + (from % STATE_SLOTS) * MAX_SNAPSHOT_BYTES, MAX_SNAPSHOT_BYTES, w); // Packed here
+        for (uint32_t t = from; t < now; ++t) simulate(t);
+        int depth = (int)(now - from);
+        stat.rollbacks++;
+        stat.resimTicks += depth;
+        if (depth > stat.maxDepth) stat.maxDepth = depth;
+        stat.rollbackUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Wire format (host byte order; both ends run the same build):
+    // magic, session key, side, first tick, input count, inputs,
+    // remote inputs received, checksum tick, checksum
+    size_t buildPacket(uint8_t* out) const {
+        uint8_t* p = out;
+        uint32_t first = remoteAck;
+        uint8_t count = (uint8_t)std::min<uint32_t>(NET_MAX_INPUTS, localKnown - first);
+        uint8_t s = (uint8_t)side;
+        putField(p, NET_MAGIC); putField(p, key); putField(p, s);
+        putField(p, first); putField(p, count);
+        for (uint32_t t = first; t < first + count; ++t) putField(p, localIn[t % NET_INPUT_RING]);
+        const ChecksumEntry &latest = sums[(sumCount + NET_CHECKSUM_HISTORY - 1) % NET_CHECKSUM_HISTORY];
+        putField(p, remoteKnown); putField(p, latest.tick); putField(p, latest.hash);
+        return (size_t)(p - out);
+    }
+
+    void receive(const uint8_t* data, size_t len) {
+        const size_t FIXED = 4 + 4 + 1 + 4 + 1 + 4 + 4 + 4;
+        const uint8_t* p = data;
+        uint32_t magic, sessionKey, first, ack, sumTick, sum;
+        uint8_t s, count;
+        if (len < FIXED) { stat.packetsRejected++; return; }
+        getField(p, magic); getField(p, sessionKey); getField(p, s);
+        getField(p, first); getField(p, count);
+        if (magic != NET_MAGIC || sessionKey != key || s != 1 - side || len != FIXED + count) {
+            stat.packetsRejected++;
+            return;
+        }
+        stat.packetsReceived++;
+        for (uint32_t t = first; t < first + count; ++t) {
+            uint8_t input;
+            getField(p, input);
+            if (t != remoteKnown) continue; // Already have it (or a gap: resent later)
+            remoteIn[t % NET_INPUT_RING] = input;
+            remoteKnown++;
+            if (t < now && input != usedRemote[t % NET_INPUT_RING]) rollbackFrom = std::min(rollbackFrom, t);
+        }
+        getField(p, ack); getField(p, sumTick); getField(p, sum);
+        if (ack > remoteAck && ack <= localKnown) remoteAck = ack;
+
+        // Compare against our own hash of the same confirmed tick, once
+        if (sumTick == 0 || sumTick <= lastCompared) return;
+        for (int k = 0; k < NET_CHECKSUM_HISTORY; ++k) {
+            if (sums[k].tick != sumTick) continue;
+            lastCompared = sumTick;
+            stat.checksumsCompared++;
+            if (sums[k].hash != sum) stat.desyncs++;
+        }
+    }
+
+    uint32_t tick() const { return now; }
+    // Remote inputs are known for every tick below this
+    uint32_t confirmed() const { return remoteKnown; }
+
+    // Game over and score at the start of tick t, from its saved state; false
+    // once the slot is reused (or t is not simulated yet). Settled by advance()
+    bool savedRunState(uint32_t t, bool &gameOver, int &score) const {
+        if (t >= now || t + STATE_SLOTS <= now) return false;
+        peekRunState(states.get() + (t % STATE_SLOTS) * MAX_SNAPSHOT_BYTES, gameOver, score);
+        return true;
+    }
+    int localSide() const { return side; }
+    const NetplayStats &stats() const { return stat; }
+
+private:
+    struct ChecksumEntry {
+        uint32_t tick, hash;
+    };
+
+    uint8_t predictRemote() const {
+        return remoteIn[(remoteKnown + NET_INPUT_RING - 1) % NET_INPUT_RING] & INPUT_HELD;
+    }
+
+    // Save tick t's starting state, then run it with the best inputs known
+    void simulate(uint32_t t) {
+        auto start = std::chrono::steady_clock::now();
+        stateSize[t % STATE_SLOTS] = packWorld(w, states.get() + (t % STATE_SLOTS) * MAX_SNAPSHOT_BYTES);
+        stat.saveUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        uint8_t remote = t < remoteKnown ? remoteIn[t % NET_INPUT_RING] : predictRemote();
+        usedRemote[t % NET_INPUT_RING] = remote;
+        uint8_t input[2];
+        input[side] = localIn[t % NET_INPUT_RING];
+        input[1 - side] = remote;
+        netplayTick(w, input);
+    }
+
+    // Hash saved states whose inputs are all confirmed (ticks up to the
+    // remote frontier, and already simulated so their image is saved)
+    void recordChecksums() {
+        uint32_t frontier = std::min(now - 1, remoteKnown);
+        uint32_t t = (checksummed / NET_CHECKSUM_TICKS + 1) * NET_CHECKSUM_TICKS;
+        for (; t <= frontier; t += NET_CHECKSUM_TICKS) {
+            checksummed = t;
+            if (t + STATE_SLOTS <= now) continue; // Slot already reused
+            const uint8_t* image = states.get() + (t % STATE_SLOTS) * MAX_SNAPSHOT_BYTES;
+            sums[sumCount % NET_CHECKSUM_HISTORY] = {t, hashBytes(image, stateSize[t % STATE_SLOTS])};
+            sumCount++;
+        }
+    }
+
+    GameWorld &w;
+    const int side;
+    const int delay;
+    const uint32_t key;
+    std::unique_ptr<uint8_t[]> states;      // STATE_SLOTS packed images
+    size_t stateSize[STATE_SLOTS];
+    uint8_t localIn[NET_INPUT_RING];
+    uint8_t remoteIn[NET_INPUT_RING];
+    uint8_t usedRemote[NET_INPUT_RING];     // What each simulated tick assumed
+    uint32_t now = 0;                       // Ticks simulated; the world is at this tick
+    uint32_t localKnown, remoteKnown;       // Inputs known below these ticks
+    uint32_t remoteAck;                     // Our inputs the remote has, below this tick
+    uint32_t rollbackFrom = NO_ROLLBACK;
+    ChecksumEntry sums[NET_CHECKSUM_HISTORY];
+    int sumCount = 0;
+    uint32_t checksummed = 0, lastCompared = 0;
+    NetplayStats stat;
+};
+
+// UDP transport for one session. Incoming packets can be held back by a
+// fixed latency and dropped at random, to try a bad connection locally;
+// the clock is the caller's (wall time in the game, virtual in tests).
+class NetplayLink {
+public:
+    NetplayLink() {}
+    ~NetplayLink() { netClose(sock); }
+    NetplayLink(const NetplayLink&) = delete;
+    NetplayLink& operator=(const NetplayLink&) = delete;
+
+    // Bind locally (port 0 = any) and aim at the peer; false on failure
+    bool open(const char* bindHost, int port) {
+        if (!netStartup()) return false;
+        sock = netBindUdp(bindHost, port);
+        return sock != INVALID_SOCK;
+    }
+    bool setPeer(const char* host, int port) { return netMakeAddr(host, port, peer); }
+    int localPort() const { return netLocalPort(sock); }
+
+    void setConditions(int latencyMs, float lossPct, uint32_t seed) {
+        latency = std::max(0, latencyMs);
+        loss = std::min(std::max(lossPct, 0.0f), 100.0f);
+        rng = seed ? seed : 1u;
+    }
+
+    void send(const NetplaySession &s) {
+        uint8_t buf[NET_MAX_PACKET];
+        size_t len = s.buildPacket(buf);
+        if (netSendTo(sock, buf, len, peer)) sent++;
+    }
+
+    // Drain the socket into the delay line, then hand over what is due
+    void poll(NetplaySession &s, double nowMs) {
+        uint8_t buf[NET_MAX_PACKET];
+        int n;
+        while ((n = netRecvFrom(sock, buf, sizeof(buf), nullptr)) >= 0) {
+            rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+            if ((rng % 10000) < (uint32_t)(loss * 100.0f)) { dropped++; continue; }
+            if (count == DELAY_SLOTS) { dropped++; continue; }
+            Delayed &d = line[(head + count++) % DELAY_SLOTS];
+            d.due = nowMs + latency;
+            d.len = (uint16_t)n;
+            memcpy(d.data, buf, (size_t)n);
+        }
+        while (count > 0 && line[head].due <= nowMs) {
+            s.receive(line[head].data, line[head].len);
+            head = (head + 1) % DELAY_SLOTS;
+            count--;
+        }
+    }
+
+    long long packetsSent() const { return sent; }
+    long long packetsDropped() const { return dropped; }
+
+private:
+    static const int DELAY_SLOTS = 256;
+    struct Delayed {
+        double due;
+        uint16_t len;
+        uint8_t data[NET_MAX_PACKET];
+    };
+
+    socket_t sock = INVALID_SOCK;
+    sockaddr_in peer = {};
+    int latency = 0;
+    float loss = 0.0f;
+    uint32_t rng = 1u;
+    Delayed line[DELAY_SLOTS];      // FIFO: a fixed latency keeps packet order
+    int head = 0, count = 0;
+    long long sent = 0, dropped = 0;
+};
+
+// Test driver for one side: holds a random lane for a while, steers to it,
+// sometimes toggles the siren and restarts a finished run after a pause.
+// Run ends on confirmed input only. The live world runs on predicted remote
+// input, and a rollback can still undo a crash there; the saved state at the
+// start of tick t is final once t <= confirmed(). Call scan() every step.
+struct ConfirmedRunEnds {
+    uint32_t scanned = 0;           // Last confirmed tick checked
+    bool over = false;              // Game over as of that tick
+
+    // onEnd(score) once per run whose end is confirmed
+    template <typename OnEnd>
+    void scan(const NetplaySession &s, OnEnd onEnd) {
+        if (s.tick() == 0) return;
+        uint32_t frontier = std::min(s.confirmed(), s.tick() - 1);
+        for (; scanned < frontier; ++scanned) {
+            bool ended;
+            int score;
+            if (!s.savedRunState(scanned + 1, ended, score)) continue;
+            if (ended && !over) onEnd(score);
+            over = ended;
+        }
+    }
+};
+
+// Reads the peer's own (possibly predicted) world, like a person would.
+struct NetplayBot {
+    uint32_t rng;
+    int lane = 1, holdTicks = 0, overTicks = 0;
+
+    uint8_t input(const GameWorld &w, int side) {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        if (w.gameOver) return ++overTicks > 30 ? INPUT_RESTART : 0;
+        overTicks = 0;
+        if (--holdTicks <= 0) {
+            lane = (int)(rng % LANE_COUNT);
+            holdTicks = 40 + (int)(rng >> 8) % 80;
+        }
+        int id = sideEntity(w, side);
+        if (id < 0) return 0;
+        float dx = laneX(lane) - w.ents.x[id];
+        uint8_t bits = dx < -6.0f ? INPUT_LEFT : (dx > 6.0f ? INPUT_RIGHT : 0);
+        if ((rng >> 4) % 400 == 0) bits |= INPUT_SIREN;
+        return bits;
+    }
+};
+
+// Two peers in one process over real loopback UDP sockets, on a virtual
+// 16 ms clock so injected latency and loss give repeatable runs. Checks that
+// both end on the same packed state and confirm the same run ends, and
+// reports how often and how expensively each side rolled back.
+int runNetplayLoopback(int latencyMs, float lossPct, int steps, int inputDelay, uint8_t rival) {
+    NetplayLink links[2];
+    if (!links[0].open("127.0.0.1", 0) || !links[1].open("127.0.0.1", 0)) {
+        std::cout << "Cannot open loopback UDP sockets" << std::endl;
+        return 1;
+    }
+    links[0].setPeer("127.0.0.1", links[1].localPort());
+    links[1].setPeer("127.0.0.1", links[0].localPort());
+
+    WorldConfig cfg;
+    cfg.policeUnits = 2;
+    cfg.criminalUnits = 2;
+    cfg.rival = rival;
+    const uint32_t seed = 2024u;
+    uint32_t key = netplaySessionKey(cfg, seed, inputDelay);
+
+    std::unique_ptr<GameWorld> worlds[2];
+    std::unique_ptr<NetplaySession> sessions[2];
+    NetplayBot bots[2] = {{0x1234567u}, {0x89ABCDEu}};
+    ConfirmedRunEnds runEnds[2];
+    long long ends[2] = {0, 0}, liveEnds[2] = {0, 0}, endScores[2] = {0, 0};
+    for (int side = 0; side < 2; ++side) {
+        links[side].setConditions(latencyMs, lossPct, 77u + side);
+        worlds[side].reset(new GameWorld());
+        worlds[side]->config = cfg;
+        resetWorld(*worlds[side], seed);
+        sessions[side].reset(new NetplaySession(*worlds[side], side, inputDelay, key));
+    }
+
+    // Run to the last tick, then keep exchanging until both have every input
+    const uint32_t last = (uint32_t)steps;
+    long long frames = 0;
+    const long long maxFrames = (long long)steps * 4 + 10000;
+    for (; frames < maxFrames; ++frames) {
+        double nowMs = frames * 16.0;
+        bool done = true;
+        for (int side = 0; side < 2; ++side) {
+            NetplaySession &s = *sessions[side];
+            links[side].poll(s, nowMs);
+            bool wasOver = worlds[side]->gameOver;
+            if (s.tick() < last) s.advance(bots[side].input(*worlds[side], side));
+            liveEnds[side] += worlds[side]->gameOver && !wasOver;
+            links[side].send(s);
+            runEnds[side].scan(s, [&](int score) { ends[side]++; endScores[side] += score; });
+            done = done && s.tick() == last && s.confirmed() >= last;
+        }
+        if (done) break;
+    }
+
+    uint32_t sizes[2];
+    std::unique_ptr<uint8_t[]> images[2];
+    for (int side = 0; side < 2; ++side) {
+        sessions[side]->settle();
+        images[side].reset(new uint8_t[MAX_SNAPSHOT_BYTES]);
+        sizes[side] = (uint32_t)packWorld(*worlds[side], images[side].get());
+    }
+    bool match = sessions[0]->tick() == last && sessions[1]->tick() == last &&
+                 sizes[0] == sizes[1] && memcmp(images[0].get(), images[1].get(), sizes[0]) == 0;
+    bool sameEnds = ends[0] == ends[1] && endScores[0] == endScores[1];
+
+    const char* rivalName = rival == RIVAL_CRIMINAL ? "criminal" : "police";
+    std::cout << "ticks=" << steps << " frames=" << frames << " latency_ms=" << latencyMs
+              << " loss_pct=" << lossPct << " input_delay=" << inputDelay << " rival=" << rivalName << "\n";
+    long long desyncs = 0;
+    for (int side = 0; side < 2; ++side) {
+        const NetplayStats &st = sessions[side]->stats();
+        double perRollback = st.rollbacks > 0 ? st.rollbackUs / st.rollbacks : 0.0;
+        double perTick = st.resimTicks > 0 ? st.rollbackUs / st.resimTicks : 0.0;
+        std::cout << "side " << side << ": sent=" << links[side].packetsSent()
+                  << " received=" << st.packetsReceived << " dropped=" << links[side].packetsDropped()
+                  << " rejected=" << st.packetsRejected << " stalls=" << st.stalls << "\n";
+        std::cout << "  rollbacks=" << st.rollbacks << " (" << 100.0 * st.rollbacks / std::max(1LL, st.ticks)
+                  << "% of ticks) resim_ticks=" << st.resimTicks << " max_depth=" << st.maxDepth
+                  << " us_per_rollback=" << perRollback << " us_per_resim_tick=" << perTick << "\n";
+        std::cout << "  save_us_per_tick=" << st.saveUs / std::max(1LL, st.ticks + st.resimTicks)
+                  << " max_frame_us=" << st.maxFrameUs
+                  << " checksums=" << st.checksumsCompared << " desyncs=" << st.desyncs << "\n";
+        std::cout << "  run_ends confirmed=" << ends[side] << " (score total " << endScores[side]
+                  << ") seen_live=" << liveEnds[side] << "\n";
+        desyncs += st.desyncs;
+    }
+    std::cout << "run_ends=" << (sameEnds ? "match" : "MISMATCH") << "\n";
+    std::cout << "final_state=" << (match ? "match" : "MISMATCH") << std::endl;
+    return match && sameEnds && desyncs == 0 ? 0 : 1;
+}
+
+// Windowed session (--netplay); nullptr when playing alone
+struct NetplayOptions {
+    std::string peer;               // HOST:PORT of the other process
+    int port = 7700;                // Local UDP port
+    int side = 0;
+    uint8_t rival = RIVAL_POLICE;
+    uint32_t seed = 1u;
+    int inputDelay = 2;
+    int latencyMs = 0;
+    float lossPct = 0.0f;
+};
+
+NetplayOptions netOptions;
+std::unique_ptr<NetplayLink> netLink;
+std::unique_ptr<NetplaySession> netplay;
+uint8_t netKeys = 0;                // Held arrows
+uint8_t netLatch = 0;               // One-shot bits (siren, restart) until a tick takes them
+ConfirmedRunEnds netRunEnds;        // Scores go to the store only from here
+
+// Opens the socket and starts the session on the (already reset) world
+bool startNetplay(GameWorld &w) {
+    size_t colon = netOptions.peer.rfind(':');
+    std::unique_ptr<NetplayLink> link(new NetplayLink());
+    if (colon == std::string::npos || !link->open("0.0.0.0", netOptions.port) ||
+        !link->setPeer(netOptions.peer.substr(0, colon).c_str(), atoi(netOptions.peer.c_str() + colon + 1))) {
+        std::cerr << "Netplay unavailable (port " << netOptions.port << ", peer " << netOptions.peer
+                  << "); playing alone\n";
+        return false;
+    }
+    link->setConditions(netOptions.latencyMs, netOptions.lossPct, 1u + netOptions.side);
+    uint32_t key = netplaySessionKey(w.config, netOptions.seed, netOptions.inputDelay);
+    netLink = std::move(link);
+    netplay.reset(new NetplaySession(w, netOptions.side, netOptions.inputDelay, key));
+    return true;
+}
+
+// Session line along the bottom of the window
+void drawNetplayStatus() {
+    const NetplayStats &st = netplay->stats();
+    char text[128];
+    snprintf(text, sizeof(text), "P%d  tick %u  ahead %d  rollbacks %lld  stalls %lld%s",
+             netplay->localSide() + 1, netplay->tick(), (int)((int64_t)netplay->tick() - netplay->confirmed()),
+             st.rollbacks, st.stalls, st.desyncs > 0 ? "  DESYNC" : "");
+    glColor3f(0.6f, 0.9f, 1.0f);
+    glRasterPos2i(10, 10);
+    for (const char* c = text; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+}
+
+// ==================== TELEMETRY ====================
+// Per-tick trajectory of a session for offline tuning. The game thread writes
+// one row of plain values per tick into the current chunk (no locks, no
+// allocation); a full chunk is handed to a writer thread that transposes it
+// into columns, delta/varint encodes each (telemetry_format.h) and appends
+// it to the file. If the writer falls behind by a whole queue, a chunk is
+// dropped and counted rather than stalling the game. telemetry_reader
+// summarizes or exports a file.
+
+enum TelemetryField {
+    TELEMETRY_RUN, TELEMETRY_TICK, TELEMETRY_SCORE, TELEMETRY_CAUGHT,
+    TELEMETRY_POLICE_X, TELEMETRY_POLICE_VX, TELEMETRY_POLICE_MAX_VX, TELEMETRY_GAME_SPEED,
+    TELEMETRY_CIVILIANS, TELEMETRY_LANE0, TELEMETRY_NEAR_MISSES = TELEMETRY_LANE0 + LANE_COUNT,
+    TELEMETRY_GAME_OVER, TELEMETRY_FIELDS
+};
+
+const TelemetryColumn TELEMETRY_COLUMNS[TELEMETRY_FIELDS] = {
+    {"run", TELEMETRY_INT}, {"tick", TELEMETRY_INT}, {"score", TELEMETRY_INT}, {"caught", TELEMETRY_INT},
+    {"police_x", TELEMETRY_FLOAT}, {"police_vx", TELEMETRY_FLOAT}, {"police_max_vx", TELEMETRY_FLOAT},
+    {"game_speed", TELEMETRY_FLOAT}, {"civilians", TELEMETRY_INT},
+    {"lane0", TELEMETRY_INT}, {"lane1", TELEMETRY_INT}, {"lane2", TELEMETRY_INT},
+    {"near_misses", TELEMETRY_INT}, {"game_over", TELEMETRY_INT}
+};
+static_assert(LANE_COUNT == 3, "one lane column per lane");
+
+// One tick's row, read after updateGame (lane counts and near misses come
+// from the tick's own pass over traffic, so this never walks the entities)
+void captureTelemetryRow(const GameWorld &w, uint32_t run, uint32_t* row) {
+    const EntityStore &e = w.ents;
+    const int p = w.player;
+    float px = 0.0f, pvx = 0.0f, pmax = 0.0f;
+    if (p >= 0) {
+        px = e.x[p]; pvx = e.vx[p]; pmax = e.pilot[p].maxVx;
+    }
+    row[TELEMETRY_RUN] = run;
+    row[TELEMETRY_TICK] = w.sched.now;
+    row[TELEMETRY_SCORE] = (uint32_t)w.score;
+    row[TELEMETRY_CAUGHT] = (uint32_t)w.criminalsCaught;
+    row[TELEMETRY_POLICE_X] = telemetryFloatBits(px);
+    row[TELEMETRY_POLICE_VX] = telemetryFloatBits(pvx);
+    row[TELEMETRY_POLICE_MAX_VX] = telemetryFloatBits(pmax);
+    row[TELEMETRY_GAME_SPEED] = telemetryFloatBits(w.gameSpeed);
+    row[TELEMETRY_CIVILIANS] = (uint32_t)w.activeCivilianCount;
+    for (int l = 0; l < LANE_COUNT; ++l) row[TELEMETRY_LANE0 + l] = (uint32_t)w.traffic.laneCivilians[l];
+    row[TELEMETRY_NEAR_MISSES] = (uint32_t)w.traffic.nearMisses;
+    row[TELEMETRY_GAME_OVER] = w.gameOver ? 1u : 0u;
+}
+
+class TelemetryRecorder {
+public:
+    static const int QUEUE_CHUNKS = 4;  // Chunks in flight, including the one being filled
+
+    ~TelemetryRecorder() { stop(); }
+
+    bool start(const std::string &path) {
+        stop();
+        file = fopen(path.c_str(), "wb");
+        if (!file || !writeTelemetryHeader(file, TELEMETRY_COLUMNS, TELEMETRY_FIELDS)) {
+            if (file) fclose(file);
+            file = nullptr;
+            return false;
+        }
+        if (!chunks) {
+            chunks.reset(new Chunk[QUEUE_CHUNKS]);
+            encoded.reset(new uint8_t[TELEMETRY_FIELDS * (TELEMETRY_MAX_COLUMN_BYTES + 4)]);
+            columns.reset(new uint32_t[TELEMETRY_FIELDS * TELEMETRY_CHUNK_ROWS]);
+        }
+        fill = head = queued = 0;
+        chunks[0].rows = 0;
+        run = 0;
+        lastTick = 0;
+        rows = dropped = bytes = 0;
+        stopping = false;
+        writer = std::thread(&TelemetryRecorder::writeLoop, this);
+        return true;
+    }
+
+    bool active() const { return file != nullptr; }
+
+    // Game thread, once per simulated tick
+    void record(const GameWorld &w) {
+        if (w.sched.now <= lastTick && rows > 0) run++; // The world was reset
+        lastTick = w.sched.now;
+        Chunk &c = chunks[fill];
+        captureTelemetryRow(w, run, c.values[c.rows]); // One contiguous 56-byte row
+        rows++;
+        if (++c.rows == TELEMETRY_CHUNK_ROWS) handOff();
+    }
+
+    // Writes the partial chunk and waits for the file to be complete
+    void stop() {
+        if (!file) return;
+        if (chunks[fill].rows > 0) handOff();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        writer.join();
+        fclose(file);
+        file = nullptr;
+    }
+
+    long long rowsRecorded() const { return rows; }
+    long long chunksDropped() const { return dropped; }
+    long long bytesWritten() const { return bytes; }
+
+private:
+    // Row-major, so a tick's stores land on one or two cache lines; the
+    // writer does the transpose to columns
+    struct Chunk {
+        int rows;
+        uint32_t values[TELEMETRY_CHUNK_ROWS][TELEMETRY_FIELDS];
+    };
+
+    // Queue the filled chunk and move on to a free one; with none free the
+    // chunk is discarded and refilled instead
+    void handOff() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (queued == QUEUE_CHUNKS - 1) {
+                dropped++;
+                chunks[fill].rows = 0;
+                return;
+            }
+            queued++;
+        }
+        cv.notify_one();
+        fill = (fill + 1) % QUEUE_CHUNKS;
+        chunks[fill].rows = 0;
+    }
+
+    void writeLoop() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this] { return stopping || queued > 0; });
+            if (queued == 0) return; // Stopping with everything written
+            Chunk &c = chunks[head];
+            lock.unlock();
+
+            uint32_t* cols = columns.get();
+            for (int r = 0; r < c.rows; ++r)
+                for (int k = 0; k < TELEMETRY_FIELDS; ++k) cols[k * TELEMETRY_CHUNK_ROWS + r] = c.values[r][k];
+            uint8_t* p = encoded.get();
+            for (int k = 0; k < TELEMETRY_FIELDS; ++k) {
+                uint32_t len = (uint32_t)encodeTelemetryColumn(cols + k * TELEMETRY_CHUNK_ROWS, c.rows, p + 4);
+                memcpy(p, &len, 4);
+                p += 4 + len;
+            }
+            uint32_t chunkHead[2] = {(uint32_t)c.rows, (uint32_t)(p - encoded.get())};
+            fwrite(chunkHead, sizeof(chunkHead), 1, file);
+            fwrite(encoded.get(), chunkHead[1], 1, file);
+            fflush(file);
+
+            lock.lock();
+            bytes += sizeof(chunkHead) + chunkHead[1];
+            head = (head + 1) % QUEUE_CHUNKS;
+            queued--;
+        }
+    }
+
+    FILE* file = nullptr;
+    std::unique_ptr<Chunk[]> chunks;
+    std::unique_ptr<uint8_t[]> encoded;     // Writer's scratch for one chunk
+    std::unique_ptr<uint32_t[]> columns;    // Writer's transposed copy of it
+    int fill = 0;                           // Chunk the game thread is filling
+    int head = 0, queued = 0;               // Writer's queue (guarded by mtx)
+    uint32_t run = 0, lastTick = 0;
+    long long rows = 0, dropped = 0, bytes = 0;
+    bool stopping = false;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread writer;
+};
+
+// CPU time (user + system) of the calling thread, so a cost can be measured
+// apart from the helper threads it feeds (they may share the core), or of
+// the whole process
+enum CpuClock { CPU_THREAD, CPU_PROCESS };
+
+double cpuSeconds(CpuClock which) {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    BOOL ok = which == CPU_THREAD ? GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)
+                                  : GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    if (!ok) return 0.0;
+    auto seconds = [](const FILETIME &t) {
+        return (double)(((unsigned long long)t.dwHighDateTime << 32) | t.dwLowDateTime) * 1e-7;
+    };
+    return seconds(kernel) + seconds(user);
+#else
+    timespec ts;
+    clock_gettime(which == CPU_THREAD ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Bench world: the player's unit drives on autopilot so runs last and pass
+// traffic; the sequence is a pure function of the seed
+static std::unique_ptr<GameWorld> telemetryBenchWorld(int policeUnits, int criminals, uint32_t seed) {
+    std::unique_ptr<GameWorld> w(new GameWorld());
+    w->config.policeUnits = policeUnits;
+    w->config.criminalUnits = criminals;
+    resetWorld(*w, seed);
+    return w;
+}
+
+static void telemetryBenchStep(GameWorld &w) {
+    steerPoliceUnit(w, w.player);
+    soakStep(w);
+}
+
+// Recorder cost on the game thread against the bare simulation (best of three
+// passes each, thread CPU time, so the writer is excluded even on one core),
+// encoded size per tick, then a read-back that must reproduce every row and
+// the reader's scan rate
+int runTelemetryBenchmark(int policeUnits, int criminals, int steps, const std::string &savePath) {
+    const std::string path = savePath.empty() ? "telemetry_bench.nhpt" : savePath;
+    const uint32_t seed = 31337u;
+    std::unique_ptr<TelemetryRecorder> recorder(new TelemetryRecorder());
+
+    double best[2] = {1e30, 1e30};
+    for (int pass = -1; pass < 6; ++pass) { // Pass -1 warms caches and clocks
+        bool recording = pass % 2 != 0;
+        std::unique_ptr<GameWorld> w = telemetryBenchWorld(policeUnits, criminals, seed);
+        if (recording && !recorder->start(path)) {
+            std::cout << "Cannot write " << path << std::endl;
+            return 1;
+        }
+        double start = cpuSeconds(CPU_THREAD);
+        for (int s = 0; s < steps; ++s) {
+            telemetryBenchStep(*w);
+            if (recording) recorder->record(*w);
+        }
+        double elapsed = cpuSeconds(CPU_THREAD) - start;
+        if (recording) recorder->stop(); // Off the clock: the writer thread drains the tail
+        if (pass >= 0) best[recording] = std::min(best[recording], elapsed);
+    }
+
+    // The hot path alone: one row capture and store per call
+    double recordNs = 0.0;
+    {
+        std::unique_ptr<GameWorld> w = telemetryBenchWorld(policeUnits, criminals, seed);
+        for (int s = 0; s < 100; ++s) telemetryBenchStep(*w);
+        const std::string probePath = path + ".probe";
+        TelemetryRecorder probe;
+        if (probe.start(probePath)) {
+            const int CALLS = 1000000;
+            for (int k = 0; k < CALLS; ++k) probe.record(*w); // Fault in every chunk first
+            double start = cpuSeconds(CPU_THREAD);
+            for (int k = 0; k < CALLS; ++k) probe.record(*w);
+            recordNs = (cpuSeconds(CPU_THREAD) - start) * 1e9 / CALLS;
+            probe.stop();
+        }
+        std::remove(probePath.c_str());
+    }
+
+    // Read back against a fresh replay of the same seed
+    TelemetryReader reader;
+    if (!reader.open(path.c_str()) || reader.columnCount() != TELEMETRY_FIELDS) {
+        std::cout << "Cannot read back " << path << std::endl;
+        return 1;
+    }
+    std::unique_ptr<GameWorld> w = telemetryBenchWorld(policeUnits, criminals, seed);
+    uint32_t run = 0, lastTick = 0;
+    long long readRows = 0, mismatches = 0;
+    int n;
+    while ((n = reader.readChunk()) > 0) {
+        for (int r = 0; r < n; ++r) {
+            telemetryBenchStep(*w);
+            if (w->sched.now <= lastTick && readRows > 0) run++;
+            lastTick = w->sched.now;
+            uint32_t row[TELEMETRY_FIELDS];
+            captureTelemetryRow(*w, run, row);
+            for (int k = 0; k < TELEMETRY_FIELDS; ++k) mismatches += reader.column(k)[r] != row[k];
+            readRows++;
+        }
+    }
+
+    // Scan only: decode every chunk and total the near misses
+    TelemetryReader scan;
+    if (!scan.open(path.c_str())) {
+        std::cout << "Cannot read back " << path << std::endl;
+        return 1;
+    }
+    long long nearMisses = 0, scanned = 0;
+    auto scanStart = std::chrono::steady_clock::now();
+    while ((n = scan.readChunk()) > 0) {
+        const uint32_t* col = scan.column(TELEMETRY_NEAR_MISSES);
+        for (int r = 0; r < n; ++r) nearMisses += col[r];
+        scanned += n;
+    }
+    double scanSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - scanStart).count();
+    if (savePath.empty()) std::remove(path.c_str());
+
+    double bytesPerTick = (double)recorder->bytesWritten() / std::max(1LL, recorder->rowsRecorded());
+    std::cout << "police=" << policeUnits << " criminals=" << criminals << " steps=" << steps
+              << " columns=" << TELEMETRY_FIELDS << "\n";
+    std::cout << "us_per_tick plain=" << best[0] * 1e6 / steps << " recorded=" << best[1] * 1e6 / steps
+              << " overhead_pct=" << 100.0 * (best[1] - best[0]) / best[0]
+              << " record_ns=" << recordNs << " (" << 100.0 * recordNs * steps / (best[0] * 1e9) << "% of a tick)\n";
+    std::cout << "bytes_per_tick=" << bytesPerTick << " raw=" << TELEMETRY_FIELDS * 4
+              << " ratio=" << TELEMETRY_FIELDS * 4 / std::max(bytesPerTick, 1e-9)
+              << " chunks_dropped=" << recorder->chunksDropped() << "\n";
+    std::cout << "read_rows=" << readRows << " mismatches=" << mismatches << " near_misses=" << nearMisses
+              << " scan_mticks_per_sec=" << scanned / std::max(scanSeconds, 1e-9) / 1e6 << std::endl;
+    return readRows == steps && mismatches == 0 ? 0 : 1;
+}
+
+// Windowed session recording (--telemetry FILE)
+TelemetryRecorder telemetry;
+
+void stopTelemetry() {
+    telemetry.stop();
+}
+
+// ==================== METRICS ====================
+// Health metrics for unattended kiosks, served on a local HTTP port in
+// Prometheus text format (--metrics-port N; GET /metrics). Recording is a few
+// relaxed atomic adds per tick or frame and never locks; a scrape reads the
+// same atomics, so a histogram's buckets may be an observation or two apart
+// from its count, which Prometheus tolerates. Neither side allocates.
+
+class MetricCounter {
+public:
+    void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+class MetricGauge {
+public:
+    void set(int64_t v) { value.store(v, std::memory_order_relaxed); }
+    int64_t get() const { return value.load(std::memory_order_relaxed); }
+private:
+    std::atomic<int64_t> value{0};
+};
+
+// Fixed upper bounds over integer observations (ns, counts); `scale`
+// converts them to the exported unit (ns -> seconds)
+class MetricHistogram {
+public:
+    static const int MAX_BUCKETS = 16;
+
+    MetricHistogram(std::initializer_list<uint64_t> upperBounds, double scale) : scale(scale) {
+        bucketCount = 0;
+        for (uint64_t b : upperBounds) {
+            if (bucketCount < MAX_BUCKETS) bounds[bucketCount++] = b;
+        }
+        for (auto &c : counts) c.store(0, std::memory_order_relaxed);
+    }
+
+    void observe(uint64_t v) {
+        int b = 0;
+        while (b < bucketCount && v > bounds[b]) ++b;
+        counts[b].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const {
+        uint64_t total = 0;
+        for (int b = 0; b <= bucketCount; ++b) total += counts[b].load(std::memory_order_relaxed);
+        return total;
+    }
+
+    int buckets() const { return bucketCount; }
+    double upperBound(int b) const { return bounds[b] * scale; }
+    uint64_t bucketCountAt(int b) const { return counts[b].load(std::memory_order_relaxed); }
+    double total() const { return sum.load(std::memory_order_relaxed) * scale; }
+
+private:
+    uint64_t bounds[MAX_BUCKETS];
+    int bucketCount;
+    double scale;
+    std::atomic<uint64_t> counts[MAX_BUCKETS + 1]; // Last one is +Inf
+    std::atomic<uint64_t> sum{0};
+};
+
+const uint64_t MS_NS = 1000000;
+
+struct GameMetrics {
+    MetricHistogram frameTime{{MS_NS, 2 * MS_NS, 4 * MS_NS, 8 * MS_NS, 12 * MS_NS, 16 * MS_NS, 25 * MS_NS,
+                               33 * MS_NS, 50 * MS_NS, 100 * MS_NS}, 1e-9};
+    MetricHistogram updateTime{{5000, 10000, 20000, 50000, 100000, 250000, 500000, MS_NS, 2 * MS_NS,
+                                5 * MS_NS}, 1e-9};
+    MetricHistogram spawnAttempts{{1, 2, 4, 8, 16, 32, 64, 100}, 1.0};
+    MetricCounter spawnFailures;
+    MetricGauge activeCivilians;
+    MetricCounter ticks;
+    MetricCounter catches;
+    MetricCounter endsByCivilian;
+    MetricCounter endsByRoadEdge;
+    MetricCounter scrapes;
+};
+
+// Metrics of the windowed game
+GameMetrics metrics;
+
+// After each simulated tick: its cost, what it spawned and how a run ended
+void recordTickMetrics(GameMetrics &m, const GameWorld &w, uint64_t updateNs, int caughtBefore, bool wasOver) {
+    m.ticks.add();
+    m.updateTime.observe(updateNs);
+    m.activeCivilians.set(w.activeCivilianCount);
+    const TrafficSample &t = w.traffic;
+    for (int k = 0; k < std::min(t.placements, MAX_TICK_PLACEMENTS); ++k) m.spawnAttempts.observe(t.spawnAttempts[k]);
+    if (t.spawnsFailed > 0) m.spawnFailures.add((uint64_t)t.spawnsFailed);
+    if (w.criminalsCaught > caughtBefore) m.catches.add((uint64_t)(w.criminalsCaught - caughtBefore));
+    if (w.gameOver && !wasOver) {
+        if (w.endCause == END_ROAD_EDGE) m.endsByRoadEdge.add();
+        else m.endsByCivilian.add();
+    }
+}
+
+// Text exposition (format 0.0.4) into a caller's buffer; returns the length
+class MetricsText {
+public:
+    MetricsText(char* buf, size_t cap) : buf(buf), cap(cap), len(0) {}
+
+    void printf(const char* fmt, ...) {
+        if (len >= cap) return;
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf + len, cap - len, fmt, args);
+        va_end(args);
+        if (n > 0) len = std::min(cap, len + (size_t)n);
+    }
+
+    void header(const char* name, const char* type, const char* help) {
+        printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    }
+
+    void histogram(const char* name, const char* help, const MetricHistogram &h) {
+        header(name, "histogram", help);
+        uint64_t cumulative = 0;
+        for (int b = 0; b < h.buckets(); ++b) {
+            cumulative += h.bucketCountAt(b);
+            printf("%s_bucket{le=\"%g\"} %llu\n", name, h.upperBound(b), (unsigned long long)cumulative);
+        }
+        cumulative += h.bucketCountAt(h.buckets());
+        printf("%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+        printf("%s_sum %.9g\n%s_count %llu\n", name, h.total(), name, (unsigned long long)cumulative);
+    }
+
+    size_t size() const { return len; }
+
+private:
+    char* buf;
+    size_t cap, len;
+};
+
+size_t renderMetrics(const GameMetrics &m, char* buf, size_t cap) {
+    MetricsText t(buf, cap);
+    t.histogram("nhp_frame_seconds", "Time to draw and present a frame.", m.frameTime);
+    t.histogram("nhp_update_seconds", "Time spent in one simulation step.", m.updateTime);
+    t.histogram("nhp_spawn_attempts", "Positions tried per civilian placement.", m.spawnAttempts);
+    t.header("nhp_spawn_failures_total", "counter", "Civilian placements that found no free spot.");
+    t.printf("nhp_spawn_failures_total %llu\n", (unsigned long long)m.spawnFailures.get());
+    t.header("nhp_active_civilians", "gauge", "Civilian vehicles on the road.");
+    t.printf("nhp_active_civilians %lld\n", (long long)m.activeCivilians.get());
+    t.header("nhp_ticks_total", "counter", "Simulation steps taken.");
+    t.printf("nhp_ticks_total %llu\n", (unsigned long long)m.ticks.get());
+    t.header("nhp_catches_total", "counter", "Criminals caught.");
+    t.printf("nhp_catches_total %llu\n", (unsigned long long)m.catches.get());
+    t.header("nhp_game_overs_total", "counter", "Runs ended, by cause.");
+    t.printf("nhp_game_overs_total{cause=\"civilian\"} %llu\n", (unsigned long long)m.endsByCivilian.get());
+    t.printf("nhp_game_overs_total{cause=\"road_edge\"} %llu\n", (unsigned long long)m.endsByRoadEdge.get());
+    t.header("nhp_scrapes_total", "counter", "Metrics requests served.");
+    t.printf("nhp_scrapes_total %llu\n", (unsigned long long)m.scrapes.get());
+    return t.size();
+}
+
+// One-connection-at-a-time HTTP server on 127.0.0.1. Polls its listener so
+// stop() returns within POLL_MS.
+class MetricsServer {
+public:
+    static const int POLL_MS = 200;
+    static const size_t BODY_BYTES = 8192;
+
+    ~MetricsServer() { stop(); }
+
+    bool start(GameMetrics &source, int port) {
+        if (!netStartup()) return false;
+        listener = netListenTcp("127.0.0.1", port, 8);
+        if (listener == INVALID_SOCK) return false;
+        m = &source;
+        stopping = false;
+        worker = std::thread(&MetricsServer::run, this);
+        return true;
+    }
+
+    void stop() {
+        if (listener == INVALID_SOCK) return;
+        stopping = true;
+        worker.join();
+        netClose(listener);
+        listener = INVALID_SOCK;
+    }
+
+    int port() const { return netLocalPort(listener); }
+
+private:
+    void run() {
+        while (!stopping) {
+            if (!netWaitReadable(listener, POLL_MS)) continue;
+            socket_t client = accept(listener, nullptr, nullptr);
+            if (client == INVALID_SOCK) continue;
+            netSetTimeouts(client, 1000);
+            serve(client);
+            netClose(client);
+        }
+    }
+
+    // Reads the request head, answers /metrics, 404 for anything else
+    void serve(socket_t client) {
+        size_t got = 0;
+        while (got < sizeof(request) - 1) {
+            int n = (int)recv(client, request + got, (int)(sizeof(request) - 1 - got), 0);
+            if (n <= 0) return;
+            got += (size_t)n;
+            request[got] = '\0';
+            if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+        }
+        request[got] = '\0';
+        bool found = strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0;
+        size_t bodyLen = 0;
+        if (found) {
+            m->scrapes.add();
+            bodyLen = renderMetrics(*m, body, sizeof(body));
+        }
+        char head[160];
+        int headLen = snprintf(head, sizeof(head),
+                               "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                               found ? "200 OK" : "404 Not Found", bodyLen);
+        if (netSendAll(client, head, (size_t)headLen) && bodyLen > 0) netSendAll(client, body, bodyLen);
+    }
+
+    GameMetrics* m = nullptr;
+    socket_t listener = INVALID_SOCK;
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+    char request[2048];
+    char body[BODY_BYTES];
+};
+
+MetricsServer metricsServer;
+
+// Minimal client for the check below: whole response of GET `path`, or ""
+static std::string scrapeMetrics(int port, const char* path) {
+    socket_t s = netConnectTcp("127.0.0.1", port, 2000);
+    if (s == INVALID_SOCK) return std::string();
+    std::string request = std::string("GET ") + path + " HTTP/1.0\r\nHost: localhost\r\n\r\n";
+    std::string response;
+    if (netSendAll(s, request.data(), request.size())) {
+        char buf[4096];
+        int n;
+        while ((n = (int)recv(s, buf, sizeof(buf), 0)) > 0) response.append(buf, (size_t)n);
+    }
+    netClose(s);
+    return response;
+}
+
+// Value of an unlabeled (or exactly labeled) sample line, or -1
+static double metricValue(const std::string &text, const std::string &series) {
+    size_t at = text.find("\n" + series + " ");
+    if (at == std::string::npos) return -1.0;
+    return atof(text.c_str() + at + series.size() + 2);
+}
+
+// Serves a simulated session's metrics on an ephemeral localhost port while a
+// second thread scrapes it, then checks the final scrape against the run and
+// reports the hot-path cost
+int runMetricsCheck(int steps) {
+    std::unique_ptr<GameMetrics> m(new GameMetrics());
+    std::unique_ptr<MetricsServer> server(new MetricsServer());
+    if (!server->start(*m, 0)) {
+        std::cout << "Cannot listen on 127.0.0.1" << std::endl;
+        return 1;
+    }
+    const int port = server->port();
+
+    // Scrape concurrently with recording; counters must never go backwards
+    std::atomic<bool> running(true);
+    std::atomic<int> scrapes(0), regressions(0);
+    std::thread scraper([&]() {
+        double lastTicks = 0.0;
+        while (running) {
+            std::string r = scrapeMetrics(port, "/metrics");
+            double ticks = metricValue(r, "nhp_ticks_total");
+            if (ticks < lastTicks) regressions++;
+            lastTicks = ticks;
+            scrapes++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    std::unique_ptr<GameWorld> w = telemetryBenchWorld(1, 1, 90210u);
+    long long ends = 0, placements = 0, failures = 0;
+    for (int s = 0; s < steps; ++s) {
+        steerPoliceUnit(*w, w->player);
+        int caught = w->criminalsCaught;
+        auto start = std::chrono::steady_clock::now();
+        updateGame(*w);
+        uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        recordTickMetrics(*m, *w, ns, caught, false);
+        placements += std::min(w->traffic.placements, MAX_TICK_PLACEMENTS);
+        failures += w->traffic.spawnsFailed;
+        if (w->gameOver) {
+            ends++;
+            resetWorld(*w, nextRandom(*w));
+        }
+    }
+    running = false;
+    scraper.join();
+
+    std::string text = scrapeMetrics(port, "/metrics");
+    std::string missing = scrapeMetrics(port, "/nothing");
+    size_t bodyAt = text.find("\r\n\r\n");
+    bool ok = text.compare(0, 15, "HTTP/1.0 200 OK") == 0 && missing.compare(0, 12, "HTTP/1.0 404") == 0 &&
+              metricValue(text, "nhp_ticks_total") == steps &&
+              metricValue(text, "nhp_update_seconds_count") == steps &&
+              metricValue(text, "nhp_spawn_attempts_count") == placements &&
+              metricValue(text, "nhp_spawn_failures_total") == failures &&
+              metricValue(text, "nhp_game_overs_total{cause=\"civilian\"}") +
+              metricValue(text, "nhp_game_overs_total{cause=\"road_edge\"}") == ends &&
+              regressions == 0;
+
+    // Hot path: one tick's worth of recording
+    const int CALLS = 1000000;
+    GameMetrics* sink = m.get();
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < CALLS; ++k) recordTickMetrics(*sink, *w, (uint64_t)(k & 0xFFFF) * 8, 0, true);
+    double recordNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / CALLS;
+    server->stop();
+
+    std::cout << "port=" << port << " steps=" << steps << " runs_ended=" << ends
+              << " concurrent_scrapes=" << scrapes.load() << " regressions=" << regressions.load() << "\n";
+    std::cout << "scrape_bytes=" << (bodyAt == std::string::npos ? 0 : text.size() - bodyAt - 4)
+              << " record_ns_per_tick=" << recordNs << "\n";
+    if (bodyAt != std::string::npos) {
+        std::istringstream body(text.substr(bodyAt + 4));
+        std::string line;
+        while (std::getline(body, line)) {
+            if (line.compare(0, 4, "nhp_") == 0 && line.find("_bucket") == std::string::npos) std::cout << "  " << line << "\n";
+        }
+    }
+    std::cout << (ok ? "PASS" : "FAIL: scrape does not match the run") << std::endl;
+    return ok ? 0 : 1;
+}
+
+// ==================== AUDIO ====================
+// Siren, engine, passing traffic and crash / catch sounds. The game thread
+// turns each tick into a few commands on a lock-free single-producer ring and
+// never waits; a mixer thread drains the ring, renders every live voice into
+// one stereo block and hands it to a sink:
+//   ALSA (build with -DNHP_ALSA -lasound; --audio): real time, the device's
+//     blocking write paces the mixer
+//   WAV file (--audio-wav FILE) or null: clocked by the game, one tick of
+//     audio per tick marker, so a recording lines up with the simulation
+// Voices are synthesized from a shared sine table except the one-shots,
+// which play PCM clips from a pool built once at startup.
+
+const int AUDIO_RATE = 44100;
+const int AUDIO_BLOCK = 256;                // Frames per mix (5.8 ms)
+const int MAX_AUDIO_VOICES = 512;
+const int AUDIO_RING = 4096;                // Commands in flight (power of two)
+const int AUDIO_SINE_BITS = 12;
+const int AUDIO_SINE_SIZE = 1 << AUDIO_SINE_BITS;
+
+// Base voice frequencies (Hz); a voice's pitch multiplies them
+const float SIREN_HZ = 950.0f;
+const float SIREN_SWEEP_HZ = 380.0f;        // Yelp depth, up and down
+const float SIREN_LFO_HZ = 1000.0f / (2.0f * SIREN_BLINK_TICKS * 16.0f); // One sweep per light cycle
+const float ENGINE_HZ = 52.0f;
+const float TRAFFIC_HZ = 88.0f;
+
+// Passing traffic: heard within AUDIBLE_RANGE px of the player. The speed of
+// sound is in px per tick and deliberately low, so Doppler is audible at
+// road speeds (about +-15% for a car passing at 6 px/tick)
+const float AUDIBLE_RANGE = 360.0f;
+const float DOPPLER_SOUND_SPEED = 40.0f;
+
+enum VoiceKind : uint8_t { VOICE_NONE = 0, VOICE_SIREN, VOICE_ENGINE, VOICE_TRAFFIC, VOICE_CLIP };
+enum AudioClip : uint8_t { CLIP_CRASH = 0, CLIP_CATCH, CLIP_COUNT };
+
+enum AudioOp : uint8_t {
+    AUDIO_PLAY,         // (Re)start a voice at the given settings
+    AUDIO_SET,          // New targets; the mixer glides to them over a block
+    AUDIO_STOP,         // Fade out over a block, then free
+    AUDIO_TICK          // Clocked sinks: render one more tick of audio
+};
+
+struct AudioCommand {
+    uint8_t op;
+    uint8_t kind;       // VoiceKind (AUDIO_PLAY)
+    uint8_t clip;       // AudioClip (VOICE_CLIP)
+    uint16_t voice;     // Slot; the game thread owns the allocation
+    float pitch, gain, pan;
+};
+
+// Lock-free queue for one producer thread and one consumer thread. Each side
+// caches the other's index and only reloads it when the ring looks full or
+// empty, so an uncontended push or pop touches one shared cache line.
+template <typename T, int N>
+class SpscRing {
+    static_assert((N & (N - 1)) == 0, "ring size must be a power of two");
+public:
+    bool push(const T &item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - headSeen == (uint32_t)N) {
+            headSeen = head.load(std::memory_order_acquire);
+            if (t - headSeen == (uint32_t)N) return false;
+        }
+        items[t & (N - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tailSeen) {
+            tailSeen = tail.load(std::memory_order_acquire);
+            if (h == tailSeen) return false;
+        }
+        item = items[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate from either side
+    int size() const {
+        return (int)(tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed));
+    }
+
+private:
+    alignas(64) std::atomic<uint32_t> tail{0};
+    uint32_t headSeen = 0;      // Producer's copy of head
+    alignas(64) std::atomic<uint32_t> head{0};
+    uint32_t tailSeen = 0;      // Consumer's copy of tail
+    alignas(64) T items[N];
+};
+
+struct AudioVoice {
+    uint8_t kind = VOICE_NONE;
+    uint8_t clip = 0;
+    bool releasing = false;     // Freed once this block's fade ends
+    float phase = 0.0f;         // Oscillator, in cycles
+    float phase2 = 0.0f;        // Siren sweep / engine sub-oscillator, in cycles
+    float pitch = 1.0f, gain = 0.0f, pan = 0.0f;
+    float toPitch = 1.0f, toGain = 0.0f, toPan = 0.0f;
+    int position = 0;           // Clip frame
+};
+
+// Mixer state; only the mixer thread touches it (or a benchmark directly)
+class AudioMixer {
+public:
+    AudioMixer() {
+        for (int k = 0; k <= AUDIO_SINE_SIZE; ++k) sine[k] = sinf(6.2831853f * k / AUDIO_SINE_SIZE);
+        buildClips();
+    }
+
+    void apply(const AudioCommand &c) {
+        if (c.voice >= MAX_AUDIO_VOICES) return;
+        AudioVoice &v = voices[c.voice];
+        if (c.op == AUDIO_PLAY) {
+            v = AudioVoice();
+            v.kind = c.kind;
+            v.clip = c.clip < CLIP_COUNT ? c.clip : 0;
+            v.pitch = v.toPitch = c.pitch;
+            v.gain = v.toGain = c.gain;
+            v.pan = v.toPan = c.pan;
+        } else if (c.op == AUDIO_SET) {
+            v.toPitch = c.pitch;
+            v.toGain = c.gain;
+            v.toPan = c.pan;
+        } else if (c.op == AUDIO_STOP && v.kind != VOICE_NONE) {
+            v.toGain = 0.0f;
+            v.releasing = true;
+        }
+    }
+
+    // Mixes `frames` (<= AUDIO_BLOCK) stereo frames of all live voices
+    void render(int16_t* out, int frames) {
+        std::fill(mix, mix + 2 * frames, 0.0f);
+        int live = 0;
+        for (int k = 0; k < MAX_AUDIO_VOICES; ++k) {
+            AudioVoice &v = voices[k];
+            if (v.kind == VOICE_NONE) continue;
+            live++;
+            renderVoice(v, frames);
+            if (v.releasing) v.kind = VOICE_NONE;
+        }
+        liveVoices = live;
+        for (int f = 0; f < 2 * frames; ++f) {
+            float s = mix[f] * MASTER_GAIN;
+            s = s > 1.0f ? 1.0f : (s < -1.0f ? -1.0f : s);
+            out[f] = (int16_t)(s * 32767.0f);
+        }
+    }
+
+    int voicesLastBlock() const { return liveVoices; }
+
+private:
+    static constexpr float MASTER_GAIN = 0.8f;
+
+    float table(float phase) const { return sine[(int)(phase * AUDIO_SINE_SIZE)]; }
+
+    // One voice into the mix: pitch, gain and pan glide linearly from their
+    // current values to the targets across the block (no zipper noise)
+    void renderVoice(AudioVoice &v, int n) {
+        float inv = 1.0f / n;
+        float l0 = v.gain * (1.0f - v.pan) * 0.5f, r0 = v.gain * (1.0f + v.pan) * 0.5f;
+        float l1 = v.toGain * (1.0f - v.toPan) * 0.5f, r1 = v.toGain * (1.0f + v.toPan) * 0.5f;
+        float dl = (l1 - l0) * inv, dr = (r1 - r0) * inv;
+        float pitch = v.pitch, dp = (v.toPitch - v.pitch) * inv;
+        float phase = v.phase, phase2 = v.phase2;
+        float* m = mix;
+
+        switch (v.kind) {
+        case VOICE_SIREN:
+            for (int f = 0; f < n; ++f, m += 2) {
+                // Triangle sweep, then a sine with a third harmonic for bite
+                float tri = phase2 < 0.5f ? 4.0f * phase2 - 1.0f : 3.0f - 4.0f * phase2;
+                float s = table(phase) + 0.33f * table(fracf(phase * 3.0f));
+                phase += (SIREN_HZ * pitch + SIREN_SWEEP_HZ * tri) * (1.0f / AUDIO_RATE);
+                phase -= (int)phase;
+                phase2 += SIREN_LFO_HZ / AUDIO_RATE;
+                phase2 -= (int)phase2;
+                m[0] += s * l0; m[1] += s * r0;
+                l0 += dl; r0 += dr; pitch += dp;
+            }
+            break;
+        case VOICE_ENGINE:
+            for (int f = 0; f < n; ++f, m += 2) {
+                // Sawtooth over a sub-octave sine: a rough idle that rises with pitch
+                float s = 0.55f * (2.0f * phase - 1.0f) + 0.6f * table(phase2);
+                float step = ENGINE_HZ * pitch * (1.0f / AUDIO_RATE);
+                phase += step;
+                phase -= (int)phase;
+                phase2 += 0.5f * step;
+                phase2 -= (int)phase2;
+                m[0] += s * l0; m[1] += s * r0;
+                l0 += dl; r0 += dr; pitch += dp;
+            }
+            break;
+        case VOICE_TRAFFIC:
+            for (int f = 0; f < n; ++f, m += 2) {
+                float s = 0.4f * (2.0f * phase - 1.0f) + 0.6f * table(phase);
+                phase += TRAFFIC_HZ * pitch * (1.0f / AUDIO_RATE);
+                phase -= (int)phase;
+                m[0] += s * l0; m[1] += s * r0;
+                l0 += dl; r0 += dr; pitch += dp;
+            }
+            break;
+        case VOICE_CLIP: {
+            const std::vector<float> &clip = clips[v.clip];
+            int end = std::min(n, (int)clip.size() - v.position);
+            const float* pcm = clip.data() + v.position;
+            for (int f = 0; f < end; ++f, m += 2) {
+                m[0] += pcm[f] * l0; m[1] += pcm[f] * r0;
+                l0 += dl; r0 += dr;
+            }
+            v.position += end;
+            if (v.position >= (int)clip.size()) v.releasing = true;
+            break;
+        }
+        default:
+            break;
+        }
+        v.phase = phase;
+        v.phase2 = phase2;
+        v.pitch = v.toPitch;
+        v.gain = v.toGain;
+        v.pan = v.toPan;
+    }
+
+    static float fracf(float x) { return x - (int)x; }
+
+    // Crash: filtered noise with a low thump, both decaying; catch: a rising
+    // two-note chime. Built from a fixed seed, so every run sounds the same.
+    void buildClips() {
+        uint32_t rng = 0x1234567u;
+        auto noise = [&rng]() {
+            rng = rng * 1664525u + 1013904223u;
+            return (rng >> 8) / 8388608.0f - 1.0f;
+        };
+        std::vector<float> &crash = clips[CLIP_CRASH];
+        crash.resize((size_t)(AUDIO_RATE * 0.9f));
+        float low = 0.0f;
+        for (size_t k = 0; k < crash.size(); ++k) {
+            float t = (float)k / AUDIO_RATE;
+            low += 0.25f * (noise() - low);
+            crash[k] = 0.9f * low * expf(-5.0f * t) * 2.0f + 0.8f * sinf(6.2831853f * 58.0f * t) * expf(-9.0f * t);
+        }
+        std::vector<float> &chime = clips[CLIP_CATCH];
+        chime.resize((size_t)(AUDIO_RATE * 0.4f));
+        for (size_t k = 0; k < chime.size(); ++k) {
+            float t = (float)k / AUDIO_RATE;
+            float hz = t < 0.12f ? 880.0f : 1320.0f;
+            float since = t < 0.12f ? t : t - 0.12f;
+            chime[k] = 0.5f * sinf(6.2831853f * hz * t) * expf(-7.0f * since);
+        }
+    }
+
+    AudioVoice voices[MAX_AUDIO_VOICES];
+    float mix[2 * AUDIO_BLOCK];
+    float sine[AUDIO_SINE_SIZE + 1];
+    std::vector<float> clips[CLIP_COUNT];  // PCM pool
+    int liveVoices = 0;
+};
+
+// Where mixed audio goes: 16-bit stereo frames at AUDIO_RATE
+class AudioSink {
+public:
+    virtual ~AudioSink() {}
+    virtual bool realTime() const = 0;      // Paces the mixer itself (blocking writes)
+    virtual bool write(const int16_t* pcm, int frames) = 0;
+};
+
+class NullAudioSink : public AudioSink {
+public:
+    bool realTime() const override { return false; }
+    bool write(const int16_t*, int) override { return true; }
+};
+
+// Canonical 44-byte header; the sizes are patched when the file is closed
+class WavAudioSink : public AudioSink {
+public:
+    ~WavAudioSink() override {
+        if (!file) return;
+        uint32_t data = frames * 4, riff = 36 + data;
+        fseek(file, 4, SEEK_SET);
+        fwrite(&riff, 4, 1, file);
+        fseek(file, 40, SEEK_SET);
+        fwrite(&data, 4, 1, file);
+        fclose(file);
+    }
+
+    bool open(const std::string &path) {
+        file = fopen(path.c_str(), "wb");
+        if (!file) return false;
+        const uint32_t rate = AUDIO_RATE, byteRate = AUDIO_RATE * 4, zero = 0, fmtLen = 16;
+        const uint16_t pcm = 1, channels = 2, align = 4, bits = 16;
+        fwrite("RIFF", 4, 1, file); fwrite(&zero, 4, 1, file); fwrite("WAVEfmt ", 8, 1, file);
+        fwrite(&fmtLen, 4, 1, file); fwrite(&pcm, 2, 1, file); fwrite(&channels, 2, 1, file);
+        fwrite(&rate, 4, 1, file); fwrite(&byteRate, 4, 1, file); fwrite(&align, 2, 1, file);
+        fwrite(&bits, 2, 1, file); fwrite("data", 4, 1, file); fwrite(&zero, 4, 1, file);
+        return true;
+    }
+
+    bool realTime() const override { return false; }
+
+    bool write(const int16_t* pcm, int n) override {
+        frames += (uint32_t)n;
+        return fwrite(pcm, 4, (size_t)n, file) == (size_t)n;
+    }
+
+private:
+    FILE* file = nullptr;
+    uint32_t frames = 0;
+};
+
+#ifdef NHP_ALSA
+// Default ALSA device, about 50 ms of buffering; underruns are recovered
+class AlsaAudioSink : public AudioSink {
+public:
+    ~AlsaAudioSink() override {
+        if (!pcm) return;
+        snd_pcm_drain(pcm);
+        snd_pcm_close(pcm);
+    }
+
+    bool open() {
+        if (snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0) {
+            pcm = nullptr;
+            return false;
+        }
+        return snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+                                  2, AUDIO_RATE, 1, 50000) >= 0;
+    }
+
+    bool realTime() const override { return true; }
+
+    bool write(const int16_t* data, int frames) override {
+        while (frames > 0) {
+            snd_pcm_sframes_t n = snd_pcm_writei(pcm, data, (snd_pcm_uframes_t)frames);
+            if (n < 0) n = snd_pcm_recover(pcm, (int)n, 1);
+            if (n < 0) return false;
+            data += 2 * n;
+            frames -= (int)n;
+        }
+        return true;
+    }
+
+private:
+    snd_pcm_t* pcm = nullptr;
+};
+#endif
+
+// Mixer thread accounting, read after stop()
+struct AudioStats {
+    long long commands = 0;     // Sent by the game thread
+    long long dropped = 0;      // Ring full; the game moved on
+    long long frames = 0;       // Written to the sink
+    long long blocks = 0;
+    int peakVoices = 0;
+    double mixerCpuSeconds = 0.0;
+};
+
+class AudioEngine {
+public:
+    ~AudioEngine() { stop(); }
+
+    bool start(std::unique_ptr<AudioSink> out) {
+        stop();
+        if (!out) return false;
+        sink = std::move(out);
+        if (!mixer) mixer.reset(new AudioMixer());
+        if (!ring) ring.reset(new SpscRing<AudioCommand, AUDIO_RING>());
+        for (int id = 0; id < MAX_ENTITIES; ++id) entitySlot[id] = -1;
+        freeCount = 0;
+        for (int s = MAX_AUDIO_VOICES - 1; s >= FIRST_TRAFFIC_SLOT; --s) freeSlots[freeCount++] = (int16_t)s;
+        sirenOn = engineOn = false;
+        nextOneShot = 0;
+        stats = AudioStats();
+        stopping = false;
+        mixerThread = std::thread(&AudioEngine::mixLoop, this);
+        return true;
+    }
+
+    // Plays out what is queued, then closes the sink
+    void stop() {
+        if (!sink) return;
+        stopping = true;
+        mixerThread.join();
+        sink.reset();
+    }
+
+    bool active() const { return sink != nullptr; }
+    int backlog() const { return ring ? ring->size() : 0; }
+    const AudioStats &report() const { return stats; }
+
+    // Game thread, once per stepped tick: voices follow the world
+    void tick(const GameWorld &w) {
+        if (!sink) return;
+        const EntityStore &e = w.ents;
+        int p = w.player;
+        if (!w.paused) {
+            for (int k = 0; k < w.eventCount; ++k) {
+                const WorldEvent &ev = w.events[k];
+                float pan = clampPan((ev.x - WIDTH * 0.5f) / (WIDTH * 0.5f));
+                playClip(ev.kind == EVENT_CRASH ? CLIP_CRASH : CLIP_CATCH, ev.kind == EVENT_CRASH ? 1.0f : 0.7f, pan);
+            }
+        }
+
+        bool live = p >= 0 && !w.paused && !w.gameOver;
+        bool siren = live && e.pilot[p].sirenOn;
+        if (siren != sirenOn) {
+            send(siren ? AUDIO_PLAY : AUDIO_STOP, VOICE_SIREN, SIREN_SLOT, 1.0f, 0.22f, 0.0f);
+            sirenOn = siren;
+        }
+        if (live) {
+            // Engine note rises with lateral speed and, more gently, road speed
+            float pitch = 1.0f + 0.15f * (w.gameSpeed - 1.0f) + 0.8f * fabsf(e.vx[p]) / 850.0f;
+            send(engineOn ? AUDIO_SET : AUDIO_PLAY, VOICE_ENGINE, ENGINE_SLOT, pitch, 0.28f, 0.0f);
+            engineOn = true;
+        } else if (engineOn) {
+            send(AUDIO_STOP, VOICE_ENGINE, ENGINE_SLOT, 1.0f, 0.0f, 0.0f);
+            engineOn = false;
+        }
+        updateTraffic(w, live);
+        send(AUDIO_TICK, VOICE_NONE, 0, 0.0f, 0.0f, 0.0f);
     }
 
-    if(gameOver) {
-        glColor4f(0.0f, 0.0f, 0.0f, 0.8f);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glBegin(GL_QUADS);
-        glVertex2f(0, 0);
-        glVertex2f(WIDTH, 0);
-        glVertex2f(WIDTH, HEIGHT);
-        glVertex2f(0, HEIGHT);
-        glEnd();
-        glDisable(GL_BLEND);
-
-        glColor3f(1.0f, 0.1f, 0.1f);
-        drawCenteredText(HEIGHT/2 + 50, GLUT_BITMAP_TIMES_ROMAN_24, "GAME OVER!");
+private:
+    static const int SIREN_SLOT = 0;
+    static const int ENGINE_SLOT = 1;
+    static const int ONE_SHOT_SLOTS = 8;    // Reused round-robin; the oldest is cut off
+    static const int FIRST_TRAFFIC_SLOT = 2 + ONE_SHOT_SLOTS;
+
+    static float clampPan(float pan) { return std::min(1.0f, std::max(-1.0f, pan)); }
+
+    void send(uint8_t op, uint8_t kind, int voice, float pitch, float gain, float pan, uint8_t clip = 0) {
+        AudioCommand c;
+        c.op = op;
+        c.kind = kind;
+        c.clip = clip;
+        c.voice = (uint16_t)voice;
+        c.pitch = pitch;
+        c.gain = gain;
+        c.pan = pan;
+        if (ring->push(c)) stats.commands++;
+        else stats.dropped++;
+    }
 
-        glColor3f(1.0f, 1.0f, 1.0f);
-        std::string totalScore = "Final Score: " + std::to_string(score);
-        drawCenteredText(HEIGHT/2 + 15, GLUT_BITMAP_HELVETICA_18, totalScore);
+    void playClip(uint8_t clip, float gain, float pan) {
+        send(AUDIO_PLAY, VOICE_CLIP, 2 + nextOneShot, 1.0f, gain, pan, clip);
+        nextOneShot = (nextOneShot + 1) % ONE_SHOT_SLOTS;
+    }
 
-        std::string highScoreDisplay = "High Score: " + std::to_string(highScore);
-        drawCenteredText(HEIGHT/2 - 5, GLUT_BITMAP_HELVETICA_18, highScoreDisplay);
+    // Every vehicle near the player hums, Doppler-shifted by its speed along
+    // the line between them (positive = moving apart) and panned by its side
+    void updateTraffic(const GameWorld &w, bool live) {
+        const EntityStore &e = w.ents;
+        int p = w.player;
+        for (int id = 0; id < e.count; ++id) {
+            int16_t slot = entitySlot[id];
+            bool audible = live && id != p && e.role[id] != ROLE_NONE;
+            float dx = 0.0f, dy = 0.0f, dist = 0.0f;
+            if (audible) {
+                dx = e.x[id] - e.x[p];
+                dy = (e.y[id] + e.height[id] * 0.5f) - (e.y[p] + e.height[p] * 0.5f);
+                dist = sqrtf(dx * dx + dy * dy);
+                audible = dist < AUDIBLE_RANGE && (slot < 0 || slotRender[slot] == e.render[id]);
+            }
+            if (!audible) {
+                if (slot >= 0) {
+                    send(AUDIO_STOP, VOICE_TRAFFIC, slot, 1.0f, 0.0f, 0.0f);
+                    freeSlots[freeCount++] = slot;
+                    entitySlot[id] = -1;
+                }
+                continue;
+            }
+            float vx = (e.x[id] - e.x0[id]) - (e.x[p] - e.x0[p]);
+            float vy = (e.y[id] - e.y0[id]) - (e.y[p] - e.y0[p]);
+            float away = (dx * vx + dy * vy) / std::max(dist, 1.0f);
+            away = std::max(away, -0.75f * DOPPLER_SOUND_SPEED);
+            static const float BASE[5] = {1.0f, 0.65f, 1.7f, 1.1f, 0.9f}; // By RenderTemplate
+            float pitch = BASE[e.render[id] < 5 ? e.render[id] : 0] * DOPPLER_SOUND_SPEED / (DOPPLER_SOUND_SPEED + away);
+            float gain = 0.16f / (1.0f + dist / 90.0f);
+            float pan = clampPan(dx / (WIDTH * 0.5f));
+            if (slot < 0) {
+                if (freeCount == 0) continue;
+                slot = freeSlots[--freeCount];
+                entitySlot[id] = slot;
+                slotRender[slot] = e.render[id];
+                send(AUDIO_PLAY, VOICE_TRAFFIC, slot, pitch, gain, pan);
+            } else {
+                send(AUDIO_SET, VOICE_TRAFFIC, slot, pitch, gain, pan);
+            }
+        }
+        // Slots of entities beyond the store's end (destroyed at the top)
+        for (int id = e.count; id < MAX_ENTITIES && id < highestSlotted; ++id) {
+            if (entitySlot[id] < 0) continue;
+            send(AUDIO_STOP, VOICE_TRAFFIC, entitySlot[id], 1.0f, 0.0f, 0.0f);
+            freeSlots[freeCount++] = entitySlot[id];
+            entitySlot[id] = -1;
+        }
+        highestSlotted = e.count;
+    }
 
-        std::string caughtTotal = "Criminals Caught: " + std::to_string(criminalsCaught);
-        drawCenteredText(HEIGHT/2 - 25, GLUT_BITMAP_HELVETICA_18, caughtTotal);
+    void renderFrames(long long frames) {
+        int16_t pcm[2 * AUDIO_BLOCK];
+        while (frames > 0) {
+            int n = (int)std::min<long long>(frames, AUDIO_BLOCK);
+            mixer->render(pcm, n);
+            sink->write(pcm, n);
+            frames -= n;
+            stats.frames += n;
+            stats.blocks++;
+            stats.peakVoices = std::max(stats.peakVoices, mixer->voicesLastBlock());
+        }
+    }
 
-        drawCenteredText(HEIGHT/2 - 60, GLUT_BITMAP_HELVETICA_18, "Press R to Restart");
+    // Real-time sinks: mix a block whenever the device takes one. Clocked
+    // sinks: mix exactly AUDIO_RATE * 16 ms per tick marker (fractions carry).
+    void mixLoop() {
+        double cpuStart = cpuSeconds(CPU_THREAD);
+        bool clocked = !sink->realTime();
+        long long ticks = 0;
+        AudioCommand c;
+        while (true) {
+            bool stopNow = stopping.load(); // Read before draining: nothing is pushed after it
+            bool any = false;
+            while (ring->pop(c)) {
+                any = true;
+                if (c.op != AUDIO_TICK) {
+                    mixer->apply(c);
+                } else if (clocked) {
+                    ticks++;
+                    renderFrames(ticks * AUDIO_RATE * 16 / 1000 - stats.frames);
+                }
+            }
+            if (stopNow) break;
+            if (!clocked) renderFrames(AUDIO_BLOCK);
+            else if (!any) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        stats.mixerCpuSeconds = cpuSeconds(CPU_THREAD) - cpuStart;
     }
-}
 
-// ==================== GAME LOGIC ====================
+    // Game thread
+    int16_t entitySlot[MAX_ENTITIES];
+    uint8_t slotRender[MAX_AUDIO_VOICES];
+    int16_t freeSlots[MAX_AUDIO_VOICES];
+    int freeCount = 0;
+    int highestSlotted = 0;
+    int nextOneShot = 0;
+    bool sirenOn = false, engineOn = false;
+
+    // Shared
+    std::unique_ptr<SpscRing<AudioCommand, AUDIO_RING>> ring;
+    std::atomic<bool> stopping{false};
+
+    // Mixer thread (stats are read once it has joined, except the counts of
+    // commands, which the game thread keeps)
+    std::unique_ptr<AudioMixer> mixer;
+    std::unique_ptr<AudioSink> sink;
+    std::thread mixerThread;
+    AudioStats stats;
+};
 
-// ==================== GAME LOGIC ====================
+AudioEngine audio;
 
-Car generateRandomCivilianTemplate() {
-    Car car;
-    car.type = randInt(0, 2);
-    car.color = randInt(0, 4);
-    car.active = true;
-    
-    if (car.type == 0) { // Regular car
-        car.width = (float)randInt(30, 42);
-        car.height = (float)randInt(45, 60);
-        car.speed = 1.6f + randFloat(0.0f, 1.2f);
-    } else if (car.type == 1) { // Bus
-        car.width = (float)randInt(48, 62);
-        car.height = (float)randInt(55, 70);
-        car.speed = 0.9f + randFloat(0.0f, 0.6f);
-    } else { // Bike
-        car.width = (float)randInt(18, 24);
-        car.height = (float)randInt(30, 42);
-        car.speed = 2.6f + randFloat(0.0f, 1.0f);
+void stopAudio() {
+    audio.stop();
+}
+
+// Opens the requested backend and starts the mixer; an empty path means ALSA
+bool startAudio(const std::string &wavPath) {
+    if (!wavPath.empty()) {
+        std::unique_ptr<WavAudioSink> wav(new WavAudioSink());
+        if (!wav->open(wavPath)) return false;
+        return audio.start(std::move(wav));
     }
-    return car;
+#ifdef NHP_ALSA
+    std::unique_ptr<AlsaAudioSink> alsa(new AlsaAudioSink());
+    if (!alsa->open()) return false;
+    return audio.start(std::move(alsa));
+#else
+    return false;
+#endif
 }
 
-bool canPlaceAt(float cx, float cy, float cw, float ch, int ignoreIndex = -1) {
-    for (int i = 0; i < (int)civilianCars.size(); ++i) {
-        if (i == ignoreIndex) continue;
-        const Car &c = civilianCars[i];
-        if (!c.active) continue;
-        if (rectOverlap(cx, cy, cw, ch, c.x, c.y, c.width, c.height, 10.0f)) return false;
+// Mixer cost for `voices` simultaneous voices (siren, engine and traffic
+// mixed, a clip restarted as it ends), then a game-driven session into a WAV
+// file (or a null sink) checking that every tick's audio arrived
+int runAudioBenchmark(int voices, int steps, const std::string &savePath) {
+    voices = std::min(std::max(1, voices), MAX_AUDIO_VOICES);
+    std::unique_ptr<AudioMixer> mixer(new AudioMixer());
+    for (int k = 0; k < voices; ++k) {
+        AudioCommand c = {AUDIO_PLAY, (uint8_t)(VOICE_SIREN + k % 4), (uint8_t)(k % CLIP_COUNT), (uint16_t)k,
+                          0.8f + 0.4f * (k % 7) / 7.0f, 0.5f / voices, (k % 9) / 4.5f - 1.0f};
+        mixer->apply(c);
     }
-    if (criminal.active) {
-        if (rectOverlap(cx, cy, cw, ch, criminal.x, criminal.y, criminal.width, criminal.height, 10.0f)) return false;
+    const int BLOCKS = 4000;
+    int16_t pcm[2 * AUDIO_BLOCK];
+    double cpu = 1e30;
+    for (int pass = 0; pass < 3; ++pass) {
+        double start = cpuSeconds(CPU_THREAD);
+        for (int b = 0; b < BLOCKS; ++b) {
+            mixer->render(pcm, AUDIO_BLOCK);
+            if (b % 64 != 63) continue;
+            for (int k = 3; k < voices; k += 4) { // Restart clips before the shortest ends
+                AudioCommand c = {AUDIO_PLAY, VOICE_CLIP, (uint8_t)(k % CLIP_COUNT), (uint16_t)k, 1.0f, 0.5f / voices, 0.0f};
+                mixer->apply(c);
+            }
+        }
+        cpu = std::min(cpu, cpuSeconds(CPU_THREAD) - start);
     }
-    return true;
+    double audioSeconds = (double)BLOCKS * AUDIO_BLOCK / AUDIO_RATE;
+    double usPerBlock = cpu * 1e6 / BLOCKS;
+    double pctPer100 = cpu / audioSeconds * 100.0 * 100.0 / voices;
+    std::cout << "voices=" << voices << " block_frames=" << AUDIO_BLOCK << " rate=" << AUDIO_RATE
+              << " us_per_block=" << usPerBlock << " ns_per_voice_frame=" << cpu * 1e9 / ((double)BLOCKS * AUDIO_BLOCK * voices)
+              << "\ncpu_pct_per_100_voices=" << pctPer100 << "\n";
+
+    // Game-driven: the bench yields while the ring is half full, standing in
+    // for the real tick rate; the game itself never waits
+    std::unique_ptr<AudioEngine> engine(new AudioEngine());
+    std::unique_ptr<AudioSink> sink;
+    if (savePath.empty()) sink.reset(new NullAudioSink());
+    else {
+        std::unique_ptr<WavAudioSink> wav(new WavAudioSink());
+        if (!wav->open(savePath)) {
+            std::cout << "Cannot write " << savePath << std::endl;
+            return 1;
+        }
+        sink = std::move(wav);
+    }
+    engine->start(std::move(sink));
+    std::unique_ptr<GameWorld> w = telemetryBenchWorld(1, 1, 4242u);
+    double tickCpu = 0.0;
+    for (int s = 0; s < steps; ++s) {
+        telemetryBenchStep(*w);
+        while (engine->backlog() > AUDIO_RING / 2) std::this_thread::yield();
+        double start = cpuSeconds(CPU_THREAD);
+        engine->tick(*w);
+        tickCpu += cpuSeconds(CPU_THREAD) - start;
+    }
+    engine->stop();
+    const AudioStats &st = engine->report();
+    long long expected = (long long)steps * AUDIO_RATE * 16 / 1000;
+    bool ok = st.dropped == 0 && st.frames == expected;
+    std::cout << "ticks=" << steps << " commands=" << st.commands << " dropped=" << st.dropped
+              << " peak_voices=" << st.peakVoices << " frames=" << st.frames << " expected=" << expected << "\n";
+    std::cout << "game_us_per_tick=" << tickCpu * 1e6 / steps << " mixer_cpu_pct_of_realtime="
+              << st.mixerCpuSeconds / (expected / (double)AUDIO_RATE) * 100.0
+              << (savePath.empty() ? "" : " wav=" + savePath) << "\n";
+    std::cout << (ok ? "PASS" : "FAIL: audio lost") << std::endl;
+    return ok ? 0 : 1;
 }
 
-void spawnCivilianAtIndex(int idx, int tries = 50) {
-    if (idx < 0 || idx >= (int)civilianCars.size()) return;
+// ==================== SCENARIOS ====================
+// Scripted traffic for stress runs and benchmarks (--scenario NAME). A
+// scenario is a C++20 coroutine over a headless world. Between co_awaits on
+// ticks or conditions it spawns convoys, blocks lanes with stalled vehicles,
+// sets gameSpeed or moves the criminal. The runner steps the world (player on
+// autopilot; a crash tows the hit car and is counted, the run goes on) and
+// resumes the script once what it waits for has happened, so a scenario
+// replays tick for tick. A C++17 build leaves the section out.
+
+#ifdef NHP_SCENARIOS
+
+// A civilian that paces the road scroll stands still on the road
+const float STALLED_SPEED = ROAD_SCROLL;
+
+// Owns one scenario script's coroutine frame
+class ScenarioTask {
+public:
+    struct promise_type {
+        ScenarioTask get_return_object() {
+            return ScenarioTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; } // The runner starts it on tick 0
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
 
-    Car templateCar = generateRandomCivilianTemplate();
-    Car car = templateCar;
+    explicit ScenarioTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+    ScenarioTask(ScenarioTask &&other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    ScenarioTask(const ScenarioTask&) = delete;
+    ScenarioTask &operator=(const ScenarioTask&) = delete;
+    ~ScenarioTask() { if (handle) handle.destroy(); }
 
-    int attempt = 0;
-    bool placed = false;
+    bool done() const { return !handle || handle.done(); }
+    void resume() { if (!done()) handle.resume(); }
 
-    while (attempt < tries && !placed) {
-        // Simple random lane selection
-        int lane = randInt(0, LANE_COUNT - 1);
-        car.lane = lane;
-        float jitter = randFloat(-15.0f, 15.0f);
-        car.x = laneX(lane) + jitter;
+private:
+    std::coroutine_handle<promise_type> handle;
+};
 
-        // Random spawn distance
-        car.y = HEIGHT + 100.0f + randFloat(0.0f, 400.0f) + attempt * 50.0f;
+typedef bool (*ScenarioCondition)(const GameWorld &w);
 
-        if (canPlaceAt(car.x, car.y, car.width, car.height, idx)) {
-            placed = true;
+// What a script sees: the world, the runner's tick clock and the actions
+class ScenarioContext {
+public:
+    explicit ScenarioContext(GameWorld &w) : w(w) {}
+
+    GameWorld &world() { return w; }
+    long long tick() const { return now; }
+
+    // co_await s.ticks(n): resume n ticks from now
+    struct TickWait {
+        ScenarioContext &s;
+        long long n;
+        bool await_ready() const { return n <= 0; }
+        void await_suspend(std::coroutine_handle<>) { s.wakeAt = s.now + n; s.condition = nullptr; }
+        void await_resume() const {}
+    };
+    TickWait ticks(long long n) { return TickWait{*this, n}; }
+
+    // co_await s.until(cond, limit): resume on the first tick cond holds,
+    // or after `limit` ticks whichever comes first
+    struct ConditionWait {
+        ScenarioContext &s;
+        ScenarioCondition cond;
+        long long limit;
+        bool await_ready() const { return cond(s.w); }
+        void await_suspend(std::coroutine_handle<>) { s.wakeAt = s.now + limit; s.condition = cond; }
+        void await_resume() const {}
+    };
+    ConditionWait until(ScenarioCondition cond, long long limit = 1LL << 40) { return ConditionWait{*this, cond, limit}; }
+
+    // Runner: is the script due to run this tick?
+    bool due() const { return now >= wakeAt || (condition && condition(w)); }
+    void advance() { now++; }
+
+    // `count` civilians of one type nose to tail in a lane, from `y` upwards
+    // (just above the screen by default); speed < 0 keeps each type's random
+    // pace. Returns how many found room.
+    int spawnConvoy(int lane, int count, int type, float gap = 24.0f, float y = HEIGHT + 80.0f, float speed = -1.0f) {
+        lane = std::min(std::max(lane, 0), LANE_COUNT - 1);
+        int placed = 0;
+        for (int k = 0; k < count; ++k) {
+            Car car = civilianTemplate(w, type);
+            car.lane = lane;
+            car.x = laneX(lane);
+            car.y = y;
+            if (speed >= 0.0f) car.speed = speed;
+            y += car.height + gap;
+            if (!canPlaceAt(w, car.x, car.y, car.width, car.height)) continue;
+            EntityStore &e = w.ents;
+            int id = createEntity(e, ROLE_CIVILIAN);
+            if (id < 0) break;
+            e.x[id] = car.x;
+            e.y[id] = car.y;
+            e.width[id] = car.width;
+            e.height[id] = car.height;
+            e.speed[id] = car.speed;
+            e.pace[id] = car.speed;
+            e.render[id] = (uint8_t)car.type;
+            e.color[id] = (uint8_t)car.color;
+            e.lane[id] = (int8_t)car.lane;
+            settleEntity(e, id);
+            w.activeCivilianCount++;
+            placed++;
         }
-        ++attempt;
+        return placed;
     }
 
-    // Fallback: push higher
-    if (!placed) {
-        for (int k = 0; k < 50; ++k) {
-            car.y += 70.0f;
-            if (canPlaceAt(car.x, car.y, car.width, car.height, idx)) {
-                placed = true;
-                break;
-            }
+    // Broken-down buses covering `length` px of a lane; they keep still on the road
+    int blockLane(int lane, float length, float y = HEIGHT + 80.0f) {
+        int buses = (int)(length / (BASE_VEH_H + 8.0f)) + 1;
+        return spawnConvoy(lane, buses, RENDER_BUS, 8.0f, y, STALLED_SPEED);
+    }
+
+    void setGameSpeed(float speed) { w.gameSpeed = std::min(std::max(speed, 0.1f), 4.5f); }
+
+    // First criminal to a lane at height y (its planner takes over from there)
+    void moveCriminal(int lane, float y) {
+        EntityStore &e = w.ents;
+        for (int id = 0; id < e.count; ++id) {
+            if (e.role[id] != ROLE_CRIMINAL) continue;
+            lane = std::min(std::max(lane, 0), LANE_COUNT - 1);
+            e.lane[id] = (int8_t)lane;
+            e.brain[id].targetLane = lane;
+            e.brain[id].baseX = laneX(lane);
+            e.x[id] = laneX(lane);
+            e.y[id] = y;
+            settleEntity(e, id);
+            armCriminalWatch(w, id);
+            return;
         }
     }
 
-    civilianCars[idx] = car;
-    if (placed) {
-        activeCivilianCount++;
+    int randomLane() { return randInt(w, 0, LANE_COUNT - 1); }
+
+private:
+    GameWorld &w;
+    long long now = 0;
+    long long wakeAt = 0;
+    ScenarioCondition condition = nullptr;
+};
+
+// Waves of cars and the odd bus in every lane, the next wave once the road
+// has drained below 18 civilians
+ScenarioTask rushHourScenario(ScenarioContext &s) {
+    s.setGameSpeed(1.5f);
+    for (int wave = 0;; ++wave) {
+        for (int lane = 0; lane < LANE_COUNT; ++lane) {
+            s.spawnConvoy(lane, 4, (wave + lane) % 4 == 0 ? RENDER_BUS : RENDER_CAR, 30.0f);
+        }
+        co_await s.until([](const GameWorld &w) { return w.activeCivilianCount < 18; }, 240);
+        co_await s.ticks(40);
     }
 }
 
-// Simple civilian spawning based on police speed
-void trySpawnNewCivilian() {
-    // Calculate spawn chance based on police speed
-    float policeSpeedFactor = fabsf(police.vx) / 100.0f; // Normalize speed
-    float spawnChance = 0.02f + policeSpeedFactor * 0.03f; // Higher speed = more spawns
-    
-    // Calculate current spawn interval based on police speed
-    float currentSpawnInterval = baseSpawnInterval - policeSpeedFactor * 1.5f;
-    if (currentSpawnInterval < 0.5f) currentSpawnInterval = 0.5f; // Minimum interval
-    
-    // Check if enough time has passed since last spawn
-    if (gameTime - lastSpawnTime < currentSpawnInterval) return;
-    
-    // Check spawn chance
-    if (randFloat(0.0f, 1.0f) > spawnChance) return;
-    
-    // Limit number of active civilians (max 8)
-    if (activeCivilianCount >= 8) return;
-    
-    // Find an inactive slot and spawn
-    for (int i = 0; i < (int)civilianCars.size(); ++i) {
-        if (!civilianCars[i].active) {
-            spawnCivilianAtIndex(i, 60);
-            lastSpawnTime = gameTime;
-            return;
+// Two lanes walled off by stalled buses, a different lane left open each
+// wave, with the criminal sent through the gap
+ScenarioTask busWallScenario(ScenarioContext &s) {
+    for (int wave = 0;; ++wave) {
+        int open = wave % LANE_COUNT;
+        for (int lane = 0; lane < LANE_COUNT; ++lane) {
+            if (lane != open) s.blockLane(lane, 420.0f);
         }
+        s.moveCriminal(open, HEIGHT + 40.0f);
+        // Next wave once the wall has scrolled past the bottom of the screen
+        co_await s.until([](const GameWorld &w) {
+            const EntityStore &e = w.ents;
+            for (int i = 0; i < e.count; ++i) {
+                if (e.role[i] == ROLE_CIVILIAN && e.render[i] == RENDER_BUS && e.speed[i] == STALLED_SPEED &&
+                    e.y[i] + e.height[i] > 0.0f) return false;
+            }
+            return true;
+        }, 600);
+        co_await s.ticks(30);
     }
 }
 
-void spawnCriminalOriginal() {
-    float xleft = ROAD_LEFT + 60.0f;
-    float xrange = (ROAD_RIGHT - ROAD_LEFT) - 120.0f;
-    criminal.baseX = xleft + randFloat(0.0f, xrange);
-    criminal.x = criminal.baseX;
-    criminal.y = HEIGHT + 250.0f + randFloat(0.0f, 250.0f);
-    criminal.width = BASE_VEH_W;
-    criminal.height = BASE_VEH_H;
-    criminal.speed = 2.4f + randFloat(0.0f, 0.4f);
-    criminal.zigzag = randFloat(0.0f, 3.14f);
-    criminal.active = true;
+// Tight packs of bikes in every lane at double speed
+ScenarioTask bikeSwarmScenario(ScenarioContext &s) {
+    for (;;) {
+        s.setGameSpeed(2.0f);
+        for (int lane = 0; lane < LANE_COUNT; ++lane) s.spawnConvoy(lane, 6, RENDER_BIKE, 14.0f);
+        co_await s.ticks(50);
+    }
 }
 
-void initGame() {
-    // Compute lane centers
-    float segment = (ROAD_RIGHT - ROAD_LEFT) / (float)LANE_COUNT;
-    for (int i = 0; i < LANE_COUNT; ++i) {
-        LANE_X[i] = ROAD_LEFT + segment * 0.5f + i * segment;
+// Top speed held every tick (catches and restarts reset it), with pairs of
+// cars dropped into random lanes
+ScenarioTask maxSpeedScenario(ScenarioContext &s) {
+    for (;;) {
+        s.setGameSpeed(4.5f);
+        if (s.tick() % 20 == 0) s.spawnConvoy(s.randomLane(), 2, RENDER_CAR, 40.0f);
+        co_await s.ticks(1);
     }
+}
 
-    // Lane markers
-    laneMarkers.clear();
-    for(int i = -100; i < HEIGHT + 200; i += 65) {
-        laneMarkers.push_back({LANE_X[0], (float)i});
-        laneMarkers.push_back({LANE_X[2], (float)i});
-    }
+struct ScenarioInfo {
+    const char* name;
+    const char* about;
+    ScenarioTask (*script)(ScenarioContext &s);
+};
 
-    // Civilian cars - start with fewer and let them spawn dynamically
-    civilianCars.clear();
-    const int MAX_CIV_COUNT = 12; // Maximum possible civilians
-    civilianCars.resize(MAX_CIV_COUNT);
-    
-    // Initialize all as inactive
-    for (int i = 0; i < MAX_CIV_COUNT; ++i) {
-        civilianCars[i].active = false;
+const ScenarioInfo SCENARIOS[] = {
+    {"rush-hour", "waves of cars and buses in every lane at 1.5x", rushHourScenario},
+    {"bus-wall", "stalled buses wall off two lanes; the criminal runs the gap", busWallScenario},
+    {"bike-swarm", "packs of bikes in every lane at 2x", bikeSwarmScenario},
+    {"max-speed", "game speed pinned at 4.5x with cars dropped in", maxSpeedScenario},
+};
+const int SCENARIO_COUNT = (int)(sizeof(SCENARIOS) / sizeof(SCENARIOS[0]));
+
+const ScenarioInfo* findScenario(const std::string &name) {
+    for (const ScenarioInfo &info : SCENARIOS) {
+        if (name == info.name) return &info;
     }
-    
-    // Spawn initial civilians with more spacing
-    activeCivilianCount = 0;
-    int initialSpawns = 3 + randInt(0, 2); // 3-4 initial cars
-    for (int i = 0; i < initialSpawns; ++i) {
-        spawnCivilianAtIndex(i, 50);
+    return nullptr;
+}
+
+// Steps a world under a script; the context must outlive the coroutine, so
+// it is declared first. The world is built with crashEndsRun off: a reset
+// would clear the scripted traffic and restart from an empty road, so the
+// autopilot's crashes are only counted.
+class ScenarioRunner {
+public:
+    ScenarioRunner(const ScenarioInfo &info, GameWorld &w) : w(w), ctx(w), task(info.script(ctx)) {}
+
+    void step() {
+        if (ctx.due()) task.resume(); // Runs the script to its next co_await
+        steerPoliceUnit(w, w.player);
+        updateGame(w);
+        for (int k = 0; k < w.eventCount; ++k) crashCount += w.events[k].kind == EVENT_CRASH;
+        ctx.advance();
     }
 
-    // Reset police
-    police.x = WIDTH / 2.0f;
-    police.y = 80.0f;
-    police.vx = 0.0f;
-    police.leftPressed = police.rightPressed = false;
-    police.sirenOn = true;
-    police.sirenBlink = 0;
-    police.maxVx = 250.0f;
+    long long crashes() const { return crashCount; }
 
-    // Spawn criminal
-    spawnCriminalOriginal();
+private:
+    GameWorld &w;
+    ScenarioContext ctx;
+    ScenarioTask task;
+    long long crashCount = 0;
+};
 
-    // Stars
-    stars.clear();
-    for (int i = 0; i < 100; ++i) {
-        int sx = rand() % WIDTH;
-        int sy = rand() % HEIGHT;
-        if (sx >= (int)ROAD_LEFT - 15 && sx <= (int)ROAD_RIGHT + 15) {
-            sx = (sx < WIDTH/2) ? sx - 180 : sx + 180;
-            if (sx < 0) sx += WIDTH;
-            if (sx >= WIDTH) sx -= WIDTH;
+struct ScenarioResult {
+    double usPerTick = 0.0, p99Us = 0.0, maxUs = 0.0;
+    double msPerFrame = 0.0;            // Software raster, when rendering
+    double meanCivilians = 0.0;
+    int peakCivilians = 0;
+    long long crashes = 0;              // Autopilot crashes (the run goes on)
+    uint32_t finalHash = 0;             // Of the packed end state
+};
+
+static ScenarioResult runScenarioOnce(const ScenarioInfo &info, int policeUnits, int criminals, int steps,
+                                      TileRasterizer* raster) {
+    std::unique_ptr<GameWorld> w(new GameWorld());
+    w->config.policeUnits = policeUnits;
+    w->config.criminalUnits = criminals;
+    w->config.crashEndsRun = false;
+    resetWorld(*w, 20240u);
+    ScenarioRunner runner(info, *w);
+    std::unique_ptr<ParticleEffects> fx;
+    DrawList dl;
+    if (raster) fx.reset(new ParticleEffects());
+
+    ScenarioResult r;
+    std::vector<double> tickUs((size_t)steps);
+    double civilians = 0.0, renderMs = 0.0;
+    for (int s = 0; s < steps; ++s) {
+        auto start = std::chrono::steady_clock::now();
+        runner.step();
+        tickUs[s] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        civilians += w->activeCivilianCount;
+        r.peakCivilians = std::max(r.peakCivilians, w->activeCivilianCount);
+        if (raster) {
+            fx->tick(*w);
+            recordScene(dl, *w, fx.get());
+            raster->render(dl, CLEAR_RGB);
+            renderMs += (raster->lastBinUs() + raster->lastRasterUs()) / 1000.0;
         }
-        stars.emplace_back(sx, sy);
     }
-
-    score = 0;
-    scoreTimer = 0.0f;
-    criminalsCaught = 0;
-    gameOver = false;
-    paused = false;
-    gameSpeed = 1.0f;
-    
-    // Reset spawning control
-    gameTime = 0.0f;
-    lastSpawnTime = 0.0f;
-    baseSpawnInterval = 3.0f;
+    double total = 0.0;
+    for (double us : tickUs) total += us;
+    r.usPerTick = total / steps;
+    std::sort(tickUs.begin(), tickUs.end());
+    r.p99Us = tickUs[(size_t)(steps - 1) * 99 / 100];
+    r.maxUs = tickUs.back();
+    r.msPerFrame = renderMs / steps;
+    r.meanCivilians = civilians / steps;
+    r.crashes = runner.crashes();
+    std::unique_ptr<uint8_t[]> image(new uint8_t[MAX_SNAPSHOT_BYTES]);
+    r.finalHash = hashBytes(image.get(), packWorld(*w, image.get()));
+    return r;
 }
 
-// ==================== GAME UPDATE ====================
+// One named scenario (or "all", the standard workload): simulation cost per
+// tick, optionally the software raster's cost per frame, traffic density, and
+// a second run that must end in the identical state
+int runScenarioBenchmark(const std::string &name, int policeUnits, int criminals, int steps,
+                         bool render, int threads) {
+    if (name == "list") {
+        for (const ScenarioInfo &info : SCENARIOS) printf("%-12s %s\n", info.name, info.about);
+        return 0;
+    }
+    std::vector<const ScenarioInfo*> chosen;
+    for (const ScenarioInfo &info : SCENARIOS) {
+        if (name == "all" || name == info.name) chosen.push_back(&info);
+    }
+    if (chosen.empty()) {
+        std::cout << "Unknown scenario " << name << " (--scenario list)" << std::endl;
+        return 1;
+    }
 
-void updateGame() {
-    if (gameOver || paused) return;
+    std::unique_ptr<TileRasterizer> raster;
+    if (render) {
+        srand(31337u);
+        scatterStars();
+        raster.reset(new TileRasterizer(WIDTH, HEIGHT, RASTER_TILE, threads, true));
+    }
+    std::cout << "police=" << policeUnits << " criminals=" << criminals << " steps=" << steps;
+    if (render) std::cout << " render_threads=" << threads;
+    std::cout << "\n";
+    bool repeatable = true;
+    for (const ScenarioInfo* info : chosen) {
+        ScenarioResult a = runScenarioOnce(*info, policeUnits, criminals, steps, raster.get());
+        ScenarioResult b = runScenarioOnce(*info, policeUnits, criminals, steps, nullptr);
+        bool same = a.finalHash == b.finalHash;
+        repeatable = repeatable && same;
+        printf("%-12s us_per_tick=%.2f p99=%.2f max=%.1f civilians mean=%.1f peak=%d crashes=%lld",
+               info->name, a.usPerTick, a.p99Us, a.maxUs, a.meanCivilians, a.peakCivilians, a.crashes);
+        if (render) printf(" raster_ms_per_frame=%.3f", a.msPerFrame);
+        printf(" repeat=%s\n", same ? "match" : "MISMATCH");
+    }
+    return repeatable ? 0 : 1;
+}
 
-    const float dt = 16.0f / 1000.0f;
-    
-    // Update game time
-    gameTime += dt;
+#endif // NHP_SCENARIOS
 
-    // Gradually increase max speed (difficulty)
-    police.maxVx += 2.5f * dt * 60.0f;
-    if (police.maxVx > 650.0f) police.maxVx = 650.0f;
+// ==================== INPUT LATENCY ====================
+// Traces each steering change from the key event, through the simulation
+// step that first sees it, to the buffer swap that shows the result. Swap
+// return is the closest point to "photons" we can observe from here.
 
-    // Police movement with acceleration and damping
-    const float ACC = 1200.0f;
-    const float DAMP = 6.0f;
+typedef std::chrono::steady_clock::time_point TimePoint;
 
-    if (police.leftPressed && !police.rightPressed) {
-        police.vx -= ACC * dt;
-        if (police.vx < -police.maxVx) police.vx = -police.maxVx;
-    } else if (police.rightPressed && !police.leftPressed) {
-        police.vx += ACC * dt;
-        if (police.vx > police.maxVx) police.vx = police.maxVx;
-    } else {
-        police.vx -= police.vx * DAMP * dt;
-        if (fabsf(police.vx) < 0.5f) police.vx = 0.0f;
-    }
+// Fixed 0.5 ms buckets up to 100 ms (last bucket collects the overflow)
+class LatencyHistogram {
+public:
+    static const int BUCKETS = 200;
+    static constexpr double BUCKET_MS = 0.5;
 
-    police.x += police.vx * dt;
+    LatencyHistogram() : counts(), total(0), sumMs(0.0), maxMs(0.0) {}
 
-    // Check if police hits road edge -> game over
-    float halfw = police.width * 0.5f;
-    if (police.x - halfw <= ROAD_LEFT || police.x + halfw >= ROAD_RIGHT) {
-        checkAndUpdateHighScore(); // Update high score before game over
-        gameOver = true;
-        return;
+    void record(double ms) {
+        int b = (int)(ms / BUCKET_MS);
+        if (b < 0) b = 0;
+        if (b >= BUCKETS) b = BUCKETS - 1;
+        counts[b]++;
+        total++;
+        sumMs += ms;
+        if (ms > maxMs) maxMs = ms;
     }
 
-    // Update lane markers
-    for(auto& marker : laneMarkers) {
-        marker.y -= 3.5f * gameSpeed;
-        if(marker.y < -100) marker.y = HEIGHT + 100;
+    long long count() const { return total; }
+    double meanMs() const { return total ? sumMs / total : 0.0; }
+    double worstMs() const { return maxMs; }
+
+    // Upper edge of the bucket holding the p-th percentile
+    double percentileMs(double p) const {
+        if (total == 0) return 0.0;
+        long long target = (long long)ceil(p / 100.0 * total);
+        long long seen = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen += counts[b];
+            if (seen >= target) return (b + 1) * BUCKET_MS;
+        }
+        return maxMs;
     }
 
-    // Move civilian cars and maintain lane alignment
-    for (auto &car : civilianCars) {
-        if (!car.active) continue;
-        car.y -= car.speed * gameSpeed;
-        float targetX = laneX(car.lane);
-        float dx = targetX - car.x;
-        car.x += dx * 0.08f; // Smooth return to lane
+    void print(std::ostream &out, const char* name) const {
+        out << name << ": n=" << total << " mean=" << meanMs() << "ms p50=" << percentileMs(50)
+            << "ms p95=" << percentileMs(95) << "ms p99=" << percentileMs(99)
+            << "ms max=" << maxMs << "ms\n";
+        for (int b = 0; b < BUCKETS; ++b) {
+            if (!counts[b]) continue;
+            out << "  " << b * BUCKET_MS << "-" << (b + 1) * BUCKET_MS << "ms " << counts[b] << "\n";
+        }
     }
 
-    // Overlap resolution in lanes (vertical spacing)
-    for (int lane = 0; lane < LANE_COUNT; ++lane) {
-        std::vector<int> laneVehicles;
-        for (int i = 0; i < (int)civilianCars.size(); ++i) {
-            if (!civilianCars[i].active) continue;
-            if (civilianCars[i].lane == lane) laneVehicles.push_back(i);
-        }
+private:
+    long long counts[BUCKETS];
+    long long total;
+    double sumMs;
+    double maxMs;
+};
 
-        // Check if criminal is in this lane
-        bool crimInLane = false;
-        if (criminal.active) {
-            float dist = fabsf(criminal.x - laneX(lane));
-            if (dist < 70.0f) crimInLane = true;
+class InputLatencyTracer {
+public:
+    // A steering key changed state
+    void onInput() {
+        if (!pending) {
+            pending = true;
+            inputAt = std::chrono::steady_clock::now();
         }
+    }
 
-        struct VehicleItem {
-            float y;
-            float h;
-            int type; // 0=civilian, 1=criminal
-            int idx;
-        };
+    // A simulation step consumed the current input state
+    void onStep() {
+        if (!pending) return;
+        pending = false;
+        if (inFlight) return; // Earlier change not on screen yet; it bounds this one
+        inFlight = true;
+        flightInput = inputAt;
+        flightStep = std::chrono::steady_clock::now();
+        inputToStep.record(ms(flightInput, flightStep));
+    }
 
-        std::vector<VehicleItem> items;
-        for (int i : laneVehicles) {
-            items.push_back({civilianCars[i].y, civilianCars[i].height, 0, i});
-        }
-        if (crimInLane) {
-            items.push_back({criminal.y, criminal.height, 1, -1});
-        }
+    // The back buffer holding that step was just swapped
+    void onSwap() {
+        if (!inFlight) return;
+        inFlight = false;
+        TimePoint now = std::chrono::steady_clock::now();
+        stepToSwap.record(ms(flightStep, now));
+        inputToSwap.record(ms(flightInput, now));
+    }
 
-        std::sort(items.begin(), items.end(), [](const VehicleItem& a, const VehicleItem& b) {
-            return a.y < b.y;
-        });
+    void report(std::ostream &out) const {
+        if (inputToSwap.count() == 0) return;
+        out << "Input latency (" << (lowLatency ? "low-latency loop" : "timer loop") << ")\n";
+        inputToStep.print(out, "input->step");
+        stepToSwap.print(out, "step->swap");
+        inputToSwap.print(out, "input->swap");
+    }
 
-        // Adjust spacing
-        for (size_t j = 1; j < items.size(); ++j) {
-            float prevY = items[j-1].y;
-            float prevH = items[j-1].h;
-            float curY = items[j].y;
-            float curH = items[j].h;
-            float minGap = std::max(prevH, curH) * 0.85f + 20.0f;
-
-            if (curY - prevY < minGap) {
-                float desiredY = prevY + minGap;
-                if (items[j].type == 0) {
-                    civilianCars[items[j].idx].y = desiredY;
-                } else {
-                    criminal.y = desiredY;
-                }
-                items[j].y = desiredY;
-            }
-        }
+    LatencyHistogram inputToStep, stepToSwap, inputToSwap;
+    bool lowLatency = false;
+
+private:
+    static double ms(TimePoint a, TimePoint b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
     }
 
-    // Respawn civilians that fell off and try spawning new ones
-    for (int i = 0; i < (int)civilianCars.size(); ++i) {
-        Car &car = civilianCars[i];
-        if (car.active && car.y < -350.0f) {
-            car.active = false; // Deactivate instead of immediate respawn
-            activeCivilianCount--;
-            score += 10;
-        }
+    bool pending = false;
+    bool inFlight = false;
+    TimePoint inputAt, flightInput, flightStep;
+};
+
+InputLatencyTracer latencyTracer;
+bool showLatency = false;
+
+// Heap allocations made during the previous frame (NHP_ALLOC_COUNT builds; see FRAME MEMORY)
+long long allocationsAtFrameEnd = 0;
+long long lastFrameAllocations = 0;
+
+void printLatencyReport() {
+    latencyTracer.report(std::cerr);
+}
+
+void drawLatencyOverlay() {
+    if (!showLatency) return;
+    const LatencyHistogram &h = latencyTracer.inputToSwap;
+    char text[96];
+    snprintf(text, sizeof(text), "Input lag p50 %.1f  p99 %.1f  max %.1f ms (n=%lld)",
+             h.percentileMs(50), h.percentileMs(99), h.worstMs(), h.count());
+    glColor3f(0.6f, 1.0f, 1.0f);
+    glRasterPos2i(10, 10);
+    for (const char* c = text; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+
+    int row = 26;
+#ifdef NHP_ALLOC_COUNT
+    snprintf(text, sizeof(text), "Heap allocs last frame: %lld", lastFrameAllocations);
+    glRasterPos2i(10, row);
+    for (const char* c = text; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+    row += 16;
+#endif
+    if (softwareRaster) {
+        snprintf(text, sizeof(text), "Software raster: bin %.2f  tiles %.2f ms (%d threads, %d cmds)",
+                 softwareRaster->lastBinUs() / 1000.0, softwareRaster->lastRasterUs() / 1000.0,
+                 softwareRaster->threads(), sceneList.size());
+        glRasterPos2i(10, row);
+        for (const char* c = text; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+        row += 16;
     }
-    
-    // Try to spawn new civilians dynamically
-    trySpawnNewCivilian();
+    snprintf(text, sizeof(text), "Render %dx%d -> %dx%d (%d%%%s)", renderW, renderH,
+             screenArea.w, screenArea.h, (int)lrintf(renderScale.scale * 100.0f),
+             renderScale.enabled ? ", auto" : "");
+    glRasterPos2i(10, row);
+    for (const char* c = text; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+}
 
-    // Update criminal (zigzag pattern)
-    if (criminal.active) {
-        criminal.y -= criminal.speed * gameSpeed;
-        criminal.zigzag += 0.10f * gameSpeed;
-        criminal.x = criminal.baseX + sinf(criminal.zigzag) * 20.0f;
+// ==================== GLUT CALLBACKS ====================
 
-        // Keep criminal on road
-        if (criminal.x < ROAD_LEFT + 35.0f) criminal.x = ROAD_LEFT + 35.0f;
-        if (criminal.x > ROAD_RIGHT - 35.0f) criminal.x = ROAD_RIGHT - 35.0f;
+// Frame pacing: the 16 ms step loop runs only while something moves. A paused
+// world, or a finished run once its sparks have settled, is a static frame:
+// the loop stops and the window redraws on input or expose only.
+bool stepLoopRunning = false;       // A 16 ms step timer is pending
+const int IDLE_POLL_MS = 500;       // Shared high score refresh (stepping or idle)
 
-        // Check if police caught criminal
-        if (checkCollisionScaled(police.x, police.y, police.width, police.height,
-                                 criminal.x, criminal.y, criminal.width, criminal.height)) {
-            score += 50;
-            criminalsCaught++;
+bool isStaticFrame() {
+    if (netplay) return false; // The peer keeps sending; stepping is also receiving
+    return world.paused || (world.gameOver && effects.live() == 0);
+}
 
-            // Increase difficulty every 2 criminals caught
-            if (criminalsCaught % 2 == 0) {
-                police.maxVx += 45.0f;
-                if (police.maxVx > 850.0f) police.maxVx = 850.0f;
-                gameSpeed *= 1.15f;
-                if (gameSpeed > 4.5f) gameSpeed = 4.5f;
-            }
+// CPU use split by loop state (stepping vs idle), printed to stderr on exit
+class LoopCpuMeter {
+public:
+    void enter(bool stepping) {
+        if (started && stepping == current) return;
+        sample();
+        current = stepping;
+        started = true;
+    }
 
-            spawnCriminalOriginal();
+    void report(std::ostream &out) {
+        if (!started) return;
+        sample();
+        const char* names[2] = {"idle", "stepping"};
+        for (int k = 1; k >= 0; --k) {
+            double pct = wall[k] > 0.0 ? 100.0 * cpu[k] / wall[k] : 0.0;
+            out << "cpu " << names[k] << ": " << pct << "% of one core over " << wall[k] << " s\n";
         }
+    }
 
-        // Respawn if off screen
-        if (criminal.y < -350.0f) {
-            spawnCriminalOriginal();
+private:
+    void sample() {
+        double nowWall = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        double nowCpu = cpuSeconds(CPU_PROCESS);
+        if (started) {
+            wall[current] += nowWall - lastWall;
+            cpu[current] += nowCpu - lastCpu;
         }
+        lastWall = nowWall;
+        lastCpu = nowCpu;
     }
 
-    // Update siren blink
-    police.sirenBlink = (police.sirenBlink + 1) % 30;
+    bool started = false;
+    bool current = false;
+    double wall[2] = {0.0, 0.0}, cpu[2] = {0.0, 0.0};
+    double lastWall = 0.0, lastCpu = 0.0;
+};
 
-    // Check police vs civilian collisions
-    for (const auto &car : civilianCars) {
-        if (!car.active) continue;
-        if (checkCollisionScaled(police.x, police.y, police.width, police.height,
-                                 car.x, car.y, car.width, car.height)) {
-            checkAndUpdateHighScore(); // Update high score before game over
-            gameOver = true;
-            return;
-        }
-    }
+LoopCpuMeter cpuMeter;
 
-    // Score increment over time
-    scoreTimer += dt;
-    while (scoreTimer >= SCORE_INTERVAL) {
-        score += 1;
-        scoreTimer -= SCORE_INTERVAL;
-    }
+void printCpuReport() {
+    cpuMeter.report(std::cerr);
 }
 
-// ==================== GLUT CALLBACKS ====================
+// Software path of a frame: scene into the tiles, then up to the screen area
+// when the internal resolution is lower (screenArea.w x screenArea.h pixels)
+const uint32_t* renderSoftwareFrame(const GameWorld &w, ParticleEffects* fx) {
+    sceneList.setScale((float)renderW / WIDTH, (float)renderH / HEIGHT);
+    recordScene(sceneList, w, fx);
+    softwareRaster->render(sceneList, CLEAR_RGB, nightLighting);
+    bool scaled = renderW != screenArea.w || renderH != screenArea.h;
+    return scaled ? upscaler.run(softwareRaster->pixels()) : softwareRaster->pixels();
+}
+
+// After the swap: latency and frame-time bookkeeping, then frame end (scratch
+// is dead, and the allocation counter gets a per-frame reading)
+void finishFrame(std::chrono::steady_clock::time_point frameStart) {
+    latencyTracer.onSwap();
+    metrics.frameTime.observe((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - frameStart).count());
+    frameArena.reset();
+    long long allocs = heapAllocationCount();
+    lastFrameAllocations = allocs - allocationsAtFrameEnd;
+    allocationsAtFrameEnd = allocs;
+}
 
 void display() {
+    auto frameStart = std::chrono::steady_clock::now();
+    glViewport(0, 0, windowW, windowH);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    drawBackground();
-    drawRoad();
-    drawLaneMarkers();
-
-    // Sort and draw civilians (back to front)
-    std::vector<const Car*> sorted;
-    for (const auto &c : civilianCars) {
-        if (c.active) sorted.push_back(&c);
+    bool scaled = renderW != screenArea.w || renderH != screenArea.h;
+    if (softwareRaster) {
+        const uint32_t* pixels = renderSoftwareFrame(world, &effects);
+        glViewport(screenArea.x, screenArea.y, screenArea.w, screenArea.h);
+        glRasterPos2i(0, 0);
+        glDrawPixels(screenArea.w, screenArea.h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    } else {
+        recordScene(sceneList, world, &effects);
+        glViewport(screenArea.x, screenArea.y, renderW, renderH);
+        replayGl(sceneList);
+        if (nightLighting) replayLightsGl(sceneList);
+        if (scaled) stretchSceneGl();
+        glViewport(screenArea.x, screenArea.y, screenArea.w, screenArea.h);
     }
-    std::sort(sorted.begin(), sorted.end(), [](const Car* a, const Car* b) {
-        return a->y > b->y;
-    });
+    drawUI(world);
+    if (netplay) drawNetplayStatus();
+    drawLatencyOverlay();
+
+    // Auto scale: GL work is asynchronous, so wait for it before timing
+    if (renderScale.enabled) {
+        if (!softwareRaster) glFinish();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        if (renderScale.onFrame(ms)) applyRenderSize();
+    }
+
+    glutSwapBuffers();
+    finishFrame(frameStart);
+}
 
-    for (const auto* cp : sorted) {
-        drawCivilianCar(*cp);
+// Window resized: the game keeps its WIDTH x HEIGHT coordinates inside the
+// largest fitting area, and the internal resolution follows that area
+void reshape(int w, int h) {
+    windowW = std::max(1, w);
+    windowH = std::max(1, h);
+    screenArea = fitScreenArea(windowW, windowH);
+    applyRenderSize();
+    glutPostRedisplay();
+}
+
+// Zero-allocation guarantee: after a warm-up, stepping a world (with the
+// segment prefetcher attached, as in the windowed game), recording it into a
+// rewind ring, writing its observation and drawing it through display()'s
+// software path (tiled raster, bilinear upscale, frame-end bookkeeping) must
+// not touch the heap. Only the GL calls (HUD text, glDrawPixels, swap) are
+// left out; they need a window. Needs a -DNHP_ALLOC_COUNT build.
+int runAllocCheck(int policeUnits, int criminals, int steps, int numThreads) {
+    if (heapAllocationCount() < 0) {
+        std::cout << "alloc-check needs a build with -DNHP_ALLOC_COUNT" << std::endl;
+        return 1;
+    }
+    const int WARMUP_STEPS = 300;
+    std::unique_ptr<SegmentPrefetcher> prefetcher(new SegmentPrefetcher());
+    std::unique_ptr<GameWorld> w(new GameWorld());
+    w->config.policeUnits = policeUnits;
+    w->config.criminalUnits = criminals;
+    w->road.source = prefetcher.get();
+    uint32_t seed = 4242u;
+    resetWorld(*w, seed);
+    SnapshotRing ring(4u * 1024 * 1024, 600); // Small enough to wrap during the run
+    std::unique_ptr<ParticleEffects> fx(new ParticleEffects());
+    softwareRasterThreads = numThreads;
+    screenArea = {0, 0, WIDTH, HEIGHT};
+    renderScale.scale = 0.75f; // Not a multiple of the area: the bilinear upscaler
+    applyRenderSize();
+
+    float obs[OBS_SIZE];
+    uint32_t rng = 2463534242u;
+    long long before = 0, runs = 1;
+    for (int s = 0; s < WARMUP_STEPS + steps; ++s) {
+        if (s == WARMUP_STEPS) before = heapAllocationCount();
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        PoliceControl* pc = playerControl(*w);
+        pc->leftPressed = (rng % ACTION_COUNT) == ACTION_LEFT;
+        pc->rightPressed = (rng % ACTION_COUNT) == ACTION_RIGHT;
+        updateGame(*w);
+        ring.record(*w);
+        writeObservation(*w, obs);
+        fx->tick(*w);
+        auto frameStart = std::chrono::steady_clock::now();
+        renderSoftwareFrame(*w, fx.get());
+        finishFrame(frameStart);
+        if (w->gameOver) {
+            resetWorld(*w, ++seed);
+            runs++;
+        }
+    }
+    long long allocs = heapAllocationCount() - before;
+
+    std::cout << "police=" << policeUnits << " criminals=" << criminals << " steps=" << steps
+              << " runs=" << runs << " render=" << renderW << "x" << renderH << " upscaled_to="
+              << screenArea.w << "x" << screenArea.h << " threads=" << numThreads << "\n";
+    std::cout << "arena_peak_bytes=" << frameArena.peak() << " heap_allocations=" << allocs << std::endl;
+    if (allocs != 0) {
+        std::cout << "FAIL: steady-state frames allocated on the heap" << std::endl;
+        return 1;
     }
+    std::cout << "PASS" << std::endl;
+    return 0;
+}
 
-    drawCriminalCar();
-    drawPoliceCar();
-    drawUI();
+// Netplay step: deliver what arrived, advance unless too far ahead of the
+// peer, and send our inputs (every frame, so losses are covered quickly)
+void stepNetplay() {
+    double nowMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    netLink->poll(*netplay, nowMs);
+    bool wasOver = world.gameOver;
+    int caught = world.criminalsCaught;
+    auto start = std::chrono::steady_clock::now();
+    if (netplay->advance(netKeys | netLatch)) {
+        // Includes any rollback re-simulation this step needed
+        uint64_t updateNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        netLatch = 0;
+        effects.tick(world);
+        audio.tick(world);
+        latencyTracer.onStep();
+        recordTickMetrics(metrics, world, updateNs, caught, wasOver);
+    }
+    netLink->send(*netplay);
+    netRunEnds.scan(*netplay, [](int score) { checkAndUpdateHighScore(score); });
+}
 
-    glutSwapBuffers();
+// One fixed 16 ms simulation step for the windowed world
+void stepGame() {
+    if (netplay) {
+        stepNetplay();
+        return;
+    }
+    bool wasOver = world.gameOver;
+    bool running = !world.gameOver && !world.paused;
+    int caught = world.criminalsCaught;
+    auto start = std::chrono::steady_clock::now();
+    updateGame(world);
+    uint64_t updateNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    effects.tick(world);
+    audio.tick(world);
+    if (running) {
+        latencyTracer.onStep();
+        history->record(world);
+        if (telemetry.active()) telemetry.record(world);
+        recordTickMetrics(metrics, world, updateNs, caught, wasOver);
+    }
+    if (world.gameOver && !wasOver) {
+        checkAndUpdateHighScore(world.score); // Update high score once the run ends
+    }
 }
 
 void timer(int value) {
-    updateGame();
+    stepGame();
     glutPostRedisplay();
+    if (isStaticFrame()) {
+        // This frame is drawn once and stays up; wakeLoop() restarts stepping
+        stepLoopRunning = false;
+        cpuMeter.enter(false);
+        return;
+    }
     glutTimerFunc(16, timer, 0); // ~60 FPS
 }
 
+// Something changed outside the step loop (a key, a restart): redraw once,
+// and restart the 16 ms loop if the world is moving again
+void wakeLoop() {
+    glutPostRedisplay();
+    if (latencyTracer.lowLatency || stepLoopRunning || isStaticFrame()) return;
+    stepLoopRunning = true;
+    cpuMeter.enter(true);
+    glutTimerFunc(16, timer, 0);
+}
+
+// A shared leaderboard may report a new best at any time; while idle the
+// frame is redrawn for it, while stepping the next frame shows it anyway
+void idlePoll(int value) {
+    int before = highScore;
+    syncHighScore();
+    if (highScore != before && !stepLoopRunning) glutPostRedisplay();
+    glutTimerFunc(IDLE_POLL_MS, idlePoll, 0);
+}
+
+// Blocks until the window system has an event queued or timeoutMs passes.
+// Call right after glutMainLoopEvent(), which leaves the queue empty.
+void waitForWindowEvents(int timeoutMs) {
+#ifdef _WIN32
+    MsgWaitForMultipleObjects(0, nullptr, FALSE, (DWORD)timeoutMs, QS_ALLINPUT);
+#else
+    Display* display = glXGetCurrentDisplay();
+    if (display) netWaitReadable(ConnectionNumber(display), timeoutMs);
+    else std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+#endif
+}
+
+// Opt-in replacement for glutMainLoop: sleeps to just before each step, pumps
+// window events right then (so the step sees the freshest key state) and
+// renders in the same iteration instead of waiting for a posted redisplay.
+void runLowLatencyLoop() {
+    const auto STEP = std::chrono::milliseconds(16);
+    const auto SCORE_POLL = std::chrono::milliseconds(IDLE_POLL_MS);
+    auto next = std::chrono::steady_clock::now();
+    auto nextScorePoll = next + SCORE_POLL;
+    while (true) {
+        std::this_thread::sleep_until(next - std::chrono::milliseconds(1));
+        while (std::chrono::steady_clock::now() < next) std::this_thread::yield();
+
+        glutMainLoopEvent();
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextScorePoll) {
+            int before = highScore;
+            syncHighScore();
+            if (highScore != before) glutPostRedisplay();
+            nextScorePoll = now + SCORE_POLL;
+        }
+        if (isStaticFrame()) {
+            // Nothing moves: block until input or the next score poll; input
+            // and expose events redraw via GLUT
+            cpuMeter.enter(false);
+            waitForWindowEvents((int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                nextScorePoll - now).count() + 1);
+            next = std::chrono::steady_clock::now();
+            continue;
+        }
+        cpuMeter.enter(true);
+        stepGame();
+        display();
+
+        next += STEP;
+        now = std::chrono::steady_clock::now();
+        if (now > next + 4 * STEP) next = now; // Fell far behind (e.g. window drag)
+    }
+}
+
+const long long REWIND_TICKS = 60;
+
 void keyboard(unsigned char key, int x, int y) {
+    if (netplay && key != 27) {
+        // The world is shared: siren and restart travel as inputs; no pause or rewind
+        if (key == 's' || key == 'S') netLatch |= INPUT_SIREN;
+        else if (key == 'r' || key == 'R') netLatch |= INPUT_RESTART;
+        else if (key == 'l' || key == 'L') showLatency = !showLatency;
+        else if (key == 'n' || key == 'N') nightLighting = !nightLighting;
+        else if (key == 'v' || key == 'V') view.enabled = !view.enabled;
+        wakeLoop();
+        return;
+    }
     switch(key) {
         case 27: // ESC
             exit(0);
@@ -1113,38 +7780,78 @@ void keyboard(unsigned char key, int x, int y) {
             break;
         case 's':
         case 'S':
-            if (!gameOver) {
-                police.sirenOn = !police.sirenOn;
+            if (!world.gameOver && playerControl(world)) {
+                PoliceControl &pc = *playerControl(world);
+                pc.sirenOn = !pc.sirenOn;
             }
             break;
         case 'p':
         case 'P':
-            if (!gameOver) {
-                paused = !paused;
+            if (!world.gameOver) {
+                world.paused = !world.paused;
+            }
+            break;
+        case 'l':
+        case 'L':
+            showLatency = !showLatency;
+            break;
+        case 'n':
+        case 'N':
+            nightLighting = !nightLighting;
+            break;
+        case 'v':
+        case 'V':
+            view.enabled = !view.enabled;
+            break;
+        case 'b':
+        case 'B': {
+            // Rewind one second and pause; resuming plays on from there
+            long long target = std::max(history->oldest(), history->newest() - REWIND_TICKS);
+            if (history->restore(target, world)) {
+                history->truncateAfter(target);
+                world.paused = true;
+                effects.clear();
             }
             break;
+        }
     }
+    wakeLoop();
 }
 
 void specialKeyDown(int key, int x, int y) {
-    if (gameOver) return;
+    if (netplay) {
+        if (key == GLUT_KEY_LEFT) netKeys |= INPUT_LEFT;
+        if (key == GLUT_KEY_RIGHT) netKeys |= INPUT_RIGHT;
+        return;
+    }
+    if (world.gameOver || !playerControl(world)) return;
     switch(key) {
         case GLUT_KEY_LEFT:
-            police.leftPressed = true;
+            if (!playerControl(world)->leftPressed) latencyTracer.onInput(); // Ignore key repeat
+            playerControl(world)->leftPressed = true;
             break;
         case GLUT_KEY_RIGHT:
-            police.rightPressed = true;
+            if (!playerControl(world)->rightPressed) latencyTracer.onInput();
+            playerControl(world)->rightPressed = true;
             break;
     }
 }
 
 void specialKeyUp(int key, int x, int y) {
+    if (netplay) {
+        if (key == GLUT_KEY_LEFT) netKeys &= (uint8_t)~INPUT_LEFT;
+        if (key == GLUT_KEY_RIGHT) netKeys &= (uint8_t)~INPUT_RIGHT;
+        return;
+    }
+    if (!playerControl(world)) return;
     switch(key) {
         case GLUT_KEY_LEFT:
-            police.leftPressed = false;
+            latencyTracer.onInput();
+            playerControl(world)->leftPressed = false;
             break;
         case GLUT_KEY_RIGHT:
-            police.rightPressed = false;
+            latencyTracer.onInput();
+            playerControl(world)->rightPressed = false;
             break;
     }
 }
@@ -1158,13 +7865,183 @@ void init() {
     gluOrtho2D(0, WIDTH, 0, HEIGHT);
     glMatrixMode(GL_MODELVIEW);
 
+    screenArea = fitScreenArea(windowW, windowH);
+    applyRenderSize(); // Rasterizer / scene texture at the internal resolution
+
+    initLightSprite();
+    buildPerspectiveTables(WIDTH, HEIGHT);
+
     srand((unsigned int)time(NULL));
-    loadHighScore(); // Load high score at startup
+    loadHighScore(); // Load high score at startup (store chosen in main)
     initGame();
+    if (!netOptions.peer.empty()) {
+        // Both peers start the same run: fixed seed, rival slot for the other player
+        world.config.rival = netOptions.rival;
+        resetWorld(world, netOptions.seed);
+        if (!startNetplay(world)) {
+            world.config.rival = RIVAL_NONE;
+            initGame();
+        }
+    }
+}
+
+// Select the score store and unit counts from command-line options
+// (after glutInit strips its own)
+void parseArgs(int argc, char** argv) {
+    int renderThreads = 0;
+    std::string leaderboard;
+    std::string kiosk = "kiosk";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--leaderboard" && i + 1 < argc) leaderboard = argv[++i];
+        else if (arg == "--kiosk" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (validKioskName(name)) kiosk = name;
+            else std::cerr << "Ignoring bad --kiosk \"" << name << "\" (one word, no spaces)\n";
+        }
+        else if (arg == "--police" && i + 1 < argc) world.config.policeUnits = std::max(1, atoi(argv[++i]));
+        else if (arg == "--criminals" && i + 1 < argc) world.config.criminalUnits = std::max(0, atoi(argv[++i]));
+        else if (arg == "--low-latency-input") latencyTracer.lowLatency = true;
+        else if (arg == "--perspective") view.enabled = true;
+        else if (arg == "--software-render") softwareRasterThreads = std::max(1u, std::thread::hardware_concurrency());
+        else if (arg == "--render-threads" && i + 1 < argc) renderThreads = std::max(1, atoi(argv[++i]));
+        else if (arg == "--render-scale" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value == "auto") renderScale.enabled = true;
+            else renderScale.maxScale = std::min(1.0f, std::max(MIN_RENDER_SCALE, atoi(value.c_str()) / 100.0f));
+            renderScale.scale = renderScale.maxScale;
+        }
+        else if (arg == "--telemetry" && i + 1 < argc) {
+            if (!telemetry.start(argv[++i])) std::cerr << "Cannot write telemetry to " << argv[i] << "\n";
+        }
+        else if (arg == "--netplay" && i + 1 < argc) netOptions.peer = argv[++i];
+        else if (arg == "--net-port" && i + 1 < argc) netOptions.port = atoi(argv[++i]);
+        else if (arg == "--net-side" && i + 1 < argc) netOptions.side = atoi(argv[++i]) == 1 ? 1 : 0;
+        else if (arg == "--rival" && i + 1 < argc) netOptions.rival = std::string(argv[++i]) == "criminal" ? RIVAL_CRIMINAL : RIVAL_POLICE;
+        else if (arg == "--seed" && i + 1 < argc) netOptions.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--input-delay" && i + 1 < argc) netOptions.inputDelay = std::min(std::max(0, atoi(argv[++i])), MAX_INPUT_DELAY);
+        else if (arg == "--latency" && i + 1 < argc) netOptions.latencyMs = std::max(0, atoi(argv[++i]));
+        else if (arg == "--loss" && i + 1 < argc) netOptions.lossPct = (float)atof(argv[++i]);
+        else if (arg == "--audio") {
+            if (!startAudio("")) std::cerr << "No audio device (ALSA needs a build with -DNHP_ALSA -lasound)\n";
+        }
+        else if (arg == "--audio-wav" && i + 1 < argc) {
+            if (!startAudio(argv[++i])) std::cerr << "Cannot write audio to " << argv[i] << "\n";
+        }
+        else if (arg == "--metrics-port" && i + 1 < argc) {
+            int port = atoi(argv[++i]);
+            if (!metricsServer.start(metrics, port)) std::cerr << "Cannot serve metrics on 127.0.0.1:" << port << "\n";
+        }
+    }
+
+    std::unique_ptr<ScoreStore> local(new FileScoreStore(HIGH_SCORE_FILE));
+    size_t colon = leaderboard.rfind(':');
+    if (colon != std::string::npos && netStartup()) {
+        std::string host = leaderboard.substr(0, colon);
+        int port = atoi(leaderboard.c_str() + colon + 1);
+        scoreStore.reset(new LeaderboardClient(host, port, kiosk, std::move(local)));
+    } else {
+        if (!leaderboard.empty()) std::cerr << "Ignoring bad --leaderboard " << leaderboard << "\n";
+        scoreStore = std::move(local);
+    }
+    if (softwareRasterThreads > 0 && renderThreads > 0) softwareRasterThreads = renderThreads;
+}
+
+// Modes that run without a window; returns -1 when the game should start
+int runHeadlessMode(int argc, char** argv) {
+    bool envBench = false, aiBench = false, convoyBench = false, allocCheck = false, snapshotBench = false;
+    bool rasterBench = false, particleBench = false, upscaleBench = false, sweepCheck = false, netplayTest = false;
+    bool telemetryBench = false;
+    bool metricsCheck = false;
+    bool audioBench = false;
+    bool trafficBench = false;
+    int vehicles = 4096;
+    bool render = false;
+    bool customUnits = false;           // Scenarios default to the real game's 1 + 1
+    std::string scenario;
+    int voices = 100;
+    int latencyMs = 60, inputDelay = 2;
+    float lossPct = 5.0f;
+    uint8_t rival = RIVAL_POLICE;
+    std::string savePath, loadPath;
+    int criminals = 64, traffic = 200, police = 16;
+    int areaW = 2 * WIDTH, areaH = 2 * HEIGHT;
+    int envs = 64, threads = (int)std::max(1u, std::thread::hardware_concurrency()), steps = 2000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--env-bench") envBench = true;
+        else if (arg == "--ai-bench") aiBench = true;
+        else if (arg == "--convoy-bench") convoyBench = true;
+        else if (arg == "--alloc-check") allocCheck = true;
+        else if (arg == "--snapshot-bench") snapshotBench = true;
+        else if (arg == "--raster-bench") rasterBench = true;
+        else if (arg == "--particle-bench") particleBench = true;
+        else if (arg == "--upscale-bench") upscaleBench = true;
+        else if (arg == "--sweep-check") sweepCheck = true;
+        else if (arg == "--netplay-test") netplayTest = true;
+        else if (arg == "--telemetry-bench") telemetryBench = true;
+        else if (arg == "--metrics-check") metricsCheck = true;
+        else if (arg == "--audio-bench") audioBench = true;
+        else if (arg == "--traffic-bench") trafficBench = true;
+        else if (arg == "--vehicles" && i + 1 < argc) vehicles = std::max(1, atoi(argv[++i]));
+        else if (arg == "--scenario" && i + 1 < argc) scenario = argv[++i];
+        else if (arg == "--render") render = true;
+        else if (arg == "--voices" && i + 1 < argc) voices = std::max(1, atoi(argv[++i]));
+        else if (arg == "--latency" && i + 1 < argc) latencyMs = std::max(0, atoi(argv[++i]));
+        else if (arg == "--loss" && i + 1 < argc) lossPct = (float)atof(argv[++i]);
+        else if (arg == "--input-delay" && i + 1 < argc) inputDelay = std::min(std::max(0, atoi(argv[++i])), MAX_INPUT_DELAY);
+        else if (arg == "--rival" && i + 1 < argc) rival = std::string(argv[++i]) == "criminal" ? RIVAL_CRIMINAL : RIVAL_POLICE;
+        else if (arg == "--area" && i + 1 < argc) sscanf(argv[++i], "%dx%d", &areaW, &areaH);
+        else if (arg == "--perspective") view.enabled = true;
+        else if (arg == "--save" && i + 1 < argc) savePath = argv[++i];
+        else if (arg == "--load" && i + 1 < argc) loadPath = argv[++i];
+        else if (arg == "--police" && i + 1 < argc) {
+            police = std::max(1, atoi(argv[++i]));
+            customUnits = true;
+        }
+        else if (arg == "--criminals" && i + 1 < argc) {
+            criminals = std::max(1, atoi(argv[++i]));
+            customUnits = true;
+        }
+        else if (arg == "--traffic" && i + 1 < argc) traffic = std::max(0, atoi(argv[++i]));
+        else if (arg == "--envs" && i + 1 < argc) envs = std::max(1, atoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(1, atoi(argv[++i]));
+        else if (arg == "--steps" && i + 1 < argc) steps = std::max(1, atoi(argv[++i]));
+    }
+    if (envBench) return runEnvBenchmark(envs, threads, steps);
+    if (aiBench) return runAiBenchmark(criminals, traffic, steps);
+    if (convoyBench) return runConvoyBenchmark(police, criminals, steps);
+    if (trafficBench) return runTrafficBenchmark(vehicles, steps);
+    if (sweepCheck) return runSweepCheck(steps * 50);
+    if (netplayTest) return runNetplayLoopback(latencyMs, lossPct, steps, inputDelay, rival);
+    if (allocCheck) return runAllocCheck(police, criminals, steps, threads);
+    if (snapshotBench) return runSnapshotBenchmark(police, criminals, steps, savePath, loadPath);
+    if (telemetryBench) return runTelemetryBenchmark(police, criminals, steps, savePath);
+    if (metricsCheck) return runMetricsCheck(steps);
+    if (audioBench) return runAudioBenchmark(voices, steps, savePath);
+    buildPerspectiveTables(WIDTH, HEIGHT);
+    if (rasterBench) return runRasterBenchmark(police, criminals, threads, std::min(steps, 600));
+    if (particleBench) return runParticleBenchmark(steps);
+    if (!scenario.empty()) {
+#ifdef NHP_SCENARIOS
+        return runScenarioBenchmark(scenario, customUnits ? police : 1, customUnits ? criminals : 1, steps, render, threads);
+#else
+        (void)render;
+        (void)customUnits;
+        std::cout << "Scenarios need a C++20 build (-std=c++20)" << std::endl;
+        return 1;
+#endif
+    }
+    if (upscaleBench) return runUpscaleBenchmark(std::max(16, areaW), std::max(16, areaH), threads, std::min(steps, 300));
+    return -1;
 }
 
 int main(int argc, char** argv) {
+    int headless = runHeadlessMode(argc, argv);
+    if (headless >= 0) return headless;
+
     glutInit(&argc, argv);
+    parseArgs(argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_ALPHA);
     glutInitWindowSize(WIDTH, HEIGHT);
     glutInitWindowPosition(100, 100);
@@ -1173,10 +8050,21 @@ int main(int argc, char** argv) {
     init();
 
     glutDisplayFunc(display);
+    glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard);
     glutSpecialFunc(specialKeyDown);
     glutSpecialUpFunc(specialKeyUp);
-    glutTimerFunc(0, timer, 0);
+    atexit(printLatencyReport); // Histograms go to stderr on exit
+    atexit(printCpuReport);
+    atexit(stopTelemetry); // Writes the last partial chunk
+    atexit(stopAudio);     // Finishes the WAV header
+
+    if (latencyTracer.lowLatency) {
+        runLowLatencyLoop();
+        return 0;
+    }
+    wakeLoop();
+    glutTimerFunc(IDLE_POLL_MS, idlePoll, 0);
 
     glutMainLoop();
     return 0;
@@ -0,0 +1,210 @@
+// net_socket.h
+// Night Highway Patrol - minimal socket helpers shared by the game and its tools
+// Winsock on Windows (link with -lws2_32), BSD sockets everywhere else.
+// Include this BEFORE <GL/glut.h>: on Windows glut pulls in windows.h, which
+// would otherwise drag in the old winsock.h and clash with winsock2.h.
+
+#ifndef NET_SOCKET_H
+#define NET_SOCKET_H
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+const socket_t INVALID_SOCK = INVALID_SOCKET;
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+typedef int socket_t;
+const socket_t INVALID_SOCK = -1;
+#endif
+
+#include <cstring>
+#include <string>
+
+// One-time library init (WSAStartup on Windows, nothing elsewhere)
+inline bool netStartup() {
+#ifdef _WIN32
+    static bool started = false;
+    if (!started) {
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+        started = true;
+    }
+#endif
+    return true;
+}
+
+inline void netClose(socket_t s) {
+    if (s == INVALID_SOCK) return;
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+// Receive/send timeouts so a dead peer can never hang a worker forever
+inline void netSetTimeouts(socket_t s, int timeoutMs) {
+#ifdef _WIN32
+    DWORD tv = (DWORD)timeoutMs;
+#else
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+#endif
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof(tv));
+}
+
+inline bool netMakeAddr(const char* host, int port, sockaddr_in &addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (std::string(host) == "localhost") host = "127.0.0.1";
+    return inet_pton(AF_INET, host, &addr.sin_addr) == 1;
+}
+
+// Blocking TCP connect (IPv4 dotted address or "localhost")
+inline socket_t netConnectTcp(const char* host, int port, int timeoutMs) {
+    sockaddr_in addr;
+    if (!netMakeAddr(host, port, addr)) return INVALID_SOCK;
+    socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCK) return INVALID_SOCK;
+    netSetTimeouts(s, timeoutMs);
+    if (connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        netClose(s);
+        return INVALID_SOCK;
+    }
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+    return s;
+}
+
+// Listening TCP socket bound to the given address
+inline socket_t netListenTcp(const char* host, int port, int backlog = 64) {
+    sockaddr_in addr;
+    if (!netMakeAddr(host, port, addr)) return INVALID_SOCK;
+    socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCK) return INVALID_SOCK;
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, backlog) != 0) {
+        netClose(s);
+        return INVALID_SOCK;
+    }
+    return s;
+}
+
+// Waits up to timeoutMs for data (or a pending connection on a listener)
+inline bool netWaitReadable(socket_t s, int timeoutMs) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(s, &readable);
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    return select((int)s + 1, &readable, nullptr, nullptr, &tv) > 0;
+}
+
+inline bool netSendAll(socket_t s, const char* data, size_t len) {
+    while (len > 0) {
+#ifdef MSG_NOSIGNAL
+        int n = (int)send(s, data, (int)len, MSG_NOSIGNAL); // No SIGPIPE on dead peers
+#else
+        int n = (int)send(s, data, (int)len, 0);
+#endif
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Non-blocking UDP socket bound to host:port (port 0 picks a free port)
+inline socket_t netBindUdp(const char* host, int port) {
+    sockaddr_in addr;
+    if (!netMakeAddr(host, port, addr)) return INVALID_SOCK;
+    socket_t s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCK) return INVALID_SOCK;
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        netClose(s);
+        return INVALID_SOCK;
+    }
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    return s;
+}
+
+// Port a bound socket ended up on (0 on error)
+inline int netLocalPort(socket_t s) {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(s, (sockaddr*)&addr, &len) != 0) return 0;
+    return ntohs(addr.sin_port);
+}
+
+inline bool netSendTo(socket_t s, const void* data, size_t len, const sockaddr_in &to) {
+    return sendto(s, (const char*)data, (int)len, 0, (const sockaddr*)&to, sizeof(to)) == (int)len;
+}
+
+// Next waiting datagram: its length, or -1 when none is queued
+inline int netRecvFrom(socket_t s, void* buf, size_t cap, sockaddr_in* from) {
+    while (true) {
+        sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        int n = (int)recvfrom(s, (char*)buf, (int)cap, 0, (sockaddr*)&addr, &len);
+        if (n >= 0) {
+            if (from) *from = addr;
+            return n;
+        }
+#ifdef _WIN32
+        if (WSAGetLastError() == WSAECONNRESET) continue; // ICMP from an earlier send; skip it
+#endif
+        return -1;
+    }
+}
+
+// Buffered line reader over a stream socket ('\n' terminated, '\r' stripped)
+class NetLineReader {
+public:
+    explicit NetLineReader(socket_t s) : sock(s), pos(0), len(0) {}
+
+    bool readLine(std::string &line) {
+        line.clear();
+        while (true) {
+            while (pos < len) {
+                char c = buf[pos++];
+                if (c == '\n') return true;
+                if (c != '\r') line.push_back(c);
+                if (line.size() > 4096) return false; // Malformed peer
+            }
+            int n = (int)recv(sock, buf, sizeof(buf), 0);
+            if (n <= 0) return false;
+            pos = 0;
+            len = n;
+        }
+    }
+
+private:
+    socket_t sock;
+    char buf[4096];
+    int pos, len;
+};
+
+#endif // NET_SOCKET_H
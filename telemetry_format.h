@@ -0,0 +1,157 @@
+// telemetry_format.h
+// Night Highway Patrol - on-disk format for per-tick telemetry, shared by the
+// game's recorder and the telemetry_reader tool.
+//
+// A file is a header followed by chunks until end of file:
+//   header: magic, version, column count, then per column its type and name
+//           (u8 type, u8 name length, name bytes)
+//   chunk:  row count (u32), payload bytes (u32), then per column the payload
+//           length (u32) and the column's values
+// Every value is 32 bits (floats by bit pattern). A column is stored as the
+// zigzag-encoded difference from the previous row, as a LEB128 varint, so
+// slowly changing columns cost one or two bytes a row. Integers are written
+// in host byte order; the recorder and reader run on the same machine.
+
+#ifndef TELEMETRY_FORMAT_H
+#define TELEMETRY_FORMAT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+const uint32_t TELEMETRY_MAGIC = 0x5450484Eu; // "NHPT"
+const uint32_t TELEMETRY_VERSION = 1;
+const int TELEMETRY_CHUNK_ROWS = 4096;
+const int TELEMETRY_MAX_COLUMNS = 32;
+
+enum TelemetryType : uint8_t { TELEMETRY_INT = 0, TELEMETRY_FLOAT = 1 };
+
+struct TelemetryColumn {
+    const char* name;
+    uint8_t type;
+};
+
+// Worst case for one encoded column of a full chunk (5 bytes per varint)
+const size_t TELEMETRY_MAX_COLUMN_BYTES = (size_t)TELEMETRY_CHUNK_ROWS * 5;
+
+inline uint32_t telemetryFloatBits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+inline float telemetryBitsFloat(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// Delta + zigzag + varint; returns the encoded length
+inline size_t encodeTelemetryColumn(const uint32_t* values, int rows, uint8_t* out) {
+    uint8_t* p = out;
+    uint32_t prev = 0;
+    for (int r = 0; r < rows; ++r) {
+        int32_t delta = (int32_t)(values[r] - prev);
+        uint32_t v = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+        prev = values[r];
+        while (v >= 0x80) { *p++ = (uint8_t)(v | 0x80); v >>= 7; }
+        *p++ = (uint8_t)v;
+    }
+    return (size_t)(p - out);
+}
+
+// Inverse of encodeTelemetryColumn; false if the bytes do not hold `rows` values
+inline bool decodeTelemetryColumn(const uint8_t* in, size_t len, uint32_t* values, int rows) {
+    const uint8_t* p = in;
+    const uint8_t* end = in + len;
+    uint32_t prev = 0;
+    for (int r = 0; r < rows; ++r) {
+        uint32_t v = 0;
+        int shift = 0;
+        while (true) {
+            if (p == end || shift > 28) return false;
+            uint8_t b = *p++;
+            v |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+            shift += 7;
+        }
+        prev += (v >> 1) ^ (0u - (v & 1u));
+        values[r] = prev;
+    }
+    return p == end;
+}
+
+inline bool writeTelemetryHeader(FILE* f, const TelemetryColumn* columns, int count) {
+    uint32_t head[3] = {TELEMETRY_MAGIC, TELEMETRY_VERSION, (uint32_t)count};
+    if (fwrite(head, sizeof(head), 1, f) != 1) return false;
+    for (int c = 0; c < count; ++c) {
+        uint8_t meta[2] = {columns[c].type, (uint8_t)strlen(columns[c].name)};
+        if (fwrite(meta, 2, 1, f) != 1 || fwrite(columns[c].name, meta[1], 1, f) != 1) return false;
+    }
+    return true;
+}
+
+// Streams a telemetry file one chunk at a time into column arrays
+class TelemetryReader {
+public:
+    ~TelemetryReader() { if (file) fclose(file); }
+
+    bool open(const char* path) {
+        file = fopen(path, "rb");
+        if (!file) return false;
+        uint32_t head[3];
+        if (fread(head, sizeof(head), 1, file) != 1 || head[0] != TELEMETRY_MAGIC ||
+            head[1] != TELEMETRY_VERSION || head[2] == 0 || head[2] > (uint32_t)TELEMETRY_MAX_COLUMNS) {
+            return false;
+        }
+        for (uint32_t c = 0; c < head[2]; ++c) {
+            uint8_t meta[2];
+            char name[256];
+            if (fread(meta, 2, 1, file) != 1 || (meta[1] && fread(name, meta[1], 1, file) != 1)) return false;
+            names.push_back(std::string(name, meta[1]));
+            types.push_back(meta[0]);
+        }
+        values.resize((size_t)head[2] * TELEMETRY_CHUNK_ROWS);
+        return true;
+    }
+
+    int columnCount() const { return (int)names.size(); }
+    const std::string &name(int c) const { return names[c]; }
+    uint8_t type(int c) const { return types[c]; }
+
+    // Next chunk's row count: 0 at end of file, -1 if the file is damaged
+    int readChunk() {
+        uint32_t head[2];
+        if (fread(head, sizeof(head), 1, file) != 1) return 0;
+        if (head[0] == 0 || head[0] > (uint32_t)TELEMETRY_CHUNK_ROWS) return -1;
+        // Bounded before allocating: a damaged length must not throw bad_alloc
+        if (head[1] > (size_t)columnCount() * (TELEMETRY_MAX_COLUMN_BYTES + 4)) return -1;
+        payload.resize(head[1]);
+        if (head[1] && fread(payload.data(), head[1], 1, file) != 1) return -1;
+        const uint8_t* p = payload.data();
+        const uint8_t* end = p + payload.size();
+        for (int c = 0; c < columnCount(); ++c) {
+            uint32_t len;
+            if (end - p < 4) return -1;
+            memcpy(&len, p, 4);
+            p += 4;
+            if ((size_t)(end - p) < len || !decodeTelemetryColumn(p, len, column(c), (int)head[0])) return -1;
+            p += len;
+        }
+        return (int)head[0];
+    }
+
+    // Values of column c for the last chunk read
+    uint32_t* column(int c) { return values.data() + (size_t)c * TELEMETRY_CHUNK_ROWS; }
+
+private:
+    FILE* file = nullptr;
+    std::vector<std::string> names;
+    std::vector<uint8_t> types;
+    std::vector<uint32_t> values;
+    std::vector<uint8_t> payload;
+};
+
+#endif // TELEMETRY_FORMAT_H
@@ -0,0 +1,111 @@
+// telemetry_reader.cpp
+// Night Highway Patrol - reads per-tick telemetry written by main --telemetry
+// Default: one scan over the file, printing per-column min / mean / max, the
+// number of runs and the scan rate. --csv prints every row instead.
+// Usage:
+//   telemetry_reader FILE [--csv] [--column NAME]
+//   (--column limits the summary or CSV to the named columns; repeatable)
+
+#include "telemetry_format.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+
+struct ColumnSummary {
+    double minValue = 1e300, maxValue = -1e300, sum = 0.0;
+};
+
+static double valueOf(uint32_t bits, uint8_t type) {
+    return type == TELEMETRY_FLOAT ? (double)telemetryBitsFloat(bits) : (double)(int32_t)bits;
+}
+
+int main(int argc, char** argv) {
+    std::string path;
+    bool csv = false;
+    std::vector<std::string> wanted;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--csv") csv = true;
+        else if (arg == "--column" && i + 1 < argc) wanted.push_back(argv[++i]);
+        else path = arg;
+    }
+    if (path.empty()) {
+        std::cerr << "Usage: telemetry_reader FILE [--csv] [--column NAME]\n";
+        return 1;
+    }
+
+    TelemetryReader reader;
+    if (!reader.open(path.c_str())) {
+        std::cerr << "Not a telemetry file: " << path << "\n";
+        return 1;
+    }
+    std::vector<int> columns;
+    for (int c = 0; c < reader.columnCount(); ++c) {
+        if (wanted.empty() || std::find(wanted.begin(), wanted.end(), reader.name(c)) != wanted.end()) {
+            columns.push_back(c);
+        }
+    }
+    int runColumn = -1;
+    for (int c = 0; c < reader.columnCount(); ++c) {
+        if (reader.name(c) == "run") runColumn = c;
+    }
+
+    if (csv) {
+        for (size_t k = 0; k < columns.size(); ++k) printf("%s%s", k ? "," : "", reader.name(columns[k]).c_str());
+        printf("\n");
+    }
+
+    std::vector<ColumnSummary> summary(reader.columnCount());
+    long long rows = 0, chunks = 0, runs = 0;
+    uint32_t lastRun = 0;
+    int n;
+    auto start = std::chrono::steady_clock::now();
+    while ((n = reader.readChunk()) > 0) {
+        chunks++;
+        if (csv) {
+            for (int r = 0; r < n; ++r) {
+                for (size_t k = 0; k < columns.size(); ++k) {
+                    int c = columns[k];
+                    printf("%s%.9g", k ? "," : "", valueOf(reader.column(c)[r], reader.type(c)));
+                }
+                printf("\n");
+            }
+        } else {
+            for (int c : columns) {
+                const uint32_t* values = reader.column(c);
+                ColumnSummary &s = summary[c];
+                for (int r = 0; r < n; ++r) {
+                    double v = valueOf(values[r], reader.type(c));
+                    s.minValue = std::min(s.minValue, v);
+                    s.maxValue = std::max(s.maxValue, v);
+                    s.sum += v;
+                }
+            }
+        }
+        if (runColumn >= 0) {
+            const uint32_t* run = reader.column(runColumn);
+            for (int r = 0; r < n; ++r) {
+                if (rows + r == 0 || run[r] != lastRun) runs++;
+                lastRun = run[r];
+            }
+        }
+        rows += n;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (n < 0) std::cerr << "Damaged chunk after row " << rows << "; stopped there\n";
+    if (csv) return n < 0 ? 1 : 0;
+
+    std::cout << path << ": rows=" << rows << " chunks=" << chunks << " runs=" << runs
+              << " columns=" << reader.columnCount() << "\n";
+    for (int c : columns) {
+        const ColumnSummary &s = summary[c];
+        printf("  %-16s min=%-12.6g mean=%-12.6g max=%.6g\n", reader.name(c).c_str(),
+               rows ? s.minValue : 0.0, rows ? s.sum / rows : 0.0, rows ? s.maxValue : 0.0);
+    }
+    std::cout << "scan_mticks_per_sec=" << rows / std::max(seconds, 1e-9) / 1e6 << std::endl;
+    return n < 0 ? 1 : 0;
+}